@@ -33,6 +33,7 @@
 #include <common/message.h>
 #include <common/objectbroker.h>
 #include <common/propertysyncer.h>
+#include <common/transferimage.h>
 
 #include <QTcpSocket>
 #include <QHostAddress>
@@ -127,9 +128,16 @@ void Client::socketDisconnected()
     resetClientDevice();
 }
 
+void Client::setCacheStatistics(Protocol::ObjectAddress objectAddress, qint64 cacheSize,
+                                qint64 cacheHits, qint64 cacheMisses)
+{
+    m_statModel->setCacheStatistics(objectAddress, cacheSize, cacheHits, cacheMisses);
+}
+
 void Client::messageReceived(const Message &msg)
 {
-    m_statModel->addMessage(msg.address(), msg.type(), msg.size());
+    m_statModel->addMessage(msg.address(), msg.type(), msg.size(), msg.transferSize(),
+                            msg.compressionTime());
     // server version must be the very first message we get
     if (!(m_initState & VersionChecked)) {
         if (msg.address() != endpointAddress() || msg.type() != Protocol::ServerVersion) {
@@ -190,8 +198,11 @@ void Client::messageReceived(const Message &msg)
         case Protocol::ServerInfo:
         {
             QString label;
-            msg >> label;
+            quint8 serverCompression, serverImageEncodings;
+            msg >> label >> serverCompression >> serverImageEncodings;
             setLabel(label);
+            negotiateCompression(static_cast<Protocol::Compression>(serverCompression),
+                                 serverImageEncodings);
             m_initState |= ServerInfoReceived;
             break;
         }
@@ -262,8 +273,28 @@ void Client::unmonitorObject(Protocol::ObjectAddress objectAddress)
     send(msg);
 }
 
+void Client::negotiateCompression(Protocol::Compression serverCompression,
+                                  quint8 serverImageEncodings)
+{
+    // local transports are fast enough that compression would only cost CPU time
+    auto compression = Protocol::NoCompression;
+    quint8 imageEncodings = 0;
+    if (m_serverAddress.scheme() == QLatin1String("tcp")) {
+        if (serverCompression >= Protocol::LZ4StreamCompression)
+            compression = Protocol::LZ4StreamCompression;
+        imageEncodings = serverImageEncodings & TransferImage::supportedDecoders();
+    }
+
+    Message msg(endpointAddress(), Protocol::CompressionSelect);
+    msg << quint8(compression) << imageEncodings;
+    send(msg);
+    setCompression(compression);
+    setImageEncodings(imageEncodings);
+}
+
 void Client::doSendMessage(const GammaRay::Message &msg)
 {
-    m_statModel->addMessage(msg.address(), msg.type(), msg.size());
     Endpoint::doSendMessage(msg);
+    m_statModel->addMessage(msg.address(), msg.type(), msg.size(), msg.transferSize(),
+                            msg.compressionTime());
 }
@@ -65,6 +65,10 @@ public:
                                 const char *messageHandlerName) Q_DECL_OVERRIDE;
     void unregisterMessageHandler(Protocol::ObjectAddress objectAddress) Q_DECL_OVERRIDE;
 
+    /** Update the client-side cache statistics shown for the object at @p objectAddress. */
+    void setCacheStatistics(Protocol::ObjectAddress objectAddress, qint64 cacheSize,
+                            qint64 cacheHits, qint64 cacheMisses);
+
 signals:
     /** Emitted when we successfully established a connection and passed the protocol version handshake step. */
     void connectionEstablished();
@@ -88,6 +92,8 @@ protected:
 private:
     void monitorObject(Protocol::ObjectAddress objectAddress);
     void unmonitorObject(Protocol::ObjectAddress objectAddress);
+    /** Picks the compression for this connection, given the best one the server supports. */
+    void negotiateCompression(Protocol::Compression serverCompression, quint8 serverImageEncodings);
 
 private slots:
     void socketConnected();
@@ -73,11 +73,25 @@ static const MetaEnum::Value<Protocol::MessageType> message_type_table[] = {
     M(PropertyValuesChanged),
     M(ServerInfo),
     M(ProbeSettings),
-    M(ServerAddress)
+    M(ServerAddress),
+    M(CompressionSelect),
+    M(ModelIconData),
+    M(ModelIndexHandleRelease)
 };
 #undef M
 
+// additional columns following the message type columns
+static const int CacheSizeColumn = Protocol::MESSAGE_TYPE_COUNT;
+static const int CacheHitRateColumn = Protocol::MESSAGE_TYPE_COUNT + 1;
+static const int CompressionRatioColumn = Protocol::MESSAGE_TYPE_COUNT + 2;
+static const int CompressionTimeColumn = Protocol::MESSAGE_TYPE_COUNT + 3;
+
 MessageStatisticsModel::Info::Info()
+    : cacheSize(0)
+    , cacheHits(0)
+    , cacheMisses(0)
+    , transferSize(0)
+    , compressionTime(0)
 {
     messageCount.resize(Protocol::MESSAGE_TYPE_COUNT);
     messageSize.resize(Protocol::MESSAGE_TYPE_COUNT);
@@ -128,7 +142,7 @@ void MessageStatisticsModel::addObject(Protocol::ObjectAddress addr, const QStri
 }
 
 void MessageStatisticsModel::addMessage(Protocol::ObjectAddress addr, Protocol::MessageType msgType,
-                                        int size)
+                                        int size, int transferSize, qint64 compressionTime)
 {
     addr -= 1;
     msgType -= 1;
@@ -139,20 +153,43 @@ void MessageStatisticsModel::addMessage(Protocol::ObjectAddress addr, Protocol::
     if (addr < m_data.size()) {
         m_data[addr].messageCount[msgType]++;
         m_data[addr].messageSize[msgType] += size;
+        m_data[addr].transferSize += transferSize;
+        m_data[addr].compressionTime += compressionTime;
         emit dataChanged(index(addr, msgType + 1), index(addr, msgType + 1));
+        emit dataChanged(index(addr, CompressionRatioColumn), index(addr, CompressionTimeColumn));
     } else {
         beginInsertRows(QModelIndex(), m_data.size(), addr);
         m_data.resize(addr + 1);
         m_data[addr].messageCount[msgType] = 1;
         m_data[addr].messageSize[msgType] = size;
+        m_data[addr].transferSize = transferSize;
+        m_data[addr].compressionTime = compressionTime;
         endInsertRows();
     }
 }
 
+void MessageStatisticsModel::setCacheStatistics(Protocol::ObjectAddress addr, qint64 cacheSize,
+                                                qint64 cacheHits, qint64 cacheMisses)
+{
+    addr -= 1;
+
+    if (addr >= m_data.size()) {
+        beginInsertRows(QModelIndex(), m_data.size(), addr);
+        m_data.resize(addr + 1);
+        endInsertRows();
+    }
+
+    auto &info = m_data[addr];
+    info.cacheSize = cacheSize;
+    info.cacheHits = cacheHits;
+    info.cacheMisses = cacheMisses;
+    emit dataChanged(index(addr, CacheSizeColumn), index(addr, CacheHitRateColumn));
+}
+
 int MessageStatisticsModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    return Protocol::MESSAGE_TYPE_COUNT;
+    return CompressionTimeColumn + 1;
 }
 
 int MessageStatisticsModel::rowCount(const QModelIndex &parent) const
@@ -206,6 +243,42 @@ QVariant MessageStatisticsModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
+    if (index.column() == CacheSizeColumn) {
+        if (role == Qt::DisplayRole && info.cacheSize > 0)
+            return QString::number(info.cacheSize);
+        return QVariant();
+    }
+
+    if (index.column() == CacheHitRateColumn) {
+        const auto requests = info.cacheHits + info.cacheMisses;
+        if (requests == 0)
+            return QVariant();
+        if (role == Qt::DisplayRole)
+            return QString::number(100.0 * (double)info.cacheHits / (double)requests, 'f', 2)
+                   + QLatin1Char('%');
+        if (role == Qt::ToolTipRole)
+            return tr("Cache Hits: %1\nCache Misses: %2").arg(info.cacheHits).arg(info.cacheMisses);
+        return QVariant();
+    }
+
+    if (index.column() == CompressionRatioColumn) {
+        const auto size = info.totalSize();
+        if (size == 0)
+            return QVariant();
+        if (role == Qt::DisplayRole)
+            return QString::number(100.0 * (double)info.transferSize / (double)size, 'f', 2)
+                   + QLatin1Char('%');
+        if (role == Qt::ToolTipRole)
+            return tr("Payload Size: %1\nTransferred: %2").arg(size).arg(info.transferSize);
+        return QVariant();
+    }
+
+    if (index.column() == CompressionTimeColumn) {
+        if (role == Qt::DisplayRole && info.compressionTime > 0)
+            return tr("%1 ms").arg((double)info.compressionTime / 1000000.0, 0, 'f', 3);
+        return QVariant();
+    }
+
     const auto msgType = index.column() - 1;
 
     if (role == Qt::DisplayRole) {
@@ -247,10 +320,34 @@ QVariant MessageStatisticsModel::headerData(int section, Qt::Orientation orienta
         if (role == Qt::DisplayRole) {
             if (section == 0)
                 return tr("Object Name");
+            if (section == CacheSizeColumn)
+                return tr("Cache Size");
+            if (section == CacheHitRateColumn)
+                return tr("Cache Hit Rate");
+            if (section == CompressionRatioColumn)
+                return tr("Compression");
+            if (section == CompressionTimeColumn)
+                return tr("Compression Time");
             return MetaEnum::enumToString(static_cast<Protocol::MessageType>(section),
                                           message_type_table);
         }
 
+        if (section >= CacheSizeColumn) {
+            if (role == Qt::ToolTipRole) {
+                switch (section) {
+                case CacheSizeColumn:
+                    return tr("Estimated memory used for cached item data by the client.");
+                case CacheHitRateColumn:
+                    return tr("Share of item data requests served from the client-side cache.");
+                case CompressionRatioColumn:
+                    return tr("Transferred size relative to the uncompressed message size.");
+                case CompressionTimeColumn:
+                    return tr("CPU time the client spent on compressing and decompressing messages.");
+                }
+            }
+            return QAbstractTableModel::headerData(section, orientation, role);
+        }
+
         if (role == Qt::BackgroundRole && section > 0) {
             const auto countRatio = (double)countPerType(section - 1) / (double)m_totalCount;
             const auto sizeRatio = (double)sizePerType(section - 1) / (double)m_totalSize;
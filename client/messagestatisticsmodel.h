@@ -46,7 +46,13 @@ public:
 
     void clear();
     void addObject(Protocol::ObjectAddress addr, const QString &name);
-    void addMessage(Protocol::ObjectAddress addr, Protocol::MessageType msgType, int size);
+    /** Records a message with a payload of @p size bytes, of which @p transferSize bytes went
+     *  over the wire after compression, which took @p compressionTime nanoseconds.
+     */
+    void addMessage(Protocol::ObjectAddress addr, Protocol::MessageType msgType, int size,
+                    int transferSize, qint64 compressionTime);
+    void setCacheStatistics(Protocol::ObjectAddress addr, qint64 cacheSize, qint64 cacheHits,
+                            qint64 cacheMisses);
 
     int columnCount(const QModelIndex &parent) const Q_DECL_OVERRIDE;
     int rowCount(const QModelIndex &parent) const Q_DECL_OVERRIDE;
@@ -65,6 +71,13 @@ private:
         QString name;
         QVector<int> messageCount;
         QVector<int> messageSize;
+        // client-side cache usage, for remote models
+        qint64 cacheSize;
+        qint64 cacheHits;
+        qint64 cacheMisses;
+        // compression of all messages to/from this object
+        qint64 transferSize;
+        qint64 compressionTime;
     };
     QVector<Info> m_data;
     int m_totalCount;
@@ -34,59 +34,162 @@
 #include <QApplication>
 #include <QDataStream>
 #include <QDebug>
+#include <QImage>
+#include <QPixmap>
 #include <QStyle>
 #include <QStyleOptionViewItem>
 
 #include <algorithm>
 #include <limits>
+#include <new>
 
 using namespace GammaRay;
 
 void(*RemoteModel::s_registerClientCallback)() = 0;
 
-RemoteModel::Node::~Node()
+static const qint64 DefaultCacheBudget = 32 * 1024 * 1024;
+// each handle pins a persistent index on the server
+static const int MaxIndexHandles = 1024;
+
+// rough estimate of the memory used by a single value, only payloads of relevant size are considered
+static int estimateCost(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::QString:
+        return value.toString().size() * sizeof(QChar);
+    case QMetaType::QByteArray:
+        return value.toByteArray().size();
+    case QMetaType::QPixmap:
+    {
+        const QPixmap pixmap = value.value<QPixmap>();
+        return pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+    }
+    case QMetaType::QImage:
+    {
+        const QImage image = value.value<QImage>();
+        return image.width() * image.height() * image.depth() / 8;
+    }
+    }
+    return 0;
+}
+
+static bool roleLessThan(const QPair<int, QVariant> &lhs, int role)
 {
-    qDeleteAll(children);
+    return lhs.first < role;
 }
 
-void RemoteModel::Node::clearChildrenData()
+static bool isOnDemandPlaceholder(const QPair<int, QVariant> &roleValue)
 {
-    foreach (auto child, children) {
-        child->clearChildrenStructure();
-        child->data.clear();
-        child->flags.clear();
-        child->state.clear();
-    }
+    return Protocol::isOnDemandRole(roleValue.first) && !roleValue.second.isValid();
+}
+
+RemoteModel::Cell::Cell()
+    : flagsAndState((quint32(Qt::ItemIsSelectable | Qt::ItemIsEnabled))
+                    | (quint32(RemoteModel::Empty | RemoteModel::Outdated) << 16))
+{
+}
+
+QVariant RemoteModel::Cell::value(int role) const
+{
+    const auto it = std::lower_bound(roles.constBegin(), roles.constEnd(), role, roleLessThan);
+    if (it == roles.constEnd() || it->first != role)
+        return QVariant();
+    return it->second;
+}
+
+bool RemoteModel::Cell::hasValue(int role) const
+{
+    const auto it = std::lower_bound(roles.constBegin(), roles.constEnd(), role, roleLessThan);
+    return it != roles.constEnd() && it->first == role;
+}
+
+void RemoteModel::Cell::setValue(int role, const QVariant &value)
+{
+    const auto it = std::lower_bound(roles.begin(), roles.end(), role, roleLessThan);
+    if (it != roles.end() && it->first == role)
+        it->second = value;
+    else
+        roles.insert(it, qMakePair(role, value));
 }
 
-void RemoteModel::Node::clearChildrenStructure()
+void RemoteModel::Cell::removeOnDemandPlaceholders()
 {
-    qDeleteAll(children);
-    children.clear();
-    rowCount = -1;
-    columnCount = -1;
+    roles.erase(std::remove_if(roles.begin(), roles.end(), isOnDemandPlaceholder), roles.end());
+}
+
+void RemoteModel::Cell::setItemData(const QMap<int, QVariant> &itemData)
+{
+    // QMap is sorted by key already
+    roles.clear();
+    roles.reserve(itemData.size());
+    for (auto it = itemData.constBegin(); it != itemData.constEnd(); ++it)
+        roles.push_back(qMakePair(it.key(), it.value()));
 }
 
 void RemoteModel::Node::allocateColumns()
 {
     if (hasColumnData() || !parent || parent->columnCount < 0)
         return;
-    data.resize(parent->columnCount);
-    flags.resize(parent->columnCount);
-    flags.fill(Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-    state.resize(parent->columnCount);
-    state.fill(RemoteModel::Empty | RemoteModel::Outdated);
+    columns.resize(parent->columnCount);
 }
 
 bool RemoteModel::Node::hasColumnData() const
 {
     if (!parent)
         return false;
-    Q_ASSERT(data.size() == flags.size());
-    Q_ASSERT(data.size() == state.size());
-    Q_ASSERT(data.isEmpty() || data.size() == parent->columnCount || parent->columnCount < 0);
+    Q_ASSERT(columns.isEmpty() || columns.size() == parent->columnCount
+             || parent->columnCount < 0);
+
+    return columns.size() == parent->columnCount && parent->columnCount > 0;
+}
+
+// nodes per chunk, a chunk is about 64kB
+static const int NodePoolChunkSize = 1024;
+
+RemoteModel::NodePool::NodePool()
+    : m_freeList(0)
+    , m_chunkFill(NodePoolChunkSize)
+{
+}
+
+RemoteModel::NodePool::~NodePool()
+{
+    foreach (auto chunk, m_chunks)
+        ::operator delete(chunk);
+}
 
-    return data.size() == parent->columnCount && parent->columnCount > 0;
+RemoteModel::Node *RemoteModel::NodePool::create(RemoteModel::Node *parent)
+{
+    void *mem;
+    if (m_freeList) {
+        mem = m_freeList;
+        m_freeList = *reinterpret_cast<Node **>(m_freeList);
+    } else {
+        if (m_chunkFill == NodePoolChunkSize) {
+            m_chunks.push_back(static_cast<Node *>(::operator new(NodePoolChunkSize * sizeof(Node))));
+            m_chunkFill = 0;
+        }
+        mem = m_chunks.last() + m_chunkFill++;
+    }
+
+    Node *node = new (mem) Node;
+    node->parent = parent;
+    return node;
+}
+
+void RemoteModel::NodePool::destroy(RemoteModel::Node *node)
+{
+    foreach (auto child, node->children)
+        destroy(child);
+    node->~Node();
+    // reuse the node memory as free list link
+    *reinterpret_cast<Node **>(node) = m_freeList;
+    m_freeList = node;
+}
+
+qint64 RemoteModel::NodePool::memoryUsage() const
+{
+    return qint64(m_chunks.size()) * NodePoolChunkSize * sizeof(Node);
 }
 
 QVariant RemoteModel::s_emptyDisplayValue;
@@ -95,6 +198,13 @@ QVariant RemoteModel::s_emptySizeHintValue;
 RemoteModel::RemoteModel(const QString &serverObject, QObject *parent)
     : QAbstractItemModel(parent)
     , m_pendingDataRequestsTimer(new QTimer(this))
+    , m_cacheSize(0)
+    , m_cachedNodeCount(0)
+    , m_cacheBudget(DefaultCacheBudget)
+    , m_cacheHits(0)
+    , m_cacheMisses(0)
+    , m_handleClock(0)
+    , m_useIndexHandles(true)
     , m_serverObject(serverObject)
     , m_myAddress(Protocol::InvalidObjectAddress)
     , m_currentSyncBarrier(0)
@@ -117,7 +227,10 @@ RemoteModel::RemoteModel(const QString &serverObject, QObject *parent)
                                                                        &opt, QSize(), Q_NULLPTR);
     }
 
-    m_root = new Node;
+    m_root = m_nodePool.create(0);
+    bindHandle(m_root, Protocol::RootModelIndexHandle);
+    m_lruList.lruPrev = &m_lruList;
+    m_lruList.lruNext = &m_lruList;
 
     m_pendingDataRequestsTimer->setInterval(0);
     m_pendingDataRequestsTimer->setSingleShot(true);
@@ -129,7 +242,7 @@ RemoteModel::RemoteModel(const QString &serverObject, QObject *parent)
 
 RemoteModel::~RemoteModel()
 {
-    delete m_root;
+    m_nodePool.destroy(m_root);
 }
 
 bool RemoteModel::isConnected() const
@@ -137,6 +250,35 @@ bool RemoteModel::isConnected() const
     return m_myAddress != Protocol::InvalidObjectAddress;
 }
 
+qint64 RemoteModel::cacheBudget() const
+{
+    return m_cacheBudget;
+}
+
+void RemoteModel::setCacheBudget(qint64 bytes)
+{
+    m_cacheBudget = bytes;
+    evictCachedData(0);
+    reportCacheStatistics();
+}
+
+bool RemoteModel::useIndexHandles() const
+{
+    return m_useIndexHandles;
+}
+
+void RemoteModel::setUseIndexHandles(bool useHandles)
+{
+    if (m_useIndexHandles == useHandles)
+        return;
+    // pending requests are encoded for the current mode
+    if (!m_pendingDataRequests.isEmpty()) {
+        m_pendingDataRequestsTimer->stop();
+        doRequestDataAndFlags();
+    }
+    m_useIndexHandles = useHandles;
+}
+
 QModelIndex RemoteModel::index(int row, int column, const QModelIndex &parent) const
 {
     if (!isConnected() || row < 0 || column < 0)
@@ -210,8 +352,12 @@ QVariant RemoteModel::data(const QModelIndex &index, int role) const
             return s_emptySizeHintValue;
     }
 
-    if ((state & Outdated) && ((state & Loading) == 0))
+    if ((state & Outdated) && ((state & Loading) == 0)) {
+        ++m_cacheMisses;
         requestDataAndFlags(index);
+    } else if ((state & (Empty | Outdated)) == 0) {
+        ++m_cacheHits;
+    }
 
     if (state & Empty) { // still waiting for data
         if (role == Qt::DisplayRole)
@@ -220,8 +366,12 @@ QVariant RemoteModel::data(const QModelIndex &index, int role) const
     }
 
     // note .value returns good defaults otherwise
-    Q_ASSERT(node->data.size() > index.column());
-    return node->data.at(index.column()).value(role);
+    Q_ASSERT(node->columns.size() > index.column());
+    touchNode(node);
+    const Cell &cell = node->columns.at(index.column());
+    if (Protocol::isOnDemandRole(role) && (state & Loading) == 0 && !cell.hasValue(role))
+        requestOnDemandRole(index, role);
+    return cell.value(role);
 }
 
 bool RemoteModel::setData(const QModelIndex &index, const QVariant &value, int role)
@@ -244,8 +394,8 @@ Qt::ItemFlags RemoteModel::flags(const QModelIndex &index) const
     Q_ASSERT(node);
     if (!node->hasColumnData())
         return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
-    Q_ASSERT(node->flags.size() > index.column());
-    return node->flags.at(index.column());
+    Q_ASSERT(node->columns.size() > index.column());
+    return node->columns.at(index.column()).flags();
 }
 
 QVariant RemoteModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -278,6 +428,22 @@ void RemoteModel::sort(int column, Qt::SortOrder order)
 
 void RemoteModel::newMessage(const GammaRay::Message &msg)
 {
+    if (msg.type() == Protocol::ModelIconData) {
+        // never dropped by the sync barrier, the server sends each icon only once
+        bool forgetIcons;
+        quint32 count;
+        msg >> forgetIcons >> count;
+        if (forgetIcons) // the server started over with its icon registry
+            m_icons.clear();
+        for (quint32 i = 0; i < count; ++i) {
+            quint32 id;
+            QPixmap pixmap;
+            msg >> id >> pixmap;
+            m_icons.insert(id, pixmap);
+        }
+        return;
+    }
+
     if (!checkSyncBarrier(msg))
         return;
 
@@ -327,11 +493,8 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
         if (rowCount > 0) {
             beginInsertRows(qmi, 0, rowCount - 1);
             node->children.reserve(rowCount);
-            for (int i = 0; i < rowCount; ++i) {
-                Node *child = new Node;
-                child->parent = node;
-                node->children.push_back(child);
-            }
+            for (int i = 0; i < rowCount; ++i)
+                node->children.push_back(m_nodePool.create(node));
             node->rowCount = rowCount;
             endInsertRows();
         } else {
@@ -342,35 +505,89 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
 
     case Protocol::ModelContentReply:
     {
+        quint8 addressing;
+        msg >> addressing;
+        if (addressing == Protocol::ModelIndexHandles) {
+            // handles assigned to parents we addressed by path
+            quint32 handleCount;
+            msg >> handleCount;
+            for (quint32 i = 0; i < handleCount; ++i) {
+                Protocol::ModelIndexHandle handle;
+                Protocol::ModelIndex parentIndex;
+                msg >> handle >> parentIndex;
+                if (Node *parentNode = nodeForIndex(parentIndex))
+                    bindHandle(parentNode, handle);
+            }
+        }
+
+        QVector<qint32> roles; // empty for the full content, otherwise on demand roles
         quint32 size;
-        msg >> size;
+        msg >> roles >> size;
         Q_ASSERT(size > 0);
 
         QHash<QModelIndex, QVector<QModelIndex> > dataChangedIndexes;
+        int updatedNodes = 0;
         for (quint32 i = 0; i < size; ++i) {
-            Protocol::ModelIndex index;
-            msg >> index;
-            Node *node = nodeForIndex(index);
-            const auto column = index.last().second;
+            Node *node = 0;
+            qint32 column;
+            if (addressing == Protocol::ModelIndexHandles) {
+                Protocol::ModelIndexHandle handle;
+                qint32 row;
+                msg >> handle >> row >> column;
+                Node *parentNode = m_handles.value(handle);
+                if (parentNode && row >= 0 && row < parentNode->children.size())
+                    node = parentNode->children.at(row);
+            } else {
+                Protocol::ModelIndex index;
+                msg >> index;
+                node = nodeForIndex(index);
+                column = index.last().second;
+            }
             const NodeStates state = node ? stateForColumn(node, column) : NoState;
-            typedef QHash<int, QVariant> ItemData;
-            ItemData itemData;
+            QMap<int, QVariant> itemData;
+            quint8 iconCount;
+            msg >> itemData >> iconCount;
+            for (quint8 j = 0; j < iconCount; ++j) {
+                qint32 role;
+                quint32 iconId;
+                msg >> role >> iconId;
+                itemData.insert(role, m_icons.value(iconId));
+            }
             qint32 flags;
-            msg >> itemData >> flags;
+            msg >> flags;
+
+            if (!roles.isEmpty()) {
+                // on demand roles are merged into already loaded content
+                if (!node || (state & Empty))
+                    continue;
+                Cell &cell = node->columns[column];
+                foreach (qint32 role, roles)
+                    cell.setValue(role, itemData.value(role));
+                updateCacheCost(node);
+                const QModelIndex qmi = modelIndexForNode(node, column);
+                dataChangedIndexes[qmi.parent()].push_back(qmi);
+                continue;
+            }
+
             if ((state & Loading) == 0)
                 continue; // we didn't ask for this, probably outdated response for a moved cell
 
             if (node) {
                 node->allocateColumns();
-                Q_ASSERT(node->data.size() > column);
-                node->data[column] = itemData;
-                node->flags[column] = static_cast<Qt::ItemFlags>(flags);
-                node->state[column] = state & ~(Loading | Empty | Outdated);
+                Q_ASSERT(node->columns.size() > column);
+                Cell &cell = node->columns[column];
+                cell.setItemData(itemData);
+                cell.setFlags(static_cast<Qt::ItemFlags>(flags));
+                cell.setState(state & ~(Loading | Empty | Outdated));
+                if (node != m_lruList.lruNext)
+                    ++updatedNodes;
+                updateCacheCost(node);
+                touchNode(node);
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
                 if ((flags & Qt::ItemNeverHasChildren) && column == 0) {
                     node->rowCount = 0;
-                    node->columnCount = node->data.size();
+                    node->columnCount = node->columns.size();
                 }
 #endif
 
@@ -381,6 +598,10 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
             }
         }
 
+        // make room for the new data, but don't evict what we just received
+        evictCachedData(updatedNodes);
+        reportCacheStatistics();
+
         for (auto it = dataChangedIndexes.constBegin(); it != dataChangedIndexes.constEnd(); ++it) {
             const auto &indexes = it.value();
             Q_ASSERT(!indexes.isEmpty());
@@ -419,38 +640,44 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
 
     case Protocol::ModelContentChanged:
     {
-        Protocol::ModelIndex beginIndex, endIndex;
-        QVector<int> roles;
-        msg >> beginIndex >> endIndex >> roles;
-        Node *node = nodeForIndex(beginIndex);
-        if (!node || node == m_root)
-            break;
+        // the server accumulates changes, so we get a list of ranges here
+        quint32 size;
+        msg >> size;
+        for (quint32 i = 0; i < size; ++i) {
+            Protocol::ModelIndex beginIndex, endIndex;
+            QVector<int> roles;
+            msg >> beginIndex >> endIndex >> roles;
+            Node *node = nodeForIndex(beginIndex);
+            if (!node || node == m_root)
+                continue;
 
-        Q_ASSERT(beginIndex.last().first <= endIndex.last().first);
-        Q_ASSERT(beginIndex.last().second <= endIndex.last().second);
+            Q_ASSERT(beginIndex.last().first <= endIndex.last().first);
+            Q_ASSERT(beginIndex.last().second <= endIndex.last().second);
 
-        // mark content as outdated (will be refetched on next request)
-        for (int row = beginIndex.last().first; row <= endIndex.last().first; ++row) {
-            Node *currentRow = node->parent->children.at(row);
-            if (!currentRow->hasColumnData())
-                continue;
-            for (int col = beginIndex.last().second; col <= endIndex.last().second; ++col) {
-                const NodeStates state = stateForColumn(currentRow, col);
-                if ((state & Outdated) == 0) {
-                    Q_ASSERT(currentRow->state.size() > col);
-                    currentRow->state[col] = state | Outdated;
+            // mark content as outdated (will be refetched on next request)
+            for (int row = beginIndex.last().first; row <= endIndex.last().first; ++row) {
+                Node *currentRow = node->parent->children.at(row);
+                if (!currentRow->hasColumnData())
+                    continue;
+                for (int col = beginIndex.last().second; col <= endIndex.last().second; ++col) {
+                    const NodeStates state = stateForColumn(currentRow, col);
+                    if ((state & Outdated) == 0) {
+                        Q_ASSERT(currentRow->columns.size() > col);
+                        currentRow->columns[col].setState(state | Outdated);
+                    }
                 }
             }
-        }
 
-        const QModelIndex qmiBegin = modelIndexForNode(node, beginIndex.last().second);
-        const QModelIndex qmiEnd = qmiBegin.sibling(endIndex.last().first, endIndex.last().second);
+            const QModelIndex qmiBegin = modelIndexForNode(node, beginIndex.last().second);
+            const QModelIndex qmiEnd = qmiBegin.sibling(endIndex.last().first,
+                                                        endIndex.last().second);
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-        emit dataChanged(qmiBegin, qmiEnd);
+            emit dataChanged(qmiBegin, qmiEnd);
 #else
-        emit dataChanged(qmiBegin, qmiEnd, roles);
+            emit dataChanged(qmiBegin, qmiEnd, roles);
 #endif
+        }
         break;
     }
 
@@ -581,9 +808,9 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
             foreach (const auto &persistentIndex, persistentIndexList())
                 changePersistentIndex(persistentIndex, QModelIndex());
             if (hint == 0)
-                m_root->clearChildrenStructure();
+                clearChildrenStructure(m_root);
             else
-                m_root->clearChildrenData();
+                clearChildrenData(m_root);
             emit layoutChanged();
             break;
         }
@@ -612,9 +839,9 @@ void RemoteModel::newMessage(const GammaRay::Message &msg)
         }
         foreach (auto node, parentNodes) {
             if (hint == 0)
-                node->clearChildrenStructure();
+                clearChildrenStructure(node);
             else
-                node->clearChildrenData();
+                clearChildrenData(node);
         }
         emit layoutChanged(); // TODO Qt5 support with exact sub-trees
         break;
@@ -689,8 +916,8 @@ RemoteModel::NodeStates RemoteModel::stateForColumn(RemoteModel::Node *node, int
     Q_ASSERT(node);
     if (!node->hasColumnData())
         return Empty | Outdated;
-    Q_ASSERT(node->state.size() > columnIndex);
-    return node->state.at(columnIndex);
+    Q_ASSERT(node->columns.size() > columnIndex);
+    return node->columns.at(columnIndex).state();
 }
 
 void RemoteModel::requestRowColumnCount(const QModelIndex &index) const
@@ -717,10 +944,37 @@ void RemoteModel::requestDataAndFlags(const QModelIndex &index) const
     Q_ASSERT((state & Loading) == 0);
 
     node->allocateColumns();
-    Q_ASSERT(node->state.size() > index.column());
-    node->state[index.column()] = state | Loading; // mark pending request
+    Q_ASSERT(node->columns.size() > index.column());
+    node->columns[index.column()].setState(state | Loading); // mark pending request
+
+    queueDataRequest(node, index, -1);
+}
 
-    m_pendingDataRequests.push_back(Protocol::fromQModelIndex(index));
+void RemoteModel::requestOnDemandRole(const QModelIndex &index, int role) const
+{
+    Node *node = nodeForIndex(index);
+    Q_ASSERT(node);
+    Q_ASSERT(node->columns.size() > index.column());
+
+    // placeholder until the reply arrives, also marks the role as requested
+    // in case the server has no value for it
+    node->columns[index.column()].setValue(role, QVariant());
+    queueDataRequest(node, index, role);
+}
+
+void RemoteModel::queueDataRequest(Node *node, const QModelIndex &index, int role) const
+{
+    DataRequest request;
+    request.parentHandle = m_useIndexHandles ? node->parent->handle
+                                             : Protocol::InvalidModelIndexHandle;
+    request.row = index.row();
+    request.column = index.column();
+    request.role = role;
+    if (request.parentHandle == Protocol::InvalidModelIndexHandle)
+        request.parentPath = Protocol::fromQModelIndex(index.parent());
+    else
+        touchHandle(node->parent);
+    m_pendingDataRequests.push_back(request);
     if (m_pendingDataRequests.size() > 100) {
         m_pendingDataRequestsTimer->stop();
         doRequestDataAndFlags();
@@ -732,12 +986,48 @@ void RemoteModel::requestDataAndFlags(const QModelIndex &index) const
 void RemoteModel::doRequestDataAndFlags() const
 {
     Q_ASSERT(!m_pendingDataRequests.isEmpty());
-    Message msg(m_myAddress, Protocol::ModelContentRequest);
-    msg << quint32(m_pendingDataRequests.size());
-    foreach (const auto &index, m_pendingDataRequests)
-        msg << index;
+
+    const QVector<DataRequest> requests = m_pendingDataRequests;
     m_pendingDataRequests.clear();
-    sendMessage(msg);
+
+    // one message per requested role, full content requests come first
+    QMap<int, quint32> requestCounts;
+    foreach (const auto &request, requests)
+        ++requestCounts[request.role];
+
+    for (auto it = requestCounts.constBegin(); it != requestCounts.constEnd(); ++it) {
+        const int role = it.key();
+        const quint32 count = it.value();
+        QVector<qint32> requestedRoles;
+        if (role >= 0)
+            requestedRoles.push_back(role);
+
+        Message msg(m_myAddress, Protocol::ModelContentRequest);
+        if (m_useIndexHandles) {
+            msg << quint8(Protocol::ModelIndexHandles) << requestedRoles << count;
+            foreach (const auto &request, requests) {
+                if (request.role != role)
+                    continue;
+                msg << request.parentHandle;
+                if (request.parentHandle == Protocol::InvalidModelIndexHandle)
+                    msg << request.parentPath;
+                msg << request.row << request.column;
+            }
+        } else {
+            msg << quint8(Protocol::ModelIndexPaths) << requestedRoles << count;
+            foreach (const auto &request, requests) {
+                if (request.role != role)
+                    continue;
+                auto index = request.parentPath;
+                index.push_back(qMakePair(request.row, request.column));
+                msg << index;
+            }
+        }
+        sendMessage(msg);
+    }
+
+    if (m_handles.size() > MaxIndexHandles)
+        releaseHandles();
 }
 
 void RemoteModel::requestHeaderData(Qt::Orientation orientation, int section) const
@@ -763,11 +1053,19 @@ void RemoteModel::clear()
         sendMessage(msg);
     }
 
-    delete m_root;
-    m_root = new Node;
+    m_nodePool.destroy(m_root);
+    m_root = m_nodePool.create(0);
+    m_handles.clear();
+    m_handleLastUse.clear();
+    bindHandle(m_root, Protocol::RootModelIndexHandle);
+    m_lruList.lruPrev = &m_lruList;
+    m_lruList.lruNext = &m_lruList;
+    m_cacheSize = 0;
+    m_cachedNodeCount = 0;
     m_horizontalHeaders.clear();
     m_verticalHeaders.clear();
     endResetModel();
+    reportCacheStatistics();
 }
 
 void RemoteModel::connectToServer()
@@ -799,14 +1097,199 @@ void RemoteModel::resetLoadingState(RemoteModel::Node *node, int startRow) const
     Q_ASSERT(node->children.size() == node->rowCount);
     for (int row = startRow; row < node->rowCount; ++row) {
         Node *child = node->children.at(row);
-        for (auto it = child->state.begin(); it != child->state.end(); ++it) {
-            if ((*it) & Loading)
-                (*it) = (*it) & ~Loading;
+        for (auto it = child->columns.begin(); it != child->columns.end(); ++it) {
+            if (it->state() & Loading)
+                it->setState(it->state() & ~Loading);
         }
         resetLoadingState(child, 0);
     }
 }
 
+void RemoteModel::clearChildrenData(RemoteModel::Node *node)
+{
+    uncacheChildren(node);
+    foreach (auto child, node->children) {
+        clearChildrenStructure(child);
+        child->columns.clear();
+    }
+}
+
+void RemoteModel::clearChildrenStructure(RemoteModel::Node *node)
+{
+    uncacheChildren(node);
+    foreach (auto child, node->children)
+        m_nodePool.destroy(child);
+    node->children.clear();
+    node->rowCount = -1;
+    node->columnCount = -1;
+}
+
+void RemoteModel::touchNode(RemoteModel::Node *node) const
+{
+    if (m_lruList.lruNext == node)
+        return;
+
+    if (node->lruNext) {
+        node->lruPrev->lruNext = node->lruNext;
+        node->lruNext->lruPrev = node->lruPrev;
+    } else {
+        ++m_cachedNodeCount;
+    }
+
+    node->lruPrev = &m_lruList;
+    node->lruNext = m_lruList.lruNext;
+    m_lruList.lruNext->lruPrev = node;
+    m_lruList.lruNext = node;
+}
+
+void RemoteModel::updateCacheCost(RemoteModel::Node *node)
+{
+    if (!node->lruNext)
+        touchNode(node);
+    qint32 cost = node->columns.size() * sizeof(Cell);
+    foreach (const auto &cell, node->columns) {
+        cost += cell.roles.size() * sizeof(QPair<int, QVariant>);
+        for (auto it = cell.roles.constBegin(); it != cell.roles.constEnd(); ++it)
+            cost += estimateCost(it->second);
+    }
+
+    m_cacheSize += cost - node->cacheCost;
+    node->cacheCost = cost;
+}
+
+void RemoteModel::unlinkNode(RemoteModel::Node *node) const
+{
+    if (!node->lruNext)
+        return;
+    node->lruPrev->lruNext = node->lruNext;
+    node->lruNext->lruPrev = node->lruPrev;
+    node->lruPrev = 0;
+    node->lruNext = 0;
+    --m_cachedNodeCount;
+    m_cacheSize -= node->cacheCost;
+    node->cacheCost = 0;
+}
+
+void RemoteModel::uncacheNode(RemoteModel::Node *node) const
+{
+    uncacheChildren(node);
+    unlinkNode(node);
+    if (node->handle != Protocol::InvalidModelIndexHandle) {
+        m_handles.remove(node->handle);
+        m_handleLastUse.remove(node->handle);
+        node->handle = Protocol::InvalidModelIndexHandle;
+    }
+}
+
+void RemoteModel::uncacheChildren(RemoteModel::Node *node) const
+{
+    foreach (auto child, node->children)
+        uncacheNode(child);
+}
+
+void RemoteModel::evictCachedData(int keepCount)
+{
+    if (m_cacheBudget <= 0)
+        return;
+
+    Node *node = m_lruList.lruPrev;
+    for (int candidates = m_cachedNodeCount - keepCount;
+         m_cacheSize > m_cacheBudget && candidates > 0; --candidates) {
+        Q_ASSERT(node != &m_lruList);
+        Node *prev = node->lruPrev;
+        // evicting a node with a pending request would drop the reply and leave it loading forever
+        if (!isLoading(node)) {
+            unlinkNode(node);
+            // keep the structure, the next data() call will re-request the content
+            node->columns.clear();
+        }
+        node = prev;
+    }
+}
+
+bool RemoteModel::isLoading(RemoteModel::Node *node)
+{
+    foreach (const auto &cell, node->columns) {
+        if (cell.state() & Loading)
+            return true;
+    }
+    return false;
+}
+
+void RemoteModel::bindHandle(RemoteModel::Node *node, Protocol::ModelIndexHandle handle)
+{
+    if (node->handle == handle)
+        return;
+    if (node->handle != Protocol::InvalidModelIndexHandle) {
+        m_handles.remove(node->handle);
+        m_handleLastUse.remove(node->handle);
+    }
+    if (Node *oldNode = m_handles.value(handle))
+        oldNode->handle = Protocol::InvalidModelIndexHandle;
+    node->handle = handle;
+    m_handles.insert(handle, node);
+    touchHandle(node);
+}
+
+void RemoteModel::touchHandle(RemoteModel::Node *node) const
+{
+    m_handleLastUse.insert(node->handle, ++m_handleClock);
+}
+
+void RemoteModel::releaseHandles() const
+{
+    QVector<QPair<quint32, Protocol::ModelIndexHandle> > candidates;
+    candidates.reserve(m_handleLastUse.size());
+    for (auto it = m_handleLastUse.constBegin(); it != m_handleLastUse.constEnd(); ++it) {
+        if (it.key() != Protocol::RootModelIndexHandle)
+            candidates.push_back(qMakePair(it.value(), it.key()));
+    }
+    std::sort(candidates.begin(), candidates.end()); // least recently used first
+
+    // release a quarter at once, so we don't need to do this on every request
+    const int releaseCount = m_handles.size() - MaxIndexHandles * 3 / 4;
+    QVector<Protocol::ModelIndexHandle> released;
+    foreach (const auto &candidate, candidates) {
+        if (released.size() >= releaseCount)
+            break;
+        Node *node = m_handles.value(candidate.second);
+        Q_ASSERT(node);
+        // replies to pending requests refer to the children by the parent handle
+        bool pendingReplies = false;
+        foreach (auto child, node->children) {
+            if (isLoading(child)) {
+                pendingReplies = true;
+                break;
+            }
+        }
+        if (pendingReplies)
+            continue;
+        // on demand requests aren't tracked, their replies might not arrive anymore
+        // now, so don't leave their placeholders behind
+        foreach (auto child, node->children) {
+            for (int i = 0; i < child->columns.size(); ++i)
+                child->columns[i].removeOnDemandPlaceholders();
+        }
+        m_handles.remove(node->handle);
+        m_handleLastUse.remove(node->handle);
+        released.push_back(node->handle);
+        node->handle = Protocol::InvalidModelIndexHandle;
+    }
+    if (released.isEmpty())
+        return;
+
+    Message msg(m_myAddress, Protocol::ModelIndexHandleRelease);
+    msg << released;
+    sendMessage(msg);
+}
+
+void RemoteModel::reportCacheStatistics() const
+{
+    auto client = qobject_cast<Client *>(Endpoint::instance());
+    if (client && isConnected())
+        client->setCacheStatistics(m_myAddress, m_cacheSize, m_cacheHits, m_cacheMisses);
+}
+
 void RemoteModel::doInsertRows(RemoteModel::Node *parentNode, int first, int last)
 {
     Q_ASSERT(parentNode->rowCount == parentNode->children.size());
@@ -822,11 +1305,8 @@ void RemoteModel::doInsertRows(RemoteModel::Node *parentNode, int first, int las
     parentNode->children.insert(first, last - first + 1, 0);
 
     // create nodes for the new rows
-    for (int i = first; i <= last; ++i) {
-        Node *child = new Node;
-        child->parent = parentNode;
-        parentNode->children[i] = child;
-    }
+    for (int i = first; i <= last; ++i)
+        parentNode->children[i] = m_nodePool.create(parentNode);
 
     // adjust row count
     parentNode->rowCount += last - first + 1;
@@ -848,8 +1328,10 @@ void RemoteModel::doRemoveRows(RemoteModel::Node *parentNode, int first, int las
         m_verticalHeaders.remove(first, last - first + 1);
 
     // delete nodes
-    for (int i = first; i <= last; ++i)
-        delete parentNode->children.at(i);
+    for (int i = first; i <= last; ++i) {
+        uncacheNode(parentNode->children.at(i));
+        m_nodePool.destroy(parentNode->children.at(i));
+    }
     parentNode->children.remove(first, last - first + 1);
 
     // adjust row count
@@ -920,9 +1402,8 @@ void RemoteModel::doInsertColumns(RemoteModel::Node *parentNode, int first, int
             continue;
 
         // allocate new columns
-        node->data.insert(first, newColCount, QHash<int, QVariant>());
-        node->flags.insert(first, newColCount, Qt::ItemIsSelectable | Qt::ItemIsEnabled);
-        node->state.insert(first, newColCount, Empty | Outdated);
+        node->columns.insert(first, newColCount, Cell());
+        updateCacheCost(node);
     }
 
     // adjust column count
@@ -945,9 +1426,8 @@ void RemoteModel::doRemoveColumns(RemoteModel::Node *parentNode, int first, int
     foreach (auto node, parentNode->children) {
         if (!node->hasColumnData())
             continue;
-        node->data.remove(first, delColCount);
-        node->flags.remove(first, delColCount);
-        node->state.remove(first, delColCount);
+        node->columns.remove(first, delColCount);
+        updateCacheCost(node);
     }
 
     // adjust column count
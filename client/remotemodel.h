@@ -34,6 +34,8 @@
 #include <common/protocol.h>
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QMap>
 #include <QRegExp>
 #include <QSet>
 #include <QTimer>
@@ -61,6 +63,20 @@ public:
 
     bool isConnected() const;
 
+    /** Returns the memory budget in bytes for cached item data. */
+    qint64 cacheBudget() const;
+    /** Limits the memory used for cached item data to roughly @p bytes.
+     *  Item data of the least recently used rows is evicted first and re-requested on demand,
+     *  the tree structure is retained. A value <= 0 disables eviction.
+     */
+    void setCacheBudget(qint64 bytes);
+
+    /** Returns whether content requests address cells by server-assigned parent handles,
+     *  rather than by their full index path.
+     */
+    bool useIndexHandles() const;
+    void setUseIndexHandles(bool useHandles);
+
     QModelIndex index(int row, int column,
                       const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
     QModelIndex parent(const QModelIndex &child) const Q_DECL_OVERRIDE;
@@ -98,17 +114,49 @@ signals:
     void proxyFilterRegExpChanged();
 
 private:
+    /** Compact storage of a single cell.
+     *  Role data is kept sorted by role, flags and state are packed into a single word.
+     */
+    struct Cell {
+        Cell();
+        QVariant value(int role) const;
+        bool hasValue(int role) const;
+        void setValue(int role, const QVariant &value);
+        void setItemData(const QMap<int, QVariant> &itemData);
+        /// drops on demand roles without a value, so they get requested again
+        void removeOnDemandPlaceholders();
+
+        Qt::ItemFlags flags() const
+        {
+            return Qt::ItemFlags(flagsAndState & 0xffff);
+        }
+        void setFlags(Qt::ItemFlags flags)
+        {
+            flagsAndState = (flagsAndState & 0xffff0000) | (quint32(flags) & 0xffff);
+        }
+        NodeStates state() const
+        {
+            return NodeStates(flagsAndState >> 16);
+        }
+        void setState(NodeStates state)
+        {
+            flagsAndState = (flagsAndState & 0xffff) | (quint32(state) << 16);
+        }
+
+        QVector<QPair<int, QVariant> > roles; // sorted by role
+        quint32 flagsAndState;
+    };
+
     struct Node { // represents one row
         Node()
             : parent(0)
+            , lruPrev(0)
+            , lruNext(0)
             , rowCount(-1)
-            , columnCount(-1) {}
-        ~Node();
+            , columnCount(-1)
+            , cacheCost(0)
+            , handle(Protocol::InvalidModelIndexHandle) {}
         Q_DISABLE_COPY(Node)
-        // delete all cached children data, but assume row/column count on this level is still accurate
-        void clearChildrenData();
-        // forget everything we know about our children, including row/column counts
-        void clearChildrenStructure();
 
         // resize the initialize the column vectors
         void allocateColumns();
@@ -116,14 +164,42 @@ private:
         bool hasColumnData() const;
 
         Node *parent;
+        // position in the cache LRU list, only set for nodes with column data
+        Node *lruPrev;
+        Node *lruNext;
         QVector<Node *> children;
         qint32 rowCount;
         qint32 columnCount;
-        QVector<QHash<int, QVariant> > data; // column -> role -> data
-        QVector<Qt::ItemFlags> flags;      // column -> flags
-        QVector<NodeStates> state;         // column -> state (cache outdated, waiting for data, etc)
+        qint32 cacheCost; // estimated size of the column data in bytes
+        Protocol::ModelIndexHandle handle; // server-side handle when used as parent
+        QVector<Cell> columns; // data, flags and state (cache outdated, waiting for data, etc)
+    };
+
+    /** Allocates nodes in chunks, avoiding one heap allocation per row. */
+    class NodePool
+    {
+    public:
+        NodePool();
+        ~NodePool();
+
+        Node *create(Node *parent);
+        /// destroys @p node and all its descendants
+        void destroy(Node *node);
+        /// memory allocated for nodes, excluding their children and column vectors
+        qint64 memoryUsage() const;
+
+    private:
+        Q_DISABLE_COPY(NodePool)
+        QVector<Node *> m_chunks;
+        Node *m_freeList;
+        int m_chunkFill;
     };
 
+    // delete all cached children data, but assume row/column count on this level is still accurate
+    void clearChildrenData(Node *node);
+    // forget everything we know about our children, including row/column counts
+    void clearChildrenStructure(Node *node);
+
     void clear();
     void connectToServer();
 
@@ -140,12 +216,37 @@ private:
 
     void requestRowColumnCount(const QModelIndex &index) const;
     void requestDataAndFlags(const QModelIndex &index) const;
+    /// fetches @p role of an already loaded cell, see Protocol::isOnDemandRole
+    void requestOnDemandRole(const QModelIndex &index, int role) const;
+    void queueDataRequest(Node *node, const QModelIndex &index, int role) const;
     void requestHeaderData(Qt::Orientation orientation, int section) const;
     /// Reset the loading state for all rows at @p startRow or later.
     /// This is needed when rows have been added or removed before @p startRow, since
     /// pending replies might have a wrong index.
     void resetLoadingState(Node *node, int startRow) const;
 
+    /// mark @p node as most recently used, and account for its current cache cost
+    void touchNode(Node *node) const;
+    /// recompute the cache cost of @p node after its column data changed
+    void updateCacheCost(Node *node);
+    /// remove @p node and all its descendants from the cache accounting and the handle table
+    void uncacheNode(Node *node) const;
+    /// remove all descendants of @p node from the cache accounting
+    void uncacheChildren(Node *node) const;
+    /// remove @p node from the LRU list, without touching its column data
+    void unlinkNode(Node *node) const;
+    /// drop column data of least recently used nodes until we are within budget,
+    /// while retaining the @p keepCount most recently used ones and those waiting for content
+    void evictCachedData(int keepCount);
+    /// @c true if content for any column of @p node has been requested but not received yet
+    static bool isLoading(Node *node);
+    void reportCacheStatistics() const;
+    void bindHandle(Node *node, Protocol::ModelIndexHandle handle);
+    /// mark the handle of @p node as recently used
+    void touchHandle(Node *node) const;
+    /// tell the server to drop the least recently used handles once we hold too many
+    void releaseHandles() const;
+
     /// execute a insertRows() operation
     void doInsertRows(Node *parentNode, int first, int last);
     /// execute a removeRows() operation
@@ -173,14 +274,38 @@ private slots:
     void doRequestDataAndFlags() const;
 
 private:
+    NodePool m_nodePool;
     Node *m_root;
 
     mutable QVector<QHash<int, QVariant> > m_horizontalHeaders; // section -> role -> data
     mutable QVector<QHash<int, QVariant> > m_verticalHeaders; // section -> role -> data
 
-    mutable QVector<Protocol::ModelIndex> m_pendingDataRequests;
+    struct DataRequest {
+        Protocol::ModelIndexHandle parentHandle;
+        qint32 row;
+        qint32 column;
+        qint32 role; // on demand role, -1 for the full content
+        Protocol::ModelIndex parentPath; // only set without a parent handle
+    };
+    mutable QVector<DataRequest> m_pendingDataRequests;
     QTimer *m_pendingDataRequestsTimer;
 
+    // sentinel of the circular LRU list of nodes with column data, most recently used first
+    mutable Node m_lruList;
+    mutable qint64 m_cacheSize;
+    mutable int m_cachedNodeCount;
+    qint64 m_cacheBudget;
+    mutable qint64 m_cacheHits;
+    mutable qint64 m_cacheMisses;
+
+    mutable QHash<Protocol::ModelIndexHandle, Node *> m_handles;
+    // handle -> value of m_handleClock when last used in a request
+    mutable QHash<Protocol::ModelIndexHandle, quint32> m_handleLastUse;
+    mutable quint32 m_handleClock;
+    // icons transferred by the server, referenced by id in content replies
+    QHash<quint32, QVariant> m_icons;
+    bool m_useIndexHandles;
+
     QString m_serverObject;
     Protocol::ObjectAddress m_myAddress;
 
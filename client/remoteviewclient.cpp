@@ -90,3 +90,8 @@ void RemoteViewClient::clientViewUpdated()
 {
     Endpoint::instance()->invokeObject(name(), "clientViewUpdated");
 }
+
+void RemoteViewClient::setClientViewport(const QRectF &viewport, double zoom)
+{
+    Endpoint::instance()->invokeObject(name(), "setClientViewport", QVariantList() << viewport << zoom);
+}
@@ -49,6 +49,7 @@ public:
                         int modifiers) Q_DECL_OVERRIDE;
     void setViewActive(bool active) Q_DECL_OVERRIDE;
     void clientViewUpdated() Q_DECL_OVERRIDE;
+    void setClientViewport(const QRectF &viewport, double zoom) Q_DECL_OVERRIDE;
 };
 }
 
@@ -0,0 +1,89 @@
+/*
+  sharedmemoryclientdevice.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemoryclientdevice.h"
+
+#include <QLocalSocket>
+
+using namespace GammaRay;
+
+SharedMemoryClientDevice::SharedMemoryClientDevice(QObject *parent)
+    : ClientDeviceImpl<SharedMemoryDevice>(parent)
+    , m_attached(false)
+{
+    m_socket = new SharedMemoryDevice(this);
+    connect(m_socket, SIGNAL(connected()), this, SLOT(socketAttached()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+}
+
+void SharedMemoryClientDevice::connectToHost()
+{
+    m_socket->connectToServer(m_serverAddress.path());
+    connect(m_socket->localSocket(), SIGNAL(error(QLocalSocket::LocalSocketError)),
+            this, SLOT(socketError()), Qt::UniqueConnection);
+}
+
+void SharedMemoryClientDevice::disconnectFromHost()
+{
+    m_socket->disconnectFromServer();
+}
+
+void SharedMemoryClientDevice::socketError()
+{
+    switch (m_socket->localSocket()->error()) {
+    case QLocalSocket::ConnectionRefusedError:
+    case QLocalSocket::ServerNotFoundError:
+    case QLocalSocket::SocketAccessError:
+    case QLocalSocket::SocketTimeoutError:
+    case QLocalSocket::ConnectionError:
+    case QLocalSocket::UnknownSocketError:
+        emit transientError();
+        break;
+    default:
+        if (m_tries) {
+            --m_tries;
+            emit transientError();
+        } else {
+            emit persistentError(m_socket->localSocket()->errorString());
+        }
+        break;
+    }
+}
+
+void SharedMemoryClientDevice::socketAttached()
+{
+    m_attached = true;
+    emit connected();
+}
+
+void SharedMemoryClientDevice::socketDisconnected()
+{
+    // connection closed during the handshake, the segment could not be created or attached
+    if (!m_attached)
+        emit persistentError(m_socket->errorString());
+}
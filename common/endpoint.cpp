@@ -28,14 +28,68 @@
 
 #include "endpoint.h"
 #include "message.h"
+#include "messagecompressor.h"
 #include "methodargument.h"
 #include "propertysyncer.h"
 
+#include <QIODevice>
+#include <QThread>
+
+#include <cstring>
 #include <iostream>
 
 using namespace GammaRay;
 using namespace std;
 
+static const int InitialBufferSize = 64 * 1024;
+// above this we write immediately rather than waiting for the end of the event loop iteration,
+// and release the buffer memory again once it is empty
+static const int MaxBufferSize = 1024 * 1024;
+
+namespace GammaRay {
+/** Delivers a message to a handler living in another thread, from within that thread. */
+class QueuedMessageDelivery : public QObject
+{
+    Q_OBJECT
+public:
+    QueuedMessageDelivery(QObject *receiver, const QMetaMethod &handler, const Message &msg)
+        : m_receiver(receiver)
+        , m_handler(handler)
+        , m_msg(msg.detached())
+    {
+    }
+
+    const Message &message() const
+    {
+        return m_msg;
+    }
+
+public slots:
+    void deliver()
+    {
+        if (m_receiver)
+            m_handler.invoke(m_receiver, Qt::DirectConnection, Q_ARG(GammaRay::Message, m_msg));
+        deleteLater();
+    }
+
+private:
+    QPointer<QObject> m_receiver;
+    QMetaMethod m_handler;
+    Message m_msg;
+};
+}
+
+/** Empties @p buffer, keeping its allocation unless that grew excessively. */
+static void resetBuffer(QByteArray &buffer)
+{
+    if (buffer.capacity() > MaxBufferSize) {
+        buffer = QByteArray();
+        buffer.reserve(InitialBufferSize);
+    } else {
+        buffer.resize(0);
+    }
+}
+
 Endpoint *Endpoint::s_instance = 0;
 
 Endpoint::Endpoint(QObject *parent)
@@ -43,6 +97,13 @@ Endpoint::Endpoint(QObject *parent)
     , m_propertySyncer(new PropertySyncer(this))
     , m_socket(0)
     , m_myAddress(Protocol::InvalidObjectAddress +1)
+    , m_flushPending(false)
+    , m_readOffset(0)
+    , m_readDepth(0)
+    , m_compressor(0)
+    , m_decompressor(0)
+    , m_lastWriteProgress(0)
+    , m_imageEncodings(0)
 {
     if (s_instance)
         qCritical(
@@ -62,6 +123,10 @@ Endpoint::Endpoint(QObject *parent)
 
 Endpoint::~Endpoint()
 {
+    flushWriteBuffer();
+    delete m_compressor;
+    delete m_decompressor;
+
     for (QHash<Protocol::ObjectAddress, ObjectInfo *>::const_iterator it =
              m_addressMap.constBegin();
          it != m_addressMap.constEnd(); ++it)
@@ -91,11 +156,47 @@ void Endpoint::sendMessage(const Message &msg)
 void Endpoint::doSendMessage(const GammaRay::Message &msg)
 {
     Q_ASSERT(msg.address() != Protocol::InvalidObjectAddress);
-    msg.write(m_socket);
+    // pending property changes must not be overtaken by anything sent after them,
+    // this sends them through here first (and is a no-op for the syncer's own messages)
+    m_propertySyncer->flushPropertyChanges();
+    msg.write(m_writeBuffer, m_compressor);
+
+    if (m_writeBuffer.size() >= MaxBufferSize) {
+        flushWriteBuffer();
+    } else if (!m_flushPending) {
+        m_flushPending = true;
+        QMetaObject::invokeMethod(this, "flushWriteBuffer", Qt::QueuedConnection);
+    }
+}
+
+void Endpoint::flushWriteBuffer()
+{
+    m_flushPending = false;
+    if (m_writeBuffer.isEmpty())
+        return;
+
+    if (m_socket) {
+        if (m_compressor && m_socket->bytesToWrite() == 0) // link was idle so far
+            m_lastWriteProgress = m_linkTimer.nsecsElapsed();
+        const qint64 s = m_socket->write(m_writeBuffer);
+        Q_ASSERT(s == m_writeBuffer.size());
+        Q_UNUSED(s);
+    }
+    resetBuffer(m_writeBuffer);
+}
+
+void Endpoint::socketBytesWritten(qint64 bytes)
+{
+    if (!m_compressor)
+        return;
+    const qint64 now = m_linkTimer.nsecsElapsed();
+    m_compressor->addLinkSample(bytes, now - m_lastWriteProgress);
+    m_lastWriteProgress = now;
 }
 
 void Endpoint::waitForMessagesWritten()
 {
+    flushWriteBuffer();
     m_socket->waitForBytesWritten(-1);
 }
 
@@ -119,7 +220,18 @@ void Endpoint::setDevice(QIODevice *device)
     Q_ASSERT(!m_socket);
     Q_ASSERT(device);
     m_socket = device;
+    resetBuffer(m_writeBuffer);
+    resetBuffer(m_readBuffer);
+    m_readBuffer.reserve(InitialBufferSize);
+    m_writeBuffer.reserve(InitialBufferSize);
+    m_readOffset = 0;
+    setCompression(Protocol::NoCompression);
+    m_imageEncodings = 0;
+    delete m_decompressor;
+    m_decompressor = new MessageDecompressor;
+    m_linkTimer.start();
     connect(m_socket.data(), SIGNAL(readyRead()), SLOT(readyRead()));
+    connect(m_socket.data(), SIGNAL(bytesWritten(qint64)), SLOT(socketBytesWritten(qint64)));
     connect(m_socket.data(), SIGNAL(disconnected()), SLOT(connectionClosed()));
     if (m_socket->bytesAvailable())
         readyRead();
@@ -130,15 +242,102 @@ Protocol::ObjectAddress Endpoint::endpointAddress() const
     return m_myAddress;
 }
 
+Protocol::Compression Endpoint::compression() const
+{
+    return m_compressor ? Protocol::LZ4StreamCompression : Protocol::NoCompression;
+}
+
+void Endpoint::setCompression(Protocol::Compression compression)
+{
+    if (compression == this->compression())
+        return;
+
+    // the stream has to start with the compressor, messages written so far are not part of it
+    flushWriteBuffer();
+    delete m_compressor;
+    m_compressor = compression == Protocol::LZ4StreamCompression ? new MessageCompressor : 0;
+}
+
+quint8 Endpoint::imageEncodings() const
+{
+    return m_imageEncodings;
+}
+
+void Endpoint::setImageEncodings(quint8 encodings)
+{
+    m_imageEncodings = encodings;
+}
+
 void Endpoint::readyRead()
 {
-    while (Message::canReadMessage(m_socket.data()))
-        messageReceived(Message::readMessage(m_socket.data()));
+    if (!m_socket)
+        return;
+
+    // When called from a nested event loop inside a message handler the receive buffer is
+    // still referenced by the messages further up the stack. We drain what is buffered already
+    // without modifying the buffer, and read the rest directly unless we are in the middle of
+    // a partially buffered message.
+    if (m_readDepth > 0) {
+        dispatchBufferedMessages();
+        if (m_readOffset < m_readBuffer.size())
+            return;
+        while (m_socket && Message::canReadMessage(m_socket.data()))
+            messageReceived(Message::readMessage(m_socket.data(), m_decompressor));
+        return;
+    }
+
+    while (m_socket && m_socket->bytesAvailable() > 0) {
+        // move the incomplete message at the end to the front, this happens at most once per message
+        if (m_readOffset > 0) {
+            const int remaining = m_readBuffer.size() - m_readOffset;
+            if (remaining > 0)
+                memmove(m_readBuffer.data(), m_readBuffer.constData() + m_readOffset, remaining);
+            m_readBuffer.resize(remaining);
+            m_readOffset = 0;
+        }
+
+        const int oldSize = m_readBuffer.size();
+        const qint64 available = m_socket->bytesAvailable();
+        m_readBuffer.resize(oldSize + available);
+        const qint64 readSize = m_socket->read(m_readBuffer.data() + oldSize, available);
+        m_readBuffer.resize(oldSize + qMax<qint64>(0, readSize));
+        if (readSize <= 0)
+            break;
+
+        dispatchBufferedMessages();
+    }
+
+    if (!m_socket || m_readOffset == m_readBuffer.size()) {
+        resetBuffer(m_readBuffer);
+        m_readOffset = 0;
+    }
+}
+
+void Endpoint::dispatchBufferedMessages()
+{
+    ++m_readDepth;
+    while (m_socket) {
+        const char *frame = m_readBuffer.constData() + m_readOffset;
+        const int frameSize = Message::frameSize(frame, m_readBuffer.size() - m_readOffset);
+        if (!frameSize)
+            break;
+        m_readOffset += frameSize;
+        messageReceived(Message::readMessage(frame, m_decompressor));
+    }
+    --m_readDepth;
 }
 
 void Endpoint::connectionClosed()
 {
     m_socket = 0;
+    m_flushPending = false;
+    resetBuffer(m_writeBuffer);
+    setCompression(Protocol::NoCompression);
+    m_imageEncodings = 0;
+    if (m_readDepth == 0) { // otherwise still in use, readyRead() cleans up
+        resetBuffer(m_readBuffer);
+        m_readOffset = 0;
+    }
     emit disconnected();
 }
 
@@ -303,13 +502,21 @@ void Endpoint::dispatchMessage(const Message &msg)
     }
 
     ObjectInfo *obj = it.value();
-    if (msg.type() == Protocol::MethodCall) {
+
+    // the payload can point into the receive buffer, which is reused once we return, and
+    // Message can't be queued, so a handler in another thread gets its own copy delivered
+    QueuedMessageDelivery *delivery = 0;
+    if (obj->receiver && obj->receiver->thread() != QThread::currentThread())
+        delivery = new QueuedMessageDelivery(obj->receiver, obj->messageHandler, msg);
+    const Message &m = delivery ? delivery->message() : msg;
+
+    if (m.type() == Protocol::MethodCall) {
         QByteArray method;
-        msg >> method;
+        m >> method;
         if (obj->object) {
             Q_ASSERT(!method.isEmpty());
             QVariantList args;
-            msg >> args;
+            m >> args;
 
             invokeObjectLocal(obj->object, method.constData(), args);
         } else {
@@ -319,11 +526,15 @@ void Endpoint::dispatchMessage(const Message &msg)
         }
     }
 
-    if (obj->receiver)
-        obj->messageHandler.invoke(obj->receiver, Q_ARG(GammaRay::Message, msg));
+    if (delivery) {
+        delivery->moveToThread(obj->receiver->thread());
+        QMetaObject::invokeMethod(delivery, "deliver", Qt::QueuedConnection);
+    } else if (obj->receiver) {
+        obj->messageHandler.invoke(obj->receiver, Q_ARG(GammaRay::Message, m));
+    }
 
-    if (!obj->receiver && (msg.type() != Protocol::MethodCall || !obj->object)) {
-        cerr << "Cannot dispatch message " << quint64(msg.type()) << " - no handler registered."
+    if (!obj->receiver && (m.type() != Protocol::MethodCall || !obj->object)) {
+        cerr << "Cannot dispatch message " << quint64(m.type()) << " - no handler registered."
              << " Receiver: " << qPrintable(obj->name) << ", address " << quint64(obj->address)
              << endl;
     }
@@ -385,3 +596,5 @@ void Endpoint::setLabel(const QString &label)
 {
     m_label = label;
 }
+
+#include "endpoint.moc"
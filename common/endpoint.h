@@ -32,6 +32,7 @@
 #include "gammaray_common_export.h"
 #include "protocol.h"
 
+#include <QElapsedTimer>
 #include <QMetaMethod>
 #include <QObject>
 #include <QPointer>
@@ -43,6 +44,8 @@ QT_END_NAMESPACE
 
 namespace GammaRay {
 class Message;
+class MessageCompressor;
+class MessageDecompressor;
 class PropertySyncer;
 
 /** @brief Network protocol endpoint.
@@ -96,6 +99,11 @@ public:
      */
     void waitForMessagesWritten();
 
+    /** Protocol::ImageEncoding flags for remote view images the other endpoint accepts
+     *  on the current connection.
+     */
+    quint8 imageEncodings() const;
+
     /**
      * Returns a human-readable string describing the host program.
      */
@@ -118,6 +126,8 @@ public:
     virtual QUrl serverAddress() const = 0;
 
     /** Register the slot @p messageHandlerName on @p receiver as the handler for messages to/from @p objectAddress.
+     *  If @p receiver lives in another thread than the endpoint, messages are delivered to it
+     *  asynchronously via its event loop.
      *  @see dispatchMessage()
      */
     virtual void registerMessageHandler(Protocol::ObjectAddress objectAddress, QObject *receiver,
@@ -146,6 +156,13 @@ protected:
     /** The object address of the other endpoint. */
     Protocol::ObjectAddress endpointAddress() const;
 
+    /** Compression method for outgoing messages on the current connection.
+     *  Incoming messages are decompressed as needed independent of this.
+     */
+    Protocol::Compression compression() const;
+    void setCompression(Protocol::Compression compression);
+    void setImageEncodings(quint8 encodings);
+
     /** Called for every incoming message.
      *  @see dispatchMessage().
      */
@@ -189,6 +206,10 @@ protected:
 private slots:
     void readyRead();
     void connectionClosed();
+    /** Writes all messages batched up since the last event loop iteration in one go. */
+    void flushWriteBuffer();
+    /** Measures link throughput, to decide whether compression is worth it. */
+    void socketBytesWritten(qint64 bytes);
     void handlerDestroyed(QObject *obj);
     void objectDestroyed(QObject *obj);
 
@@ -217,6 +238,9 @@ private:
     /** Removes @p oi from all maps and destroys it. */
     void removeObjectInfo(ObjectInfo *oi);
 
+    /** Dispatches all complete messages in the receive buffer, without copying their payload. */
+    void dispatchBufferedMessages();
+
     QHash<QString, ObjectInfo *> m_nameMap;
     QHash<Protocol::ObjectAddress, ObjectInfo *> m_addressMap;
     QHash<QObject *, ObjectInfo *> m_objectMap;
@@ -225,6 +249,22 @@ private:
     QPointer<QIODevice> m_socket;
     Protocol::ObjectAddress m_myAddress;
 
+    // framed outgoing messages, written once per event loop iteration
+    QByteArray m_writeBuffer;
+    bool m_flushPending;
+    // incoming data, messages are parsed in place starting at m_readOffset
+    QByteArray m_readBuffer;
+    int m_readOffset;
+    // > 0 while messages from m_readBuffer are being dispatched
+    int m_readDepth;
+
+    // per-connection compression state, m_compressor is null if we don't compress
+    MessageCompressor *m_compressor;
+    MessageDecompressor *m_decompressor;
+    QElapsedTimer m_linkTimer;
+    qint64 m_lastWriteProgress;
+    quint8 m_imageEncodings;
+
     QString m_label;
 };
 }
@@ -28,43 +28,17 @@
 
 #include "message.h"
 
-#include "lz4/lz4.h" // 3rdparty
+#include "messagecompressor.h"
 
 #include <QDebug>
 #include <qendian.h>
 
-inline QByteArray compress(const QByteArray &src)
-{
-    const qint32 srcSz = src.size();
-
-    QByteArray dst;
-    dst.resize(LZ4_compressBound(srcSz + sizeof(srcSz)));
-    *(qint32 *)dst.data() = srcSz; // save the source size
-
-    const int sz
-        = LZ4_compress_default(src.constData(), dst.data() + sizeof(int), srcSz, dst.size());
-    dst.resize(sz + sizeof(srcSz));
-    return dst;
-}
-
-inline QByteArray uncompress(const QByteArray &src)
-{
-    const qint32 dstSz = *(const qint32 *)src.constData(); // get the dest size
-    QByteArray dst;
-    dst.resize(dstSz);
-    const int sz = LZ4_decompress_safe(src.constData() + sizeof(dstSz), dst.data(),
-                                       src.size()- sizeof(dstSz), dstSz);
-    if (sz <= 0)
-        dst.resize(0);
-    else
-        dst.resize(sz);
-    return dst;
-}
+#include <cstring>
 
 static const QDataStream::Version StreamVersion = QDataStream::Qt_4_7;
-#ifdef ENABLE_MESSAGE_COMPRESSSION
-static const int minimumUncompressedSize = 32;
-#endif
+static const int HeaderSize = sizeof(GammaRay::Protocol::PayloadSize)
+                              + sizeof(GammaRay::Protocol::ObjectAddress)
+                              + sizeof(GammaRay::Protocol::MessageType);
 
 #if QT_VERSION < 0x040800
 // This template-specialization is missing in qendian.h, required for qFromBigEndian
@@ -84,25 +58,36 @@ template<typename T> static T readNumber(QIODevice *device)
     return qFromBigEndian(buffer);
 }
 
-template<typename T> static void writeNumber(QIODevice *device, T value)
+using namespace GammaRay;
+
+static QByteArray decompressPayload(const char *data, int size, MessageDecompressor *decompressor,
+                                    qint64 *compressionTime)
 {
-    value = qToBigEndian(value);
-    const int writeSize = device->write((char *)&value, sizeof(T));
-    Q_UNUSED(writeSize);
-    Q_ASSERT(writeSize == sizeof(T));
+    QByteArray payload;
+    if (decompressor) {
+        decompressor->decompress(data, size, payload);
+        *compressionTime = decompressor->lastDecompressionTime();
+    } else { // not part of a compressed connection, so this can only be an independent block
+        MessageDecompressor independentDecompressor;
+        independentDecompressor.decompress(data, size, payload);
+        *compressionTime = independentDecompressor.lastDecompressionTime();
+    }
+    return payload;
 }
 
-using namespace GammaRay;
-
 Message::Message()
     : m_objectAddress(Protocol::InvalidObjectAddress)
     , m_messageType(Protocol::InvalidMessageType)
+    , m_transferSize(0)
+    , m_compressionTime(0)
 {
 }
 
 Message::Message(Protocol::ObjectAddress objectAddress, Protocol::MessageType type)
     : m_objectAddress(objectAddress)
     , m_messageType(type)
+    , m_transferSize(0)
+    , m_compressionTime(0)
 {
 }
 
@@ -111,6 +96,8 @@ Message::Message(Message &&other)
     : m_buffer(std::move(other.m_buffer))
     , m_objectAddress(other.m_objectAddress)
     , m_messageType(other.m_messageType)
+    , m_transferSize(other.m_transferSize)
+    , m_compressionTime(other.m_compressionTime)
 {
     m_stream.swap(other.m_stream);
 }
@@ -145,9 +132,7 @@ QDataStream &Message::payload() const
 
 bool Message::canReadMessage(QIODevice *device)
 {
-    static const int minimumSize = sizeof(Protocol::PayloadSize) + sizeof(Protocol::ObjectAddress)
-                                   + sizeof(Protocol::MessageType);
-    if (device->bytesAvailable() < minimumSize)
+    if (device->bytesAvailable() < HeaderSize)
         return false;
 
     Protocol::PayloadSize payloadSize;
@@ -159,10 +144,10 @@ bool Message::canReadMessage(QIODevice *device)
         return false;
 
     payloadSize = abs(qFromBigEndian(payloadSize));
-    return device->bytesAvailable() >= payloadSize + minimumSize;
+    return device->bytesAvailable() >= payloadSize + HeaderSize;
 }
 
-Message Message::readMessage(QIODevice *device)
+Message Message::readMessage(QIODevice *device, MessageDecompressor *decompressor)
 {
     Message msg;
 
@@ -175,54 +160,110 @@ Message Message::readMessage(QIODevice *device)
     if (payloadSize < 0) {
         payloadSize = abs(payloadSize);
         QByteArray buff = device->read(payloadSize);
-        msg.m_buffer = uncompress(buff);
         Q_ASSERT(payloadSize == buff.size());
+        msg.m_buffer = decompressPayload(buff.constData(), buff.size(), decompressor,
+                                         &msg.m_compressionTime);
     } else {
         if (payloadSize > 0) {
             msg.m_buffer = device->read(payloadSize);
             Q_ASSERT(payloadSize == msg.m_buffer.size());
         }
     }
+    msg.m_transferSize = payloadSize;
     return msg;
 }
 
 void Message::write(QIODevice *device) const
 {
-    Q_ASSERT(m_objectAddress != Protocol::InvalidObjectAddress);
-    Q_ASSERT(m_messageType != Protocol::InvalidMessageType);
-    const int buffSize = m_buffer.size();
-#ifdef ENABLE_MESSAGE_COMPRESSSION
-    QByteArray buff;
-    if (buffSize > minimumUncompressedSize)
-        buff = compress(m_buffer);
-
-    if (buff.size() && buff.size() < buffSize)
-        writeNumber<Protocol::PayloadSize>(device, -buff.size()); // send compressed Buffer
-    else
-#endif
-    writeNumber<Protocol::PayloadSize>(device, buffSize);   // send uncompressed Buffer
-
-    writeNumber(device, m_objectAddress);
-    writeNumber(device, m_messageType);
-
-#ifdef ENABLE_MESSAGE_COMPRESSSION
-    if (buffSize) {
-        if (buff.size() && buff.size() < buffSize) {
-            const int s = device->write(buff);
-            Q_ASSERT(s == buff.size());
-            Q_UNUSED(s);
-        } else {
-#endif
-    const int s = device->write(m_buffer);
-    Q_ASSERT(s == m_buffer.size());
+    QByteArray frame;
+    write(frame);
+    const int s = device->write(frame);
+    Q_ASSERT(s == frame.size());
     Q_UNUSED(s);
-#ifdef ENABLE_MESSAGE_COMPRESSSION
 }
+
+int Message::frameSize(const char *data, int size)
+{
+    if (size < HeaderSize)
+        return 0;
+
+    Protocol::PayloadSize payloadSize
+        = qFromBigEndian<Protocol::PayloadSize>(reinterpret_cast<const uchar *>(data));
+    if (payloadSize == -1) // input end on shared memory, never a valid compressed payload size
+        return 0;
+
+    payloadSize = abs(payloadSize);
+    if (size - HeaderSize < payloadSize)
+        return 0;
+    return HeaderSize + payloadSize;
 }
-#endif
+
+Message Message::readMessage(const char *data, MessageDecompressor *decompressor)
+{
+    Message msg;
+
+    const uchar *header = reinterpret_cast<const uchar *>(data);
+    const Protocol::PayloadSize payloadSize = qFromBigEndian<Protocol::PayloadSize>(header);
+    msg.m_objectAddress
+        = qFromBigEndian<Protocol::ObjectAddress>(header + sizeof(Protocol::PayloadSize));
+    msg.m_messageType = header[HeaderSize - 1];
+    Q_ASSERT(msg.m_messageType != Protocol::InvalidMessageType);
+    Q_ASSERT(msg.m_objectAddress != Protocol::InvalidObjectAddress);
+
+    if (payloadSize < 0)
+        msg.m_buffer = decompressPayload(data + HeaderSize, -payloadSize, decompressor,
+                                         &msg.m_compressionTime);
+    else if (payloadSize > 0)
+        msg.m_buffer = QByteArray::fromRawData(data + HeaderSize, payloadSize);
+    msg.m_transferSize = abs(payloadSize);
+    return msg;
+}
+
+Message Message::detached() const
+{
+    Message msg(m_objectAddress, m_messageType);
+    msg.m_buffer = QByteArray(m_buffer.constData(), m_buffer.size());
+    msg.m_transferSize = m_transferSize;
+    msg.m_compressionTime = m_compressionTime;
+    return msg;
+}
+
+void Message::write(QByteArray &buffer, MessageCompressor *compressor) const
+{
+    Q_ASSERT(m_objectAddress != Protocol::InvalidObjectAddress);
+    Q_ASSERT(m_messageType != Protocol::InvalidMessageType);
+
+    const int offset = buffer.size();
+    buffer.resize(offset + HeaderSize);
+    Protocol::PayloadSize sizeField;
+    if (compressor && compressor->compress(m_buffer.constData(), m_buffer.size(), buffer)) {
+        m_transferSize = buffer.size() - offset - HeaderSize;
+        m_compressionTime = compressor->lastCompressionTime();
+        sizeField = -m_transferSize;
+    } else {
+        buffer.append(m_buffer);
+        m_transferSize = m_buffer.size();
+        m_compressionTime = 0;
+        sizeField = m_transferSize;
+    }
+
+    uchar *header = reinterpret_cast<uchar *>(buffer.data() + offset);
+    qToBigEndian<Protocol::PayloadSize>(sizeField, header);
+    qToBigEndian<Protocol::ObjectAddress>(m_objectAddress, header + sizeof(Protocol::PayloadSize));
+    header[HeaderSize - 1] = m_messageType;
 }
 
 int Message::size() const
 {
     return m_buffer.size();
 }
+
+int Message::transferSize() const
+{
+    return m_transferSize;
+}
+
+qint64 Message::compressionTime() const
+{
+    return m_compressionTime;
+}
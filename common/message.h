@@ -34,12 +34,17 @@
 
 #include <QByteArray>
 #include <QDataStream>
+#include <QIODevice>
 
 namespace GammaRay {
+class MessageCompressor;
+class MessageDecompressor;
+
 /**
  * Single message send between client and server.
  * Binary format:
- * - sizeof(Protocol::PayloadSize) byte size of the message payload (not including the size and other fixed fields itself) in netowork byte order (big endian)
+ * - sizeof(Protocol::PayloadSize) byte size of the message payload (not including the size and other fixed fields itself) in netowork byte order (big endian),
+ *   negative for payloads compressed by MessageCompressor
  * - sizeof(Protocol::ObjectAddress) server object address (big endian)
  * - sizeof(Protocol::MessageType) command type (big endian)
  * - size bytes message payload (encoding is user defined, QDataStream provided for convenience)
@@ -108,14 +113,39 @@ public:
 
     /** Checks if there is a full message waiting in @p device. */
     static bool canReadMessage(QIODevice *device);
-    /** Read the next message from @p device. */
-    static Message readMessage(QIODevice *device);
+    /** Read the next message from @p device, compressed payloads are decoded with @p decompressor. */
+    static Message readMessage(QIODevice *device, MessageDecompressor *decompressor = 0);
 
     /** Write this message to @p device. */
     void write(QIODevice *device) const;
 
+    /** Size of the message frame at the start of @p data, including the fixed header fields.
+     *  Returns @c 0 if @p data (of @p size bytes) does not contain a complete message yet.
+     */
+    static int frameSize(const char *data, int size);
+    /** Read the message frame at the start of @p data, which has to be complete (see frameSize()).
+     *  Uncompressed payloads are not copied, @p data has to stay valid and unmodified for
+     *  the entire lifetime of the returned message.
+     */
+    static Message readMessage(const char *data, MessageDecompressor *decompressor = 0);
+    /** Returns a received message with a copy of this message's payload, which therefore no
+     *  longer depends on the buffer passed to readMessage(). Reading starts from the beginning.
+     */
+    Message detached() const;
+
+    /** Append the framed message (header and payload) to @p buffer.
+     *  The payload is compressed if @p compressor considers that worthwhile.
+     */
+    void write(QByteArray &buffer, MessageCompressor *compressor = 0) const;
+
     /** Size of the uncompressed message payload. */
     int size() const;
+    /** Size of the payload as transferred, i.e. after compression.
+     *  Only valid for received messages and messages that have been written.
+     */
+    int transferSize() const;
+    /** Time spent compressing or decompressing the payload, in nanoseconds. */
+    qint64 compressionTime() const;
 
 private:
     Message();
@@ -130,6 +160,9 @@ private:
 
     Protocol::ObjectAddress m_objectAddress;
     Protocol::MessageType m_messageType;
+
+    mutable int m_transferSize;
+    mutable qint64 m_compressionTime;
 };
 }
 
@@ -0,0 +1,330 @@
+/*
+  messagecompressor.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "messagecompressor.h"
+
+#include "lz4/lz4.h" // 3rdparty
+
+#include <QByteArray>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <qendian.h>
+
+#include <cstring>
+
+using namespace GammaRay;
+
+enum BlockMode {
+    IndependentBlock = 0,
+    StreamBlock = 1,
+    // stream data that didn't get smaller, sent as-is but still part of the dictionary
+    RawStreamBlock = 2
+};
+
+static const int BlockHeaderSize = sizeof(quint8) + sizeof(qint32);
+
+// messages up to this size go through the shared dictionary, larger ones are compressed on their own
+static const int MaxStreamBlockSize = 64 * 1024;
+// both sides keep the last 64kB of streamed data at identical positions, as LZ4 requires
+static const int RingBufferSize = 64 * 1024 + MaxStreamBlockSize;
+
+// fixed per-message cost of compressing and decompressing, in nanoseconds
+static const double CompressionOverhead = 1000.0;
+static const int MinThreshold = 16;
+// while compression is disabled, still compress every n-th message to keep the estimates current
+static const int ProbeInterval = 32;
+// weight of new samples in the moving averages
+static const double SmoothingFactor = 0.125;
+
+static double movingAverage(double average, double sample)
+{
+    return average + SmoothingFactor * (sample - average);
+}
+
+namespace GammaRay {
+struct MessageCompressorPrivate
+{
+    MessageCompressorPrivate()
+        : ringOffset(0)
+        , ratio(0.5)
+        , compressionSpeed(0.5)
+        , linkSpeed(0.0)
+        , lastTime(0)
+        , threshold(MinThreshold)
+        , skipped(0)
+        , enabled(true)
+        , adaptive(true)
+    {
+        LZ4_resetStream(&stream);
+        ring.resize(RingBufferSize);
+    }
+
+    LZ4_stream_t stream;
+    QByteArray ring;
+    int ringOffset;
+
+    // compressed size / uncompressed size
+    double ratio;
+    // in bytes per nanosecond, the link speed is 0 as long as we don't know it
+    double compressionSpeed;
+    double linkSpeed;
+    qint64 lastTime;
+    int threshold;
+    int skipped;
+    bool enabled;
+    bool adaptive;
+};
+
+struct MessageDecompressorPrivate
+{
+    MessageDecompressorPrivate()
+        : ringOffset(0)
+        , lastTime(0)
+    {
+        LZ4_setStreamDecode(&stream, 0, 0);
+        ring.resize(RingBufferSize);
+    }
+
+    LZ4_streamDecode_t stream;
+    QByteArray ring;
+    int ringOffset;
+    qint64 lastTime;
+    // literals-only LZ4 block for feeding raw stream data into the decoder
+    QByteArray literalBlock;
+};
+}
+
+MessageCompressor::MessageCompressor()
+    : d(new MessageCompressorPrivate)
+{
+}
+
+MessageCompressor::~MessageCompressor()
+{
+    delete d;
+}
+
+bool MessageCompressor::compress(const char *data, int size, QByteArray &out)
+{
+    if (d->adaptive) {
+        if (size < d->threshold)
+            return false;
+        if (!d->enabled && ++d->skipped < ProbeInterval)
+            return false;
+        d->skipped = 0;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const int offset = out.size();
+    out.resize(offset + BlockHeaderSize + LZ4_compressBound(size));
+    uchar *header = reinterpret_cast<uchar *>(out.data() + offset);
+    qToBigEndian<qint32>(size, header + 1);
+    char *dst = out.data() + offset + BlockHeaderSize;
+    const int dstSize = out.size() - offset - BlockHeaderSize;
+
+    int compressedSize;
+    if (size <= MaxStreamBlockSize) {
+        // the source has to stay in place as long as it is part of the dictionary
+        char *src = d->ring.data() + d->ringOffset;
+        memcpy(src, data, size);
+        compressedSize = LZ4_compress_fast_continue(&d->stream, src, dst, size, dstSize, 1);
+        Q_ASSERT(compressedSize > 0);
+        header[0] = StreamBlock;
+        // the data is part of the dictionary now, so the decompressor has to see it even if
+        // compression didn't help
+        if (compressedSize >= size) {
+            memcpy(dst, src, size);
+            compressedSize = size;
+            header[0] = RawStreamBlock;
+        }
+        d->ringOffset += size;
+        if (d->ringOffset >= RingBufferSize - MaxStreamBlockSize)
+            d->ringOffset = 0;
+    } else {
+        compressedSize = LZ4_compress_default(data, dst, size, dstSize);
+        Q_ASSERT(compressedSize > 0);
+        header[0] = IndependentBlock;
+    }
+    out.resize(offset + BlockHeaderSize + compressedSize);
+
+    d->lastTime = timer.nsecsElapsed();
+    if (size > 0) {
+        d->ratio = movingAverage(d->ratio, double(compressedSize + BlockHeaderSize) / size);
+        d->compressionSpeed
+            = movingAverage(d->compressionSpeed, double(size) / qMax<qint64>(1, d->lastTime));
+        updatePolicy();
+    }
+
+    if (header[0] == IndependentBlock && compressedSize >= size) {
+        out.resize(offset);
+        return false;
+    }
+    return true;
+}
+
+qint64 MessageCompressor::lastCompressionTime() const
+{
+    return d->lastTime;
+}
+
+void MessageCompressor::addLinkSample(qint64 bytes, qint64 nsecs)
+{
+    if (bytes <= 0)
+        return;
+    const double sample = double(bytes) / qMax<qint64>(1, nsecs);
+    d->linkSpeed = d->linkSpeed > 0.0 ? movingAverage(d->linkSpeed, sample) : sample;
+    updatePolicy();
+}
+
+void MessageCompressor::updatePolicy()
+{
+    if (d->linkSpeed <= 0.0) { // no idea yet, assume a slow link
+        d->enabled = true;
+        d->threshold = MinThreshold;
+        return;
+    }
+
+    // sending n bytes takes n / linkSpeed uncompressed, and
+    // overhead + n / compressionSpeed + n * ratio / linkSpeed compressed
+    const double gainPerByte = (1.0 - d->ratio) / d->linkSpeed - 1.0 / d->compressionSpeed;
+    d->enabled = gainPerByte > 0.0;
+    if (d->enabled)
+        d->threshold = int(qBound<double>(MinThreshold, CompressionOverhead / gainPerByte,
+                                          MaxStreamBlockSize));
+    else
+        d->threshold = MaxStreamBlockSize;
+}
+
+bool MessageCompressor::isAdaptive() const
+{
+    return d->adaptive;
+}
+
+void MessageCompressor::setAdaptive(bool adaptive)
+{
+    d->adaptive = adaptive;
+}
+
+bool MessageCompressor::isEnabled() const
+{
+    return d->enabled;
+}
+
+int MessageCompressor::threshold() const
+{
+    return d->threshold;
+}
+
+MessageDecompressor::MessageDecompressor()
+    : d(new MessageDecompressorPrivate)
+{
+}
+
+MessageDecompressor::~MessageDecompressor()
+{
+    delete d;
+}
+
+bool MessageDecompressor::decompress(const char *data, int size, QByteArray &out)
+{
+    if (size < BlockHeaderSize)
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const uchar *header = reinterpret_cast<const uchar *>(data);
+    const int uncompressedSize = qFromBigEndian<qint32>(header + 1);
+    const char *src = data + BlockHeaderSize;
+    const int srcSize = size - BlockHeaderSize;
+    if (uncompressedSize < 0)
+        return false;
+
+    const int offset = out.size();
+    out.resize(offset + uncompressedSize);
+    int decompressedSize = -1;
+    if (header[0] == StreamBlock && uncompressedSize <= MaxStreamBlockSize) {
+        // decode into the ring, to keep the dictionary in place for the next block
+        char *dst = d->ring.data() + d->ringOffset;
+        decompressedSize = LZ4_decompress_safe_continue(&d->stream, src, dst, srcSize,
+                                                        uncompressedSize);
+        if (decompressedSize == uncompressedSize) {
+            memcpy(out.data() + offset, dst, uncompressedSize);
+            d->ringOffset += uncompressedSize;
+            if (d->ringOffset >= RingBufferSize - MaxStreamBlockSize)
+                d->ringOffset = 0;
+        }
+    } else if (header[0] == RawStreamBlock && uncompressedSize <= MaxStreamBlockSize
+               && srcSize == uncompressedSize) {
+        // wrap the data into a block of literals, so the stream decoder keeps track of it
+        // as part of the dictionary exactly like the compressor did
+        QByteArray &block = d->literalBlock;
+        block.resize(srcSize + srcSize / 255 + 2);
+        uchar *token = reinterpret_cast<uchar *>(block.data());
+        uchar *p = token + 1;
+        if (srcSize >= 15) {
+            *token = 0xF0;
+            int remaining = srcSize - 15;
+            for (; remaining >= 255; remaining -= 255)
+                *p++ = 255;
+            *p++ = remaining;
+        } else {
+            *token = srcSize << 4;
+        }
+        memcpy(p, src, srcSize);
+        const int blockSize = p + srcSize - token;
+
+        char *dst = d->ring.data() + d->ringOffset;
+        decompressedSize = LZ4_decompress_safe_continue(&d->stream, block.constData(), dst,
+                                                        blockSize, uncompressedSize);
+        if (decompressedSize == uncompressedSize) {
+            memcpy(out.data() + offset, dst, uncompressedSize);
+            d->ringOffset += uncompressedSize;
+            if (d->ringOffset >= RingBufferSize - MaxStreamBlockSize)
+                d->ringOffset = 0;
+        }
+    } else if (header[0] == IndependentBlock) {
+        decompressedSize = LZ4_decompress_safe(src, out.data() + offset, srcSize, uncompressedSize);
+    }
+
+    d->lastTime = timer.nsecsElapsed();
+    if (decompressedSize != uncompressedSize) {
+        qWarning() << "Failed to decompress message payload, mode" << int(header[0])
+                   << "size" << uncompressedSize;
+        out.resize(offset);
+        return false;
+    }
+    return true;
+}
+
+qint64 MessageDecompressor::lastDecompressionTime() const
+{
+    return d->lastTime;
+}
@@ -0,0 +1,116 @@
+/*
+  messagecompressor.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_MESSAGECOMPRESSOR_H
+#define GAMMARAY_MESSAGECOMPRESSOR_H
+
+#include "gammaray_common_export.h"
+
+#include <QtGlobal>
+
+QT_BEGIN_NAMESPACE
+class QByteArray;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+struct MessageCompressorPrivate;
+struct MessageDecompressorPrivate;
+
+/**
+ * Streaming LZ4 compression of outgoing message payloads on one connection.
+ *
+ * Consecutive small messages share a dictionary, which matters a lot for the many small and
+ * very similar messages of e.g. the remote model protocol. Large messages are compressed
+ * independently.
+ *
+ * Whether compressing a message pays off is decided by comparing measured compression speed
+ * and ratio with the measured throughput of the connection: on a fast link compression is
+ * disabled, and the minimum message size worth compressing grows with link throughput.
+ *
+ * Compressed payload format: quint8 mode (0: independent block, 1: part of the stream,
+ * 2: part of the stream but stored uncompressed), qint32 uncompressed size (big endian),
+ * LZ4 data (or the raw data for mode 2). Streamed data that doesn't get smaller is sent
+ * in mode 2 rather than uncompressed, as it is part of the shared dictionary already.
+ */
+class GAMMARAY_COMMON_EXPORT MessageCompressor
+{
+public:
+    MessageCompressor();
+    ~MessageCompressor();
+
+    /** Appends the compressed form of the @p size bytes at @p data to @p out, if that is
+     *  expected to be faster than sending them as-is and actually makes them smaller (or
+     *  they are part of the stream dictionary already). Returns @c false otherwise, @p out
+     *  is not changed then.
+     */
+    bool compress(const char *data, int size, QByteArray &out);
+    /** Time spent in the last successful compress() call, in nanoseconds. */
+    qint64 lastCompressionTime() const;
+
+    /** Reports that a backlogged device managed to write @p bytes in @p nsecs. */
+    void addLinkSample(qint64 bytes, qint64 nsecs);
+
+    /** Whether to decide per message if compression pays off (the default), rather than
+     *  compressing every message.
+     */
+    bool isAdaptive() const;
+    void setAdaptive(bool adaptive);
+
+    /** Whether compression is currently considered worthwhile. */
+    bool isEnabled() const;
+    /** Messages smaller than this are not compressed. */
+    int threshold() const;
+
+private:
+    Q_DISABLE_COPY(MessageCompressor)
+    void updatePolicy();
+
+    MessageCompressorPrivate *const d;
+};
+
+/** Counterpart to MessageCompressor for incoming message payloads on one connection. */
+class GAMMARAY_COMMON_EXPORT MessageDecompressor
+{
+public:
+    MessageDecompressor();
+    ~MessageDecompressor();
+
+    /** Appends the decompressed form of the compressed payload of @p size bytes at @p data to @p out.
+     *  Returns @c false if the payload is corrupt, or is part of a stream we haven't seen from the start.
+     */
+    bool decompress(const char *data, int size, QByteArray &out);
+    /** Time spent in the last decompress() call, in nanoseconds. */
+    qint64 lastDecompressionTime() const;
+
+private:
+    Q_DISABLE_COPY(MessageDecompressor)
+    MessageDecompressorPrivate *const d;
+};
+}
+
+#endif // GAMMARAY_MESSAGECOMPRESSOR_H
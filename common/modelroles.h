@@ -41,6 +41,12 @@ namespace GammaRay {
  */
 static const int UserRole = 256;
 
+/** Custom roles starting at this value are expensive to compute and only needed on
+ *  user interaction. They are not part of the item data transferred for every cell,
+ *  remote models fetch them on demand instead, see Protocol::isOnDemandRole().
+ */
+static const int OnDemandUserRole = UserRole + 0x10000;
+
 /** @brief  Custom roles for GammaRay::ToolModel.
  * @todo These can be split again, between core tool model and UI tool model.
  */
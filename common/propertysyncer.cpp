@@ -31,8 +31,7 @@
 
 #include <QDebug>
 #include <QMetaProperty>
-
-#include <algorithm>
+#include <QTimer>
 
 using namespace GammaRay;
 
@@ -43,9 +42,13 @@ static int qobjectPropertyOffset()
 
 PropertySyncer::PropertySyncer(QObject *parent)
     : QObject(parent)
+    , m_flushTimer(new QTimer(this))
     , m_address(Protocol::InvalidObjectAddress)
     , m_initialSync(false)
 {
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(0);
+    connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flushPropertyChanges()));
 }
 
 PropertySyncer::~PropertySyncer()
@@ -57,6 +60,31 @@ void PropertySyncer::setRequestInitialSync(bool initialSync)
     m_initialSync = initialSync;
 }
 
+int PropertySyncer::batchInterval() const
+{
+    return m_flushTimer->interval();
+}
+
+void PropertySyncer::setBatchInterval(int msecs)
+{
+    m_flushTimer->setInterval(msecs);
+}
+
+const PropertySyncer::NotifyPropertyMap &PropertySyncer::notifyProperties(const QMetaObject *mo)
+{
+    auto it = m_notifyProperties.constFind(mo);
+    if (it != m_notifyProperties.constEnd())
+        return it.value();
+
+    NotifyPropertyMap map;
+    for (int i = qobjectPropertyOffset(); i < mo->propertyCount(); ++i) {
+        const auto prop = mo->property(i);
+        if (prop.hasNotifySignal())
+            map[prop.notifySignalIndex()].push_back(i);
+    }
+    return m_notifyProperties.insert(mo, map).value();
+}
+
 void PropertySyncer::addObject(Protocol::ObjectAddress addr, QObject *obj)
 {
     Q_ASSERT(addr != Protocol::InvalidObjectAddress);
@@ -64,15 +92,14 @@ void PropertySyncer::addObject(Protocol::ObjectAddress addr, QObject *obj)
     if (qobjectPropertyOffset() == obj->metaObject()->propertyCount())
         return; // no properties we could sync
 
-    for (int i = qobjectPropertyOffset(); i < obj->metaObject()->propertyCount(); ++i) {
-        const auto prop = obj->metaObject()->property(i);
-        if (!prop.hasNotifySignal())
-            continue;
+    const auto &notifyMap = notifyProperties(obj->metaObject());
+    for (auto it = notifyMap.constBegin(); it != notifyMap.constEnd(); ++it) {
+        const auto notifySignal = obj->metaObject()->method(it.key());
         connect(obj, QByteArray("2") +
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-                prop.notifySignal().signature()
+                notifySignal.signature()
 #else
-                prop.notifySignal().methodSignature()
+                notifySignal.methodSignature()
 #endif
                 , this, SLOT(propertyChanged()));
     }
@@ -80,23 +107,22 @@ void PropertySyncer::addObject(Protocol::ObjectAddress addr, QObject *obj)
     connect(obj, SIGNAL(destroyed(QObject*)), this, SLOT(objectDestroyed(QObject*)));
 
     ObjectInfo info;
-    info.addr = addr;
     info.obj = obj;
     info.recursionLock = false;
     info.enabled = false;
-    m_objects.push_back(info);
+    m_objects.insert(addr, info);
+    m_objectAddresses.insert(obj, addr);
 }
 
 void PropertySyncer::setObjectEnabled(Protocol::ObjectAddress addr, bool enabled)
 {
-    const auto it = std::find_if(m_objects.begin(), m_objects.end(), [addr](
-                                     const ObjectInfo &info) {
-        return info.addr == addr;
-    });
+    const auto it = m_objects.find(addr);
     if (it == m_objects.end() || (*it).enabled == enabled)
         return;
 
     (*it).enabled = enabled;
+    if (!enabled)
+        (*it).dirtyProperties.clear();
     if (enabled && m_initialSync) {
         Message msg(m_address, Protocol::PropertySyncRequest);
         msg << addr;
@@ -124,28 +150,21 @@ void PropertySyncer::handleMessage(const GammaRay::Message &msg)
         msg >> addr;
         Q_ASSERT(addr != Protocol::InvalidObjectAddress);
 
-        const auto it
-            = std::find_if(m_objects.constBegin(), m_objects.constEnd(),
-                           [addr](const ObjectInfo &info) {
-                return info.addr == addr;
-            });
-        if (it == m_objects.constEnd())
+        const auto it = m_objects.find(addr);
+        if (it == m_objects.end())
             break;
 
-        QVector<QPair<QByteArray, QVariant> > values;
+        // a full sync supersedes pending changes
+        (*it).dirtyProperties.clear();
+
+        QVector<int> properties;
         const auto propCount = (*it).obj->metaObject()->propertyCount();
-        values.reserve(propCount);
-        for (int i = qobjectPropertyOffset(); i < propCount; ++i) {
-            const auto prop = (*it).obj->metaObject()->property(i);
-            values.push_back(qMakePair(QByteArray(prop.name()), prop.read((*it).obj)));
-        }
-        Q_ASSERT(!values.isEmpty());
+        properties.reserve(propCount);
+        for (int i = qobjectPropertyOffset(); i < propCount; ++i)
+            properties.push_back(i);
+        Q_ASSERT(!properties.isEmpty());
 
-        Message msg(m_address, Protocol::PropertyValuesChanged);
-        msg << addr << (quint32)values.size();
-        foreach (const auto &value, values)
-            msg << value.first << value.second;
-        emit message(msg);
+        sendPropertyValues(addr, (*it).obj, properties);
         break;
     }
     case Protocol::PropertyValuesChanged:
@@ -156,25 +175,24 @@ void PropertySyncer::handleMessage(const GammaRay::Message &msg)
         Q_ASSERT(addr != Protocol::InvalidObjectAddress);
         Q_ASSERT(changeSize > 0);
 
-        auto it = std::find_if(m_objects.begin(), m_objects.end(), [addr](const ObjectInfo &info) {
-                return info.addr == addr;
-            });
-        if (it == m_objects.end())
+        if (!m_objects.contains(addr))
             break;
 
         for (quint32 i = 0; i < changeSize; ++i) {
             QByteArray propName;
             QVariant propValue;
             msg >> propName >> propValue;
-            (*it).recursionLock = true;
-            (*it).obj->setProperty(propName, propValue);
-
-            // it can be invalid if as a result of the above call new objects have been registered for example
-            it = std::find_if(m_objects.begin(), m_objects.end(), [addr](const ObjectInfo &info) {
-                    return info.addr == addr;
-                });
-            Q_ASSERT(it != m_objects.end());
+            QObject *obj = m_objects.value(addr).obj;
+            m_objects[addr].recursionLock = true;
+            obj->setProperty(propName, propValue);
+
+            // the object info can be gone if as a result of the above call objects have been destroyed for example
+            auto it = m_objects.find(addr);
+            if (it == m_objects.end())
+                break;
             (*it).recursionLock = false;
+            // the remote value wins over a local change that hasn't been sent yet
+            (*it).dirtyProperties.removeAll(obj->metaObject()->indexOfProperty(propName));
         }
         break;
     }
@@ -185,39 +203,67 @@ void PropertySyncer::handleMessage(const GammaRay::Message &msg)
 
 void PropertySyncer::propertyChanged()
 {
-    const auto *obj = sender();
+    QObject *obj = sender();
     Q_ASSERT(obj);
-    const auto it
-        = std::find_if(m_objects.constBegin(), m_objects.constEnd(), [obj](const ObjectInfo &info) {
-        return info.obj == obj;
-    });
-    Q_ASSERT(it != m_objects.constEnd());
+    Q_ASSERT(m_objectAddresses.contains(obj));
+    const auto addr = m_objectAddresses.value(obj);
+    const auto it = m_objects.find(addr);
+    Q_ASSERT(it != m_objects.end());
 
     if ((*it).recursionLock || !(*it).enabled)
         return;
 
-    const auto sigIndex = senderSignalIndex();
-    QVector<QPair<QByteArray, QVariant> > changes;
-    for (int i = qobjectPropertyOffset(); i < obj->metaObject()->propertyCount(); ++i) {
-        const auto prop = obj->metaObject()->property(i);
-        if (prop.notifySignalIndex() != sigIndex)
+    const auto &notifyMap = notifyProperties(obj->metaObject());
+    const auto propIt = notifyMap.constFind(senderSignalIndex());
+    Q_ASSERT(propIt != notifyMap.constEnd());
+
+    if ((*it).dirtyProperties.isEmpty())
+        m_dirtyObjects.push_back(addr);
+    foreach (int propIdx, propIt.value()) {
+        if (!(*it).dirtyProperties.contains(propIdx))
+            (*it).dirtyProperties.push_back(propIdx);
+    }
+
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start();
+}
+
+void PropertySyncer::flushPropertyChanges()
+{
+    if (m_dirtyObjects.isEmpty())
+        return;
+    m_flushTimer->stop();
+
+    const auto dirtyObjects = m_dirtyObjects;
+    m_dirtyObjects.clear();
+
+    foreach (const auto addr, dirtyObjects) {
+        const auto it = m_objects.find(addr);
+        if (it == m_objects.end())
+            continue;
+        const auto properties = (*it).dirtyProperties;
+        (*it).dirtyProperties.clear();
+        if (properties.isEmpty() || !(*it).enabled)
             continue;
-        changes.push_back(qMakePair(QByteArray(prop.name()), prop.read(obj)));
+        sendPropertyValues(addr, (*it).obj, properties);
     }
-    Q_ASSERT(!changes.isEmpty());
+}
 
+void PropertySyncer::sendPropertyValues(Protocol::ObjectAddress addr, const QObject *obj, const QVector<int> &properties)
+{
     Message msg(m_address, Protocol::PropertyValuesChanged);
-    msg << (*it).addr << (quint32)changes.size();
-    foreach (const auto &change, changes)
-        msg << change.first << change.second;
+    msg << addr << (quint32)properties.size();
+    foreach (int propIdx, properties) {
+        const auto prop = obj->metaObject()->property(propIdx);
+        msg << QByteArray(prop.name()) << prop.read(obj);
+    }
     emit message(msg);
 }
 
 void PropertySyncer::objectDestroyed(QObject *obj)
 {
-    const auto it = std::find_if(m_objects.begin(), m_objects.end(), [obj](const ObjectInfo &info) {
-        return info.obj == obj;
-    });
-    Q_ASSERT(it != m_objects.end());
-    m_objects.erase(it);
+    const auto addrIt = m_objectAddresses.find(obj);
+    Q_ASSERT(addrIt != m_objectAddresses.end());
+    m_objects.remove(addrIt.value());
+    m_objectAddresses.erase(addrIt);
 }
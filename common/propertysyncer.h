@@ -33,13 +33,21 @@
 
 #include <common/protocol.h>
 
+#include <QHash>
 #include <QObject>
 #include <QVector>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class Message;
 
-/** Infrastructure for syncing property values between a local and a remote object. */
+/** Infrastructure for syncing property values between a local and a remote object.
+ *  Property changes are collected per object and sent in one message with the latest
+ *  values once the batch interval has passed, by default after the current event loop iteration.
+ */
 class GAMMARAY_COMMON_EXPORT PropertySyncer : public QObject
 {
     Q_OBJECT
@@ -65,10 +73,20 @@ public:
      */
     void setRequestInitialSync(bool initialSync);
 
+    /** Time in msecs property changes are accumulated before they are sent, 0 by default. */
+    int batchInterval() const;
+    void setBatchInterval(int msecs);
+
 public slots:
     /** Feed in incoming network messages here. */
     void handleMessage(const GammaRay::Message &msg);
 
+    /** Send all pending property changes right away.
+     *  Endpoint calls this before sending any other message, so that batched property
+     *  changes aren't reordered with messages that were sent after them.
+     */
+    void flushPropertyChanges();
+
 signals:
     /** Outgoing network messages, send those via Endpoint. */
     void message(const GammaRay::Message &msg);
@@ -79,12 +97,24 @@ private slots:
 
 private:
     struct ObjectInfo {
-        Protocol::ObjectAddress addr;
         QObject *obj;
+        // property indexes with changes that haven't been sent yet
+        QVector<int> dirtyProperties;
         bool recursionLock;
         bool enabled;
     };
-    QVector<ObjectInfo> m_objects;
+    /// notify signal index -> indexes of the properties using it
+    typedef QHash<int, QVector<int> > NotifyPropertyMap;
+
+    const NotifyPropertyMap &notifyProperties(const QMetaObject *mo);
+    void sendPropertyValues(Protocol::ObjectAddress addr, const QObject *obj, const QVector<int> &properties);
+
+    QHash<Protocol::ObjectAddress, ObjectInfo> m_objects;
+    QHash<QObject*, Protocol::ObjectAddress> m_objectAddresses;
+    QHash<const QMetaObject*, NotifyPropertyMap> m_notifyProperties;
+    // objects with non-empty dirtyProperties, in the order they changed
+    QVector<Protocol::ObjectAddress> m_dirtyObjects;
+    QTimer *m_flushTimer;
     Protocol::ObjectAddress m_address;
     bool m_initialSync;
 };
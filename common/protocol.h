@@ -30,6 +30,7 @@
 #define GAMMARAY_PROTOCOL_H
 
 #include "gammaray_common_export.h"
+#include "modelroles.h"
 #include <QAbstractItemModel>
 #include <QVector>
 #include <QModelIndex>
@@ -100,11 +101,64 @@ enum BuildInMessageType {
     ProbeSettings,
     ServerAddress,
 
+    // client -> server, in response to ServerInfo
+    CompressionSelect,
+
+    // server -> client, icons referenced by id in ModelContentReply,
+    // optionally telling the client to forget all icons it got before
+    ModelIconData,
+
+    // client -> server, parent handles the client no longer uses
+    ModelIndexHandleRelease,
+
     MESSAGE_TYPE_COUNT // NOTE when changing this enum, also update MessageStatisticsModel!
 };
 
 typedef QVector<QPair<qint32, qint32> > ModelIndex;
 
+/** Server-assigned handle for a parent index of a remote model.
+ *  Handles stay valid across insertions, moves and layout changes, they become invalid
+ *  when the parent is removed, the model is reset or the client releases them with
+ *  ModelIndexHandleRelease. Handles are never reused.
+ */
+typedef quint32 ModelIndexHandle;
+static const ModelIndexHandle InvalidModelIndexHandle = 0;
+static const ModelIndexHandle RootModelIndexHandle = 1;
+
+/** Payload compression, negotiated per connection.
+ *  The server announces the best method it supports in ServerInfo, the client
+ *  picks the one to use in both directions with CompressionSelect.
+ */
+enum Compression {
+    NoCompression = 0,
+    LZ4StreamCompression = 1 ///< see MessageCompressor
+};
+
+/** Remote view image encodings beyond the always supported uncompressed one, negotiated
+ *  per connection along with Compression: the server announces the ones it can produce in
+ *  ServerInfo, the client the ones it accepts in CompressionSelect. See TransferImage.
+ */
+enum ImageEncoding {
+    LosslessImageEncoding = 1, ///< scanline prediction filter and LZ4
+    LossyImageEncoding = 2 ///< JPEG, quality chosen by the server
+};
+
+/** Index addressing used by model content requests and replies. */
+enum ModelIndexAddressing {
+    ModelIndexPaths = 0,    ///< full index paths from the root, see ModelIndex
+    ModelIndexHandles = 1   ///< parent handle, row and column
+};
+
+/** Roles that are expensive to compute and only needed on user interaction.
+ *  Object models don't include those in their item data, remote models fetch
+ *  them on demand per cell instead, see ModelContentRequest and OnDemandUserRole.
+ */
+inline bool isOnDemandRole(int role)
+{
+    return role == Qt::ToolTipRole || role == Qt::StatusTipRole || role == Qt::WhatsThisRole
+           || role >= OnDemandUserRole;
+}
+
 /** @brief Protocol representation of an QItemSelectionRange. */
 struct ItemSelectionRange {
     ModelIndex topLeft;
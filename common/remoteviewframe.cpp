@@ -32,6 +32,7 @@
 
 namespace GammaRay {
 RemoteViewFrame::RemoteViewFrame()
+    : m_captureTime(-1)
 {
 }
 
@@ -72,6 +73,18 @@ void RemoteViewFrame::setSceneRect(const QRectF &sceneRect)
     m_sceneRect = sceneRect;
 }
 
+QRectF RemoteViewFrame::imageRect() const
+{
+    if (m_imageRect.isValid())
+        return m_imageRect;
+    return viewRect();
+}
+
+void RemoteViewFrame::setImageRect(const QRectF &imageRect)
+{
+    m_imageRect = imageRect;
+}
+
 QImage RemoteViewFrame::image() const
 {
     return m_image.image();
@@ -82,6 +95,34 @@ void RemoteViewFrame::setImage(const QImage &image)
     m_image.setImage(image);
 }
 
+void RemoteViewFrame::setDeltaBase(const QImage &previousImage)
+{
+    m_image.setDeltaBase(previousImage);
+}
+
+bool RemoteViewFrame::isPartial() const
+{
+    return m_image.isPartial();
+}
+
+bool RemoteViewFrame::resolvePartial(QImage &previousImage)
+{
+    if (!m_image.applyTo(previousImage))
+        return false;
+    m_image.setImage(previousImage);
+    return true;
+}
+
+TransferImage::Encoding RemoteViewFrame::encodeImage(TransferImage::Encoding encoding, int quality)
+{
+    return m_image.encode(encoding, quality);
+}
+
+int RemoteViewFrame::encodedImageSize() const
+{
+    return m_image.encodedSize();
+}
+
 QVariant RemoteViewFrame::data() const
 {
     return m_data;
@@ -92,9 +133,20 @@ void RemoteViewFrame::setData(const QVariant &data)
     m_data = data;
 }
 
+qint64 RemoteViewFrame::captureTime() const
+{
+    return m_captureTime;
+}
+
+void RemoteViewFrame::setCaptureTime(qint64 nsecs)
+{
+    m_captureTime = nsecs;
+}
+
 QDataStream &operator<<(QDataStream &stream, const RemoteViewFrame &frame)
 {
-    stream << frame.m_image << frame.m_data << frame.m_viewRect << frame.m_sceneRect;
+    stream << frame.m_image << frame.m_data << frame.m_viewRect << frame.m_sceneRect
+           << frame.m_imageRect << frame.m_captureTime;
     return stream;
 }
 
@@ -104,6 +156,8 @@ QDataStream &operator>>(QDataStream &stream, RemoteViewFrame &frame)
     stream >> frame.m_data;
     stream >> frame.m_viewRect;
     stream >> frame.m_sceneRect;
+    stream >> frame.m_imageRect;
+    stream >> frame.m_captureTime;
     return stream;
 }
 }
@@ -58,14 +58,32 @@ public:
     /// the interal scene might expand beyond the visible view area
     QRectF sceneRect() const;
     void setSceneRect(const QRectF &sceneRect);
+    /// the part of the view covered by image(), the whole view by default
+    QRectF imageRect() const;
+    void setImageRect(const QRectF &imageRect);
 
     QImage image() const;
     void setImage(const QImage &image);
 
+    /// only transfer the parts of the image that changed compared to @p previousImage
+    void setDeltaBase(const QImage &previousImage);
+    /// @c true if this frame was received as changes to the previous frame, see resolvePartial()
+    bool isPartial() const;
+    /// patches the received changes into @p previousImage and makes that the image of this frame
+    bool resolvePartial(QImage &previousImage);
+    /// encodes the image ahead of serialization, see TransferImage::encode()
+    TransferImage::Encoding encodeImage(TransferImage::Encoding encoding, int quality = -1);
+    /// size of the encoded image in bytes, 0 if not encoded
+    int encodedImageSize() const;
+
     /// tool specific frame data
     QVariant data() const;
     void setData(const QVariant &data);
 
+    /// time it took the server to obtain the image of this frame in nsecs, -1 if unknown
+    qint64 captureTime() const;
+    void setCaptureTime(qint64 nsecs);
+
 private:
     friend QDataStream &operator<<(QDataStream &stream, const RemoteViewFrame &frame);
     friend QDataStream &operator>>(QDataStream &stream, RemoteViewFrame &frame);
@@ -73,6 +91,8 @@ private:
     QVariant m_data;
     QRectF m_viewRect;
     QRectF m_sceneRect;
+    QRectF m_imageRect;
+    qint64 m_captureTime;
 };
 }
 
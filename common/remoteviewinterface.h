@@ -35,6 +35,7 @@
 
 #include <QObject>
 #include <QPoint>
+#include <QRectF>
 
 namespace GammaRay {
 class RemoteViewFrame;
@@ -72,6 +73,12 @@ public slots:
     /// Tell the server we are ready for the next frame.
     virtual void clientViewUpdated() = 0;
 
+    /** Tell the server which part of the source is visible on the client, in source coordinates,
+     *  and at which zoom (in device pixels per source unit). Frames are then reduced to that.
+     *  An invalid @p viewport requests full frames.
+     */
+    virtual void setClientViewport(const QRectF &viewport, double zoom) = 0;
+
 signals:
     void reset();
     void elementsAtReceived(const GammaRay::ObjectIds &ids, int bestCandidate);
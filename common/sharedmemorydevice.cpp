@@ -0,0 +1,442 @@
+/*
+  sharedmemorydevice.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "sharedmemorydevice.h"
+
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QLocalSocket>
+#include <QSharedMemory>
+
+#include <cstring>
+#include <new>
+
+using namespace GammaRay;
+
+static const quint32 SegmentMagic = 0x47527368; // "GRsh"
+static const int CacheLineSize = 64;
+static const int MaxRingSize = 1 << 30;
+
+namespace GammaRay {
+/// Shared state of one ring, producer and consumer positions are on separate cache lines.
+/// Positions are free-running byte counters, the ring size is a power of two.
+struct SharedMemoryRingHeader
+{
+    QAtomicInt head; // written by the producer
+    char padding1[CacheLineSize - sizeof(QAtomicInt)];
+    QAtomicInt tail; // written by the consumer
+    char padding2[CacheLineSize - sizeof(QAtomicInt)];
+    QAtomicInt readerWaiting; // consumer ran out of data and wants to be woken up
+    QAtomicInt writerWaiting; // producer ran out of space and wants to be woken up
+    char padding3[CacheLineSize - 2 * sizeof(QAtomicInt)];
+};
+}
+
+/// Start of the segment, followed by the ring headers and the ring data.
+/// Ring 0 transfers data from the server to the client, ring 1 the other way around.
+struct SharedMemorySegmentHeader
+{
+    quint32 magic;
+    quint32 ringSize;
+    char padding[CacheLineSize - 2 * sizeof(quint32)];
+};
+
+static int ringHeaderOffset(int ring)
+{
+    return sizeof(SharedMemorySegmentHeader) + ring * sizeof(SharedMemoryRingHeader);
+}
+
+static int ringDataOffset(int ring, int ringSize)
+{
+    return ringHeaderOffset(2) + ring * ringSize;
+}
+
+static inline int loadAcquire(QAtomicInt &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.loadAcquire();
+#else
+    return value.fetchAndAddAcquire(0);
+#endif
+}
+
+static inline void storeRelease(QAtomicInt &value, int newValue)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    value.storeRelease(newValue);
+#else
+    value.fetchAndStoreRelease(newValue);
+#endif
+}
+
+SharedMemoryDevice::Ring::Ring()
+    : header(0)
+    , data(0)
+    , mask(0)
+{
+}
+
+quint32 SharedMemoryDevice::Ring::used() const
+{
+    if (!header)
+        return 0;
+    return quint32(loadAcquire(header->head)) - quint32(loadAcquire(header->tail));
+}
+
+quint32 SharedMemoryDevice::Ring::read(char *dest, quint32 maxSize)
+{
+    const quint32 tail = loadAcquire(header->tail);
+    const quint32 size = qMin(maxSize, quint32(loadAcquire(header->head)) - tail);
+    const quint32 offset = tail & mask;
+    const quint32 first = qMin(size, mask + 1 - offset);
+    memcpy(dest, data + offset, first);
+    memcpy(dest + first, data, size - first);
+    storeRelease(header->tail, int(tail + size));
+    return size;
+}
+
+quint32 SharedMemoryDevice::Ring::write(const char *src, quint32 size)
+{
+    const quint32 head = loadAcquire(header->head);
+    const quint32 free = mask + 1 - (head - quint32(loadAcquire(header->tail)));
+    size = qMin(size, free);
+    const quint32 offset = head & mask;
+    const quint32 first = qMin(size, mask + 1 - offset);
+    memcpy(data + offset, src, first);
+    memcpy(data, src + first, size - first);
+    storeRelease(header->head, int(head + size));
+    return size;
+}
+
+SharedMemoryDevice::SharedMemoryDevice(QObject *parent)
+    : QIODevice(parent)
+    , m_socket(0)
+    , m_sharedMemory(0)
+    , m_readyReadPending(false)
+{
+}
+
+SharedMemoryDevice::~SharedMemoryDevice()
+{
+    detach();
+}
+
+int SharedMemoryDevice::defaultRingSize()
+{
+    return 4 * 1024 * 1024;
+}
+
+bool SharedMemoryDevice::create(QLocalSocket *socket, int ringSize)
+{
+    Q_ASSERT(!m_socket);
+    Q_ASSERT(socket);
+    m_socket = socket;
+    m_socket->setParent(this);
+    connect(m_socket, SIGNAL(readyRead()), this, SLOT(socketReadyRead()));
+    connect(m_socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+
+#ifndef QT_NO_SHAREDMEMORY
+    int size = CacheLineSize;
+    while (size < ringSize && size < MaxRingSize)
+        size *= 2;
+    const int segmentSize = ringDataOffset(2, size);
+
+    static QAtomicInt segmentCount;
+    const QString key = QStringLiteral("gammaray-%1-%2").arg(QCoreApplication::applicationPid())
+                        .arg(segmentCount.fetchAndAddRelaxed(1));
+    m_sharedMemory = new QSharedMemory(key, this);
+    if (!m_sharedMemory->create(segmentSize)) {
+        // left-over from a crashed process with the same pid, attaching and detaching cleans that up on Unix
+        if (m_sharedMemory->error() == QSharedMemory::AlreadyExists && m_sharedMemory->attach())
+            m_sharedMemory->detach();
+        if (!m_sharedMemory->create(segmentSize)) {
+            setErrorString(m_sharedMemory->errorString());
+            qWarning() << "Failed to create shared memory segment:" << errorString();
+            delete m_sharedMemory;
+            m_sharedMemory = 0;
+            return false;
+        }
+    }
+
+    char *segment = static_cast<char *>(m_sharedMemory->data());
+    memset(segment, 0, segmentSize);
+    SharedMemorySegmentHeader *segmentHeader = reinterpret_cast<SharedMemorySegmentHeader *>(segment);
+    segmentHeader->ringSize = size;
+    for (int i = 0; i < 2; ++i) {
+        SharedMemoryRingHeader *header = new (segment + ringHeaderOffset(i)) SharedMemoryRingHeader;
+        storeRelease(header->readerWaiting, 1); // nothing has been read yet
+    }
+    segmentHeader->magic = SegmentMagic;
+
+    setupRings(true);
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    m_socket->write(key.toUtf8() + '\n');
+    return true;
+#else
+    Q_UNUSED(ringSize);
+    setErrorString(tr("Shared memory is not supported on this platform."));
+    return false;
+#endif
+}
+
+void SharedMemoryDevice::connectToServer(const QString &serverName)
+{
+    if (!m_socket) {
+        m_socket = new QLocalSocket(this);
+        connect(m_socket, SIGNAL(readyRead()), this, SLOT(socketReadyRead()));
+        connect(m_socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
+    }
+    m_socket->connectToServer(serverName);
+}
+
+void SharedMemoryDevice::disconnectFromServer()
+{
+    close();
+}
+
+QLocalSocket *SharedMemoryDevice::localSocket() const
+{
+    return m_socket;
+}
+
+bool SharedMemoryDevice::attach(const QString &key)
+{
+#ifndef QT_NO_SHAREDMEMORY
+    Q_ASSERT(!m_sharedMemory);
+    m_sharedMemory = new QSharedMemory(key, this);
+    if (!m_sharedMemory->attach()) {
+        setErrorString(m_sharedMemory->errorString());
+    } else if (m_sharedMemory->size() < int(sizeof(SharedMemorySegmentHeader))
+               || static_cast<const SharedMemorySegmentHeader *>(m_sharedMemory->constData())->magic
+               != SegmentMagic) {
+        setErrorString(tr("Invalid shared memory segment."));
+    } else {
+        setupRings(false);
+        open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+        return true;
+    }
+
+    delete m_sharedMemory;
+    m_sharedMemory = 0;
+    return false;
+#else
+    Q_UNUSED(key);
+    setErrorString(tr("Shared memory is not supported on this platform."));
+    return false;
+#endif
+}
+
+void SharedMemoryDevice::setupRings(bool isServer)
+{
+    char *segment = static_cast<char *>(m_sharedMemory->data());
+    const int ringSize = reinterpret_cast<SharedMemorySegmentHeader *>(segment)->ringSize;
+    const int readRing = isServer ? 1 : 0;
+    const int writeRing = isServer ? 0 : 1;
+
+    m_readRing.header = reinterpret_cast<SharedMemoryRingHeader *>(segment + ringHeaderOffset(readRing));
+    m_readRing.data = segment + ringDataOffset(readRing, ringSize);
+    m_readRing.mask = ringSize - 1;
+    m_writeRing.header = reinterpret_cast<SharedMemoryRingHeader *>(segment + ringHeaderOffset(writeRing));
+    m_writeRing.data = segment + ringDataOffset(writeRing, ringSize);
+    m_writeRing.mask = ringSize - 1;
+}
+
+void SharedMemoryDevice::detach()
+{
+    m_readRing = Ring();
+    m_writeRing = Ring();
+    m_pendingWrites.clear();
+#ifndef QT_NO_SHAREDMEMORY
+    delete m_sharedMemory; // detaches, the segment is gone once both sides did that
+    m_sharedMemory = 0;
+#endif
+}
+
+bool SharedMemoryDevice::isSequential() const
+{
+    return true;
+}
+
+qint64 SharedMemoryDevice::bytesAvailable() const
+{
+    return m_readRing.used() + QIODevice::bytesAvailable();
+}
+
+qint64 SharedMemoryDevice::bytesToWrite() const
+{
+    return m_pendingWrites.size();
+}
+
+void SharedMemoryDevice::close()
+{
+    if (isOpen())
+        QIODevice::close();
+    detach();
+    if (m_socket && m_socket->state() != QLocalSocket::UnconnectedState)
+        m_socket->disconnectFromServer();
+}
+
+qint64 SharedMemoryDevice::readData(char *data, qint64 maxSize)
+{
+    if (!m_readRing.header)
+        return -1;
+
+    const quint32 size = m_readRing.read(data, quint32(qMin<qint64>(maxSize, MaxRingSize)));
+    if (size && m_readRing.header->writerWaiting.fetchAndStoreOrdered(0))
+        ringDoorbell();
+
+    if (!m_readRing.used()) {
+        // ask for a wake up, and check again in case the producer missed that
+        m_readRing.header->readerWaiting.fetchAndStoreOrdered(1);
+        if (m_readRing.used() && m_readRing.header->readerWaiting.fetchAndStoreOrdered(0)
+            && !m_readyReadPending) {
+            m_readyReadPending = true;
+            QMetaObject::invokeMethod(this, "socketReadyRead", Qt::QueuedConnection);
+        }
+    }
+    return size;
+}
+
+qint64 SharedMemoryDevice::writeData(const char *data, qint64 size)
+{
+    if (!m_writeRing.header)
+        return -1;
+
+    if (m_pendingWrites.isEmpty()) {
+        const quint32 written = m_writeRing.write(data, quint32(qMin<qint64>(size, MaxRingSize)));
+        if (written && m_writeRing.header->readerWaiting.fetchAndStoreOrdered(0))
+            ringDoorbell();
+        if (written == size)
+            return size;
+        m_pendingWrites.append(data + written, size - written);
+    } else {
+        m_pendingWrites.append(data, size);
+    }
+
+    flushPendingWrites();
+    return size;
+}
+
+void SharedMemoryDevice::flushPendingWrites()
+{
+    while (!m_pendingWrites.isEmpty() && m_writeRing.header) {
+        const quint32 written = m_writeRing.write(m_pendingWrites.constData(), m_pendingWrites.size());
+        if (written) {
+            m_pendingWrites.remove(0, written);
+            if (m_writeRing.header->readerWaiting.fetchAndStoreOrdered(0))
+                ringDoorbell();
+            continue;
+        }
+
+        // ring is full, ask for a wake up and check again in case the consumer missed that
+        m_writeRing.header->writerWaiting.fetchAndStoreOrdered(1);
+        if (m_writeRing.used() > m_writeRing.mask)
+            break;
+    }
+}
+
+void SharedMemoryDevice::ringDoorbell()
+{
+    if (m_socket)
+        m_socket->write("\n", 1);
+}
+
+void SharedMemoryDevice::socketReadyRead()
+{
+    m_readyReadPending = false;
+    if (!m_socket)
+        return;
+
+    if (!isOpen()) { // client side handshake, the first line contains the segment key
+        if (!m_socket->canReadLine())
+            return;
+        const QString key = QString::fromUtf8(m_socket->readLine()).trimmed();
+        if (!attach(key)) {
+            qWarning() << "Failed to attach to shared memory segment:" << errorString();
+            m_socket->disconnectFromServer();
+            return;
+        }
+        emit connected();
+    }
+
+    m_socket->readAll(); // doorbell content is irrelevant
+    flushPendingWrites();
+    if (m_readRing.used())
+        emit readyRead();
+}
+
+void SharedMemoryDevice::socketDisconnected()
+{
+    if (m_readRing.used())
+        emit readyRead();
+    close();
+    emit disconnected();
+}
+
+bool SharedMemoryDevice::waitForReadyRead(int msecs)
+{
+    if (bytesAvailable())
+        return true;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (m_socket && m_socket->state() == QLocalSocket::ConnectedState) {
+        if (m_readRing.header) {
+            m_readRing.header->readerWaiting.fetchAndStoreOrdered(1);
+            if (m_readRing.used())
+                return true;
+        }
+        // emits readyRead() synchronously, which ends up in socketReadyRead()
+        const int remaining = msecs < 0 ? -1 : qMax<int>(0, msecs - timer.elapsed());
+        if (!m_socket->waitForReadyRead(remaining))
+            return false;
+        if (bytesAvailable())
+            return true;
+    }
+    return false;
+}
+
+bool SharedMemoryDevice::waitForBytesWritten(int msecs)
+{
+    flushPendingWrites();
+    if (!m_socket)
+        return false;
+    m_socket->flush();
+
+    QElapsedTimer timer;
+    timer.start();
+    while (!m_pendingWrites.isEmpty()) {
+        const int remaining = msecs < 0 ? -1 : qMax<int>(0, msecs - timer.elapsed());
+        if (!m_socket || !m_socket->waitForReadyRead(remaining)) // flushes via socketReadyRead()
+            return false;
+        m_socket->flush();
+    }
+    return true;
+}
@@ -0,0 +1,132 @@
+/*
+  sharedmemorydevice.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_SHAREDMEMORYDEVICE_H
+#define GAMMARAY_SHAREDMEMORYDEVICE_H
+
+#include "gammaray_common_export.h"
+
+#include <QByteArray>
+#include <QIODevice>
+
+QT_BEGIN_NAMESPACE
+class QLocalSocket;
+class QSharedMemory;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+struct SharedMemoryRingHeader;
+
+/**
+ * Sequential device transferring data between two processes on the same host
+ * through a shared memory segment.
+ *
+ * The segment contains one single-producer/single-consumer ring buffer per direction.
+ * A local socket is used for the initial handshake (announcing the segment key),
+ * as a doorbell to wake up the other side when it is waiting for data or ring space,
+ * and to detect when the other side goes away. Data itself never passes through the socket.
+ *
+ * Writes never block, data that doesn't fit into the ring is queued locally until the
+ * other side has made room.
+ */
+class GAMMARAY_COMMON_EXPORT SharedMemoryDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    explicit SharedMemoryDevice(QObject *parent = 0);
+    ~SharedMemoryDevice();
+
+    /** Default size of the ring buffer in each direction. */
+    static int defaultRingSize();
+
+    /** Server side: creates a new segment with rings of @p ringSize bytes (rounded up
+     *  to a power of two) and announces it to the client connected to @p socket.
+     *  Takes ownership of @p socket.
+     */
+    bool create(QLocalSocket *socket, int ringSize = defaultRingSize());
+    /** Client side: connects to the local server named @p serverName.
+     *  connected() is emitted once the segment announced by the server has been attached.
+     */
+    void connectToServer(const QString &serverName);
+    void disconnectFromServer();
+
+    /** The local socket used for the handshake and the doorbell, e.g. for error reporting. */
+    QLocalSocket *localSocket() const;
+
+    bool isSequential() const Q_DECL_OVERRIDE;
+    qint64 bytesAvailable() const Q_DECL_OVERRIDE;
+    qint64 bytesToWrite() const Q_DECL_OVERRIDE;
+    void close() Q_DECL_OVERRIDE;
+    bool waitForReadyRead(int msecs) Q_DECL_OVERRIDE;
+    bool waitForBytesWritten(int msecs) Q_DECL_OVERRIDE;
+
+signals:
+    void connected();
+    void disconnected();
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) Q_DECL_OVERRIDE;
+    qint64 writeData(const char *data, qint64 size) Q_DECL_OVERRIDE;
+
+private slots:
+    void socketReadyRead();
+    void socketDisconnected();
+
+private:
+    Q_DISABLE_COPY(SharedMemoryDevice)
+
+    struct Ring
+    {
+        Ring();
+        quint32 used() const;
+        quint32 read(char *data, quint32 maxSize);
+        quint32 write(const char *data, quint32 size);
+
+        SharedMemoryRingHeader *header;
+        char *data;
+        quint32 mask;
+    };
+
+    void setupRings(bool isServer);
+    bool attach(const QString &key);
+    void detach();
+    /** Moves as much of the locally queued data into the ring as fits. */
+    void flushPendingWrites();
+    void ringDoorbell();
+
+    QLocalSocket *m_socket;
+    QSharedMemory *m_sharedMemory;
+    Ring m_readRing;
+    Ring m_writeRing;
+    // data that didn't fit into m_writeRing yet
+    QByteArray m_pendingWrites;
+    bool m_readyReadPending;
+};
+}
+
+#endif // GAMMARAY_SHAREDMEMORYDEVICE_H
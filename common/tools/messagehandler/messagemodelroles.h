@@ -39,7 +39,7 @@ enum Role {
     Type,
     File,
     Line,
-    Backtrace
+    Backtrace = OnDemandUserRole // symbolized when requested
 };
 }
 
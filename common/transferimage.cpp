@@ -27,16 +27,203 @@
 */
 
 #include "transferimage.h"
+#include "protocol.h"
 
+#include "lz4/lz4.h" // 3rdparty
+
+#include <QBuffer>
 #include <QDebug>
+#include <QImageReader>
+#include <QImageWriter>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 
 namespace GammaRay {
+static const int TileSize = 64;
+
+static int bytesPerPixel(const QImage &img)
+{
+    // delta transfer works on whole bytes only
+    if (img.depth() < 8 || img.depth() % 8 != 0)
+        return 0;
+    return img.depth() / 8;
+}
+
+static bool tileChanged(const QImage &a, const QImage &b, const QRect &rect, int bpp)
+{
+    // memcmp is vectorized by all relevant C libraries, and a tile row is contiguous in memory
+    const int offset = rect.x() * bpp;
+    const int length = rect.width() * bpp;
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        if (memcmp(a.constScanLine(y) + offset, b.constScanLine(y) + offset, length) != 0)
+            return true;
+    }
+    return false;
+}
+
+// per-scanline prediction filters, as in PNG
+enum ScanlineFilter {
+    NoFilter = 0,
+    SubFilter = 1, // difference to the same channel of the previous pixel
+    UpFilter = 2   // difference to the same byte in the previous scanline
+};
+
+// filtered form of a scanline is written to out, prefixed by the chosen filter type
+static void filterRow(const uchar *row, const uchar *above, int length, int bpp, uchar *out)
+{
+    // pick the filter with the smallest sum of absolute differences, the usual PNG heuristic
+    int costNone = 0, costSub = 0, costUp = 0;
+    for (int i = 0; i < length; ++i) {
+        costNone += std::abs(static_cast<signed char>(row[i]));
+        costSub += std::abs(static_cast<signed char>(row[i] - (i >= bpp ? row[i - bpp] : 0)));
+        if (above)
+            costUp += std::abs(static_cast<signed char>(row[i] - above[i]));
+    }
+
+    uchar *dst = out + 1;
+    if (above && costUp < costSub && costUp < costNone) {
+        out[0] = UpFilter;
+        for (int i = 0; i < length; ++i)
+            dst[i] = row[i] - above[i];
+    } else if (costSub < costNone) {
+        out[0] = SubFilter;
+        for (int i = 0; i < std::min(bpp, length); ++i)
+            dst[i] = row[i];
+        for (int i = bpp; i < length; ++i)
+            dst[i] = row[i] - row[i - bpp];
+    } else {
+        out[0] = NoFilter;
+        memcpy(dst, row, length);
+    }
+}
+
+// reverses filterRow(), row contains the filtered data and is restored in place
+static bool unfilterRow(uchar filter, uchar *row, const uchar *above, int length, int bpp)
+{
+    switch (filter) {
+    case NoFilter:
+        return true;
+    case SubFilter:
+        for (int i = bpp; i < length; ++i)
+            row[i] += row[i - bpp];
+        return true;
+    case UpFilter:
+        if (!above)
+            return false;
+        for (int i = 0; i < length; ++i)
+            row[i] += above[i];
+        return true;
+    }
+    return false;
+}
+
+// filters all rows and compresses the result
+static QByteArray packRows(const QVector<const uchar *> &rows, const QVector<const uchar *> &aboveRows,
+                           const QVector<int> &lengths, int bpp)
+{
+    int size = 0;
+    foreach (int length, lengths)
+        size += length + 1;
+
+    QByteArray filtered(size, Qt::Uninitialized);
+    uchar *out = reinterpret_cast<uchar *>(filtered.data());
+    for (int i = 0; i < rows.size(); ++i) {
+        filterRow(rows.at(i), aboveRows.at(i), lengths.at(i), bpp, out);
+        out += lengths.at(i) + 1;
+    }
+
+    QByteArray compressed(LZ4_compressBound(size), Qt::Uninitialized);
+    const int compressedSize = LZ4_compress_default(filtered.constData(), compressed.data(), size, compressed.size());
+    compressed.resize(compressedSize);
+    return compressed;
+}
+
+// decompresses into the given rows, aboveRows have to point into already restored rows
+static bool unpackRows(const QByteArray &compressed, const QVector<uchar *> &rows,
+                       const QVector<const uchar *> &aboveRows, const QVector<int> &lengths, int bpp)
+{
+    int size = 0;
+    foreach (int length, lengths)
+        size += length + 1;
+
+    QByteArray filtered(size, Qt::Uninitialized);
+    if (LZ4_decompress_safe(compressed.constData(), filtered.data(), compressed.size(), size) != size)
+        return false;
+
+    const uchar *in = reinterpret_cast<const uchar *>(filtered.constData());
+    for (int i = 0; i < rows.size(); ++i) {
+        memcpy(rows.at(i), in + 1, lengths.at(i));
+        if (!unfilterRow(in[0], rows.at(i), aboveRows.at(i), lengths.at(i), bpp))
+            return false;
+        in += lengths.at(i) + 1;
+    }
+    return true;
+}
+
+// prediction filters operate on whole bytes, sub-byte formats just use their neighboring byte
+static int filterBytesPerPixel(const QImage &img)
+{
+    return std::max(1, img.depth() / 8);
+}
+
+static bool isOpaque(const QImage &img)
+{
+    if (!img.hasAlphaChannel())
+        return true;
+
+    switch (img.format()) {
+    case QImage::Format_ARGB32:
+    case QImage::Format_ARGB32_Premultiplied:
+        for (int y = 0; y < img.height(); ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(img.constScanLine(y));
+            for (int x = 0; x < img.width(); ++x) {
+                if (qAlpha(line[x]) != 255)
+                    return false;
+            }
+        }
+        return true;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    // byte ordered, as produced by glReadPixels in the Quick inspector
+    case QImage::Format_RGBA8888:
+    case QImage::Format_RGBA8888_Premultiplied:
+        for (int y = 0; y < img.height(); ++y) {
+            const uchar *line = img.constScanLine(y);
+            for (int x = 0; x < img.width(); ++x) {
+                if (line[x * 4 + 3] != 255)
+                    return false;
+            }
+        }
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+static void writeImageHeader(QDataStream &stream, const QImage &img)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    stream << (double)img.devicePixelRatio();
+#else
+    stream << 1.0;
+#endif
+    stream << (quint32)img.format() << (quint32)img.width() << (quint32)img.height();
+}
+
 TransferImage::TransferImage()
+    : m_delta(false)
+    , m_deltaFormat(0)
+    , m_deltaPixelRatio(1.0)
 {
 }
 
 TransferImage::TransferImage(const QImage &image)
     : m_image(image)
+    , m_delta(false)
+    , m_deltaFormat(0)
+    , m_deltaPixelRatio(1.0)
 {
 }
 
@@ -48,30 +235,224 @@ const QImage &TransferImage::image() const
 void TransferImage::setImage(const QImage &image)
 {
     m_image = image;
+    m_dirtyRects.clear();
+    m_dirtyData.clear();
+    m_encoded.clear();
+    m_delta = false;
 }
 
-QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image)
+void TransferImage::setDeltaBase(const QImage &base)
+{
+    m_dirtyRects.clear();
+    m_encoded.clear();
+    m_delta = false;
+
+    const int bpp = bytesPerPixel(m_image);
+    if (base.isNull() || m_image.isNull() || bpp == 0 || base.size() != m_image.size()
+        || base.format() != m_image.format())
+        return;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    if (base.devicePixelRatio() != m_image.devicePixelRatio())
+        return;
+#endif
+
+    const int w = m_image.width();
+    const int h = m_image.height();
+    qint64 dirtyArea = 0;
+    for (int y = 0; y < h; y += TileSize) {
+        const int tileHeight = qMin(TileSize, h - y);
+        // merge horizontally adjacent changed tiles, to keep the per-rect overhead down
+        QRect run;
+        for (int x = 0; x < w; x += TileSize) {
+            const QRect tile(x, y, qMin(TileSize, w - x), tileHeight);
+            if (tileChanged(base, m_image, tile, bpp)) {
+                run = run.isValid() ? run.united(tile) : tile;
+            } else if (run.isValid()) {
+                m_dirtyRects.push_back(run);
+                dirtyArea += run.width() * run.height();
+                run = QRect();
+            }
+        }
+        if (run.isValid()) {
+            m_dirtyRects.push_back(run);
+            dirtyArea += run.width() * run.height();
+        }
+    }
+
+    // not worth it, send the full image instead
+    if (dirtyArea * 4 > qint64(w) * h * 3) {
+        m_dirtyRects.clear();
+        return;
+    }
+
+    m_delta = true;
+}
+
+bool TransferImage::isPartial() const
+{
+    return m_delta && m_image.isNull();
+}
+
+bool TransferImage::applyTo(QImage &base) const
+{
+    if (!isPartial()) {
+        base = m_image;
+        return true;
+    }
+
+    if (base.size() != m_deltaSize || base.format() != static_cast<QImage::Format>(m_deltaFormat))
+        return false;
+    const int bpp = bytesPerPixel(base);
+    if (bpp == 0)
+        return false;
+    qint64 dataSize = 0;
+    foreach (const QRect &rect, m_dirtyRects) {
+        if (!base.rect().contains(rect))
+            return false;
+        dataSize += qint64(rect.width()) * rect.height() * bpp;
+    }
+    if (dataSize != m_dirtyData.size())
+        return false;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    base.setDevicePixelRatio(m_deltaPixelRatio);
+#endif
+    const char *src = m_dirtyData.constData();
+    foreach (const QRect &rect, m_dirtyRects) {
+        const int offset = rect.x() * bpp;
+        const int length = rect.width() * bpp;
+        for (int y = rect.top(); y <= rect.bottom(); ++y) {
+            memcpy(base.scanLine(y) + offset, src, length);
+            src += length;
+        }
+    }
+    return true;
+}
+
+TransferImage::Encoding TransferImage::encode(Encoding encoding, int quality)
+{
+    m_encoded.clear();
+    if (encoding == LossyEncoding && (m_delta || !isOpaque(m_image)))
+        encoding = LosslessEncoding;
+
+    QBuffer buffer(&m_encoded);
+    buffer.open(QIODevice::WriteOnly);
+    QDataStream stream(&buffer);
+    write(stream, encoding, quality);
+    buffer.close();
+    return encoding;
+}
+
+int TransferImage::encodedSize() const
+{
+    return m_encoded.size();
+}
+
+quint8 TransferImage::supportedEncoders()
+{
+    quint8 encodings = Protocol::LosslessImageEncoding;
+    if (QImageWriter::supportedImageFormats().contains("jpeg"))
+        encodings |= Protocol::LossyImageEncoding;
+    return encodings;
+}
+
+quint8 TransferImage::supportedDecoders()
+{
+    quint8 encodings = Protocol::LosslessImageEncoding;
+    if (QImageReader::supportedImageFormats().contains("jpeg"))
+        encodings |= Protocol::LossyImageEncoding;
+    return encodings;
+}
+
+void TransferImage::write(QDataStream &stream, Encoding encoding, int quality) const
 {
-    static const TransferImage::Format format = TransferImage::RawFormat;
+    TransferImage::Format format = m_delta ? DeltaFormat : RawFormat;
+    if (encoding == LosslessEncoding)
+        format = m_delta ? DeltaLZ4Format : LZ4Format;
+    else if (encoding == LossyEncoding)
+        format = JpegFormat;
 
-    const QImage &img = image.image();
+    const QImage &img = m_image;
     stream << (quint32)(format);
     switch (format) {
     case TransferImage::QImageFormat:
         stream << img;
         break;
     case TransferImage::RawFormat:
-#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
-        stream << (double)img.devicePixelRatio();
-#else
-        stream << 1.0;
-#endif
-        stream << (quint32)img.format() << (quint32)img.width() << (quint32)img.height();
+        writeImageHeader(stream, img);
         for (int i = 0; i < img.height(); ++i)
             stream.device()->write((const char *)img.scanLine(i), img.bytesPerLine());
         break;
+    case TransferImage::DeltaFormat:
+    {
+        writeImageHeader(stream, img);
+        const int bpp = bytesPerPixel(img);
+        quint32 dataSize = 0;
+        stream << (quint32)m_dirtyRects.size();
+        foreach (const QRect &rect, m_dirtyRects) {
+            stream << (quint32)rect.x() << (quint32)rect.y() << (quint32)rect.width() << (quint32)rect.height();
+            dataSize += rect.width() * rect.height() * bpp;
+        }
+        stream << dataSize;
+        foreach (const QRect &rect, m_dirtyRects) {
+            for (int y = rect.top(); y <= rect.bottom(); ++y)
+                stream.device()->write((const char *)img.constScanLine(y) + rect.x() * bpp, rect.width() * bpp);
+        }
+        break;
+    }
+    case TransferImage::LZ4Format:
+    {
+        writeImageHeader(stream, img);
+        QVector<const uchar *> rows, aboveRows;
+        QVector<int> lengths;
+        rows.reserve(img.height());
+        aboveRows.reserve(img.height());
+        lengths.reserve(img.height());
+        for (int y = 0; y < img.height(); ++y) {
+            rows.push_back(img.constScanLine(y));
+            aboveRows.push_back(y > 0 ? img.constScanLine(y - 1) : Q_NULLPTR);
+            lengths.push_back(img.bytesPerLine());
+        }
+        stream << packRows(rows, aboveRows, lengths, filterBytesPerPixel(img));
+        break;
+    }
+    case TransferImage::DeltaLZ4Format:
+    {
+        writeImageHeader(stream, img);
+        const int bpp = bytesPerPixel(img);
+        QVector<const uchar *> rows, aboveRows;
+        QVector<int> lengths;
+        stream << (quint32)m_dirtyRects.size();
+        foreach (const QRect &rect, m_dirtyRects) {
+            stream << (quint32)rect.x() << (quint32)rect.y() << (quint32)rect.width() << (quint32)rect.height();
+            for (int y = rect.top(); y <= rect.bottom(); ++y) {
+                rows.push_back(img.constScanLine(y) + rect.x() * bpp);
+                aboveRows.push_back(y > rect.top() ? rows.at(rows.size() - 2) : Q_NULLPTR);
+                lengths.push_back(rect.width() * bpp);
+            }
+        }
+        stream << packRows(rows, aboveRows, lengths, bpp);
+        break;
+    }
+    case TransferImage::JpegFormat:
+    {
+        writeImageHeader(stream, img);
+        QByteArray data;
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::WriteOnly);
+        img.save(&buffer, "JPG", quality);
+        stream << data;
+        break;
+    }
     }
+}
 
+QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image)
+{
+    if (!image.m_encoded.isEmpty())
+        stream.writeRawData(image.m_encoded.constData(), image.m_encoded.size());
+    else
+        image.write(stream, TransferImage::RawEncoding, -1);
     return stream;
 }
 
@@ -105,6 +486,102 @@ QDataStream &operator>>(QDataStream &stream, TransferImage &image)
         image.setImage(img);
         break;
     }
+    case TransferImage::DeltaFormat:
+    case TransferImage::DeltaLZ4Format:
+    {
+        double r;
+        quint32 f, w, h, count;
+        stream >> r >> f >> w >> h >> count;
+        image.setImage(QImage());
+        image.m_delta = true;
+        image.m_deltaPixelRatio = r;
+        image.m_deltaFormat = f;
+        image.m_deltaSize = QSize(w, h);
+
+        image.m_dirtyRects.reserve(count);
+        for (quint32 j = 0; j < count; ++j) {
+            quint32 x, y, rw, rh;
+            stream >> x >> y >> rw >> rh;
+            image.m_dirtyRects.push_back(QRect(x, y, rw, rh));
+        }
+        if (format == TransferImage::DeltaFormat) {
+            quint32 dataSize;
+            stream >> dataSize;
+            image.m_dirtyData = stream.device()->read(dataSize);
+            break;
+        }
+
+        QByteArray compressed;
+        stream >> compressed;
+        const int bpp = bytesPerPixel(QImage(1, 1, static_cast<QImage::Format>(f)));
+        int dataSize = 0;
+        foreach (const QRect &rect, image.m_dirtyRects)
+            dataSize += rect.width() * rect.height() * bpp;
+        image.m_dirtyData.resize(dataSize);
+        QVector<uchar *> rows;
+        QVector<const uchar *> aboveRows;
+        QVector<int> lengths;
+        uchar *row = reinterpret_cast<uchar *>(image.m_dirtyData.data());
+        foreach (const QRect &rect, image.m_dirtyRects) {
+            for (int y = 0; y < rect.height(); ++y) {
+                rows.push_back(row);
+                aboveRows.push_back(y > 0 ? row - rect.width() * bpp : Q_NULLPTR);
+                lengths.push_back(rect.width() * bpp);
+                row += rect.width() * bpp;
+            }
+        }
+        if (bpp == 0 || !unpackRows(compressed, rows, aboveRows, lengths, bpp)) {
+            qWarning() << "Failed to decompress remote image delta.";
+            image.m_dirtyRects.clear();
+            image.m_dirtyData.clear();
+            image.m_deltaSize = QSize(); // makes applyTo() fail, so we get a full image next
+        }
+        break;
+    }
+    case TransferImage::LZ4Format:
+    {
+        double r;
+        quint32 f, w, h;
+        QByteArray compressed;
+        stream >> r >> f >> w >> h >> compressed;
+        QImage img(w, h, static_cast<QImage::Format>(f));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        img.setDevicePixelRatio(r);
+#endif
+        QVector<uchar *> rows;
+        QVector<const uchar *> aboveRows;
+        QVector<int> lengths;
+        rows.reserve(img.height());
+        aboveRows.reserve(img.height());
+        lengths.reserve(img.height());
+        for (int y = 0; y < img.height(); ++y) {
+            rows.push_back(img.scanLine(y));
+            aboveRows.push_back(y > 0 ? img.constScanLine(y - 1) : Q_NULLPTR);
+            lengths.push_back(img.bytesPerLine());
+        }
+        if (!unpackRows(compressed, rows, aboveRows, lengths, filterBytesPerPixel(img))) {
+            qWarning() << "Failed to decompress remote image.";
+            img = QImage();
+        }
+        image.setImage(img);
+        break;
+    }
+    case TransferImage::JpegFormat:
+    {
+        double r;
+        quint32 f, w, h;
+        QByteArray data;
+        stream >> r >> f >> w >> h >> data;
+        QImage img = QImage::fromData(data, "JPG");
+        // keep the original format, so deltas against this image can be applied
+        if (!img.isNull())
+            img = img.convertToFormat(static_cast<QImage::Format>(f));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        img.setDevicePixelRatio(r);
+#endif
+        image.setImage(img);
+        break;
+    }
     }
 
     return stream;
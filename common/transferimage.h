@@ -29,13 +29,17 @@
 #ifndef GAMMARAY_TRANSFERIMAGE_H
 #define GAMMARAY_TRANSFERIMAGE_H
 
+#include "gammaray_common_export.h"
+
 #include <QDataStream>
 #include <QImage>
+#include <QRect>
 #include <QVariant>
+#include <QVector>
 
 namespace GammaRay {
 /** Wrapper class for a QImage to allow raw data transfer over a QDataStream, bypassing the usuale PNG encoding. */
-class TransferImage
+class GAMMARAY_COMMON_EXPORT TransferImage
 {
 public:
     TransferImage();
@@ -44,17 +48,70 @@ public:
     const QImage &image() const;
     void setImage(const QImage &image);
 
+    /** Only transfer the 64x64 tiles that differ from @p base, ie. the image previously sent to the receiver.
+     *  If @p base is incompatible with the current image, or most of the image changed, the full image is sent.
+     */
+    void setDeltaBase(const QImage &base);
+
+    /** Returns @c true if this is a received image that only contains the tiles changed since the previous one.
+     *  Use applyTo() to obtain the full image.
+     */
+    bool isPartial() const;
+    /** Patches the changed tiles into @p base.
+     *  @returns @c false if @p base does not match the image this delta was computed against.
+     */
+    bool applyTo(QImage &base) const;
+
+    enum Encoding {
+        RawEncoding, ///< uncompressed, the default
+        LosslessEncoding, ///< per-scanline prediction filter and LZ4
+        LossyEncoding ///< JPEG, only used for full opaque images, others are encoded lossless
+    };
+
+    /** Serializes the image (or the delta, see setDeltaBase()) ahead of time, so that writing
+     *  it to a stream afterwards only copies the result. This doesn't touch any shared state
+     *  and can therefore be done off the GUI thread.
+     *  @p quality is the JPEG quality (0-100) for LossyEncoding, -1 for the default.
+     *  @returns the encoding actually used.
+     */
+    Encoding encode(Encoding encoding, int quality = -1);
+    /** Size of the result of the last encode() call, 0 if not encoded. */
+    int encodedSize() const;
+
+    /** The Protocol::ImageEncoding flags this process can produce. */
+    static quint8 supportedEncoders();
+    /** The Protocol::ImageEncoding flags this process can read. */
+    static quint8 supportedDecoders();
+
     enum Format {
         QImageFormat,
-        RawFormat
+        RawFormat,
+        DeltaFormat,
+        LZ4Format,
+        DeltaLZ4Format,
+        JpegFormat
     };
 
 private:
+    friend QDataStream &operator<<(QDataStream &stream, const TransferImage &image);
+    friend QDataStream &operator>>(QDataStream &stream, TransferImage &image);
+    void write(QDataStream &stream, Encoding encoding, int quality) const;
+
     QImage m_image;
+    QVector<QRect> m_dirtyRects;
+    bool m_delta;
+    // result of encode(), written as-is if set
+    QByteArray m_encoded;
+
+    // receiver side of a delta transfer
+    QByteArray m_dirtyData;
+    QSize m_deltaSize;
+    quint32 m_deltaFormat;
+    double m_deltaPixelRatio;
 };
 
-QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image);
-QDataStream &operator>>(QDataStream &stream, GammaRay::TransferImage &image);
+GAMMARAY_COMMON_EXPORT QDataStream &operator<<(QDataStream &stream, const GammaRay::TransferImage &image);
+GAMMARAY_COMMON_EXPORT QDataStream &operator>>(QDataStream &stream, GammaRay::TransferImage &image);
 }
 
 Q_DECLARE_METATYPE(GammaRay::TransferImage)
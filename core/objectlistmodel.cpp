@@ -31,6 +31,7 @@
 #include "probe.h"
 
 #include <QThread>
+#include <QTimer>
 #include <QCoreApplication>
 
 #include <algorithm>
@@ -41,7 +42,12 @@ using namespace std;
 
 ObjectListModel::ObjectListModel(Probe *probe)
     : ObjectModelBase< QAbstractTableModel >(probe)
+    , m_pendingTimer(new QTimer(this))
 {
+    m_pendingTimer->setSingleShot(true);
+    m_pendingTimer->setInterval(0);
+    connect(m_pendingTimer, SIGNAL(timeout()), this, SLOT(insertPendingObjects()));
+
     connect(probe, SIGNAL(objectCreated(QObject*)),
             this, SLOT(objectAdded(QObject*)));
     connect(probe, SIGNAL(objectDestroyed(QObject*)),
@@ -56,9 +62,9 @@ QPair<int, QVariant> ObjectListModel::defaultSelectedItem() const
 
 QVariant ObjectListModel::data(const QModelIndex &index, int role) const
 {
-    QMutexLocker lock(Probe::objectLock());
     if (index.row() >= 0 && index.row() < m_objects.size()) {
         QObject *obj = m_objects.at(index.row());
+        QMutexLocker lock(Probe::objectLock(obj));
         if (Probe::instance()->isValidObject(obj))
             return dataForObject(obj, index, role);
     }
@@ -87,22 +93,34 @@ void ObjectListModel::objectAdded(QObject *obj)
     Q_ASSERT(obj);
     Q_ASSERT(Probe::instance()->isValidObject(obj));
 
-    QVector<QObject *>::iterator it = std::lower_bound(m_objects.begin(), m_objects.end(), obj);
-    Q_ASSERT(it == m_objects.end() || *it != obj);
+    m_pendingObjects.insert(obj);
+    if (!m_pendingTimer->isActive())
+        m_pendingTimer->start();
+}
 
-    const int row = std::distance(m_objects.begin(), it);
-    Q_ASSERT(row >= 0 && row <= m_objects.size());
+void ObjectListModel::insertPendingObjects()
+{
+    Probe::ObjectRegistryLocker lock;
 
-    beginInsertRows(QModelIndex(), row, row);
-    m_objects.insert(it, obj);
-    Q_ASSERT(m_objects.at(row) == obj);
-    endInsertRows();
+    QVector<QObject *> newObjects;
+    newObjects.reserve(m_pendingObjects.size());
+    foreach (QObject *obj, m_pendingObjects) {
+        if (Probe::instance()->isValidObject(obj))
+            newObjects.push_back(obj);
+    }
+    m_pendingObjects.clear();
+
+    std::sort(newObjects.begin(), newObjects.end());
+    insertSortedObjects(QModelIndex(), m_objects, newObjects);
 }
 
 void ObjectListModel::objectRemoved(QObject *obj)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
+    if (m_pendingObjects.remove(obj))
+        return; // never made it into the model
+
     QVector<QObject *>::iterator it = std::lower_bound(m_objects.begin(), m_objects.end(), obj);
     if (it == m_objects.end() || *it != obj) {
         // not found
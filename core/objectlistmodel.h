@@ -35,6 +35,10 @@
 #include <QVector>
 #include <QSet>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class Probe;
 
@@ -64,12 +68,16 @@ public slots:
 private slots:
     void objectAdded(QObject *obj);
     void objectRemoved(QObject *obj);
+    void insertPendingObjects();
 
 private:
     void removeObject(QObject *obj);
 
     // sorted vector for stable iterators/indexes, esp. for the model methods
     QVector<QObject *> m_objects;
+    // objects created during the current event loop iteration, inserted in one batch
+    QSet<QObject *> m_pendingObjects;
+    QTimer *m_pendingTimer;
 };
 }
 
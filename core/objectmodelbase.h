@@ -42,11 +42,15 @@
 #include "objectdataprovider.h"
 
 #include <common/objectid.h>
+#include <common/protocol.h>
 #include <common/objectmodel.h>
 #include <common/sourcelocation.h>
 
 #include <QModelIndex>
 #include <QObject>
+#include <QVector>
+
+#include <algorithm>
 
 namespace GammaRay {
 /**
@@ -113,9 +117,22 @@ public:
         return QVariant();
     }
 
+    /**
+     * Returns the data for all roles relevant for displaying @p index.
+     * Unlike QAbstractItemModel::itemData() this omits the roles that are expensive to
+     * compute and only needed on user interaction, such as Qt::ToolTipRole.
+     * Those are available via data(), remote clients request them on demand.
+     */
     QMap<int, QVariant> itemData(const QModelIndex &index) const
     {
-        QMap<int, QVariant> map = Base::itemData(index);
+        QMap<int, QVariant> map;
+        for (int role = 0; role < Qt::UserRole; ++role) {
+            if (Protocol::isOnDemandRole(role))
+                continue;
+            const QVariant value = this->data(index, role);
+            if (value.isValid())
+                map.insert(role, value);
+        }
         map.insert(ObjectModel::ObjectIdRole, this->data(index, ObjectModel::ObjectIdRole));
         auto loc = this->data(index, ObjectModel::CreationLocationRole);
         if (loc.isValid())
@@ -149,6 +166,68 @@ public:
         }
         return Base::headerData(section, orientation, role);
     }
+
+protected:
+    /**
+     * Merges @p newObjects into @p objects, the sorted list of children of @p parent.
+     * @p objects is resized once and merged from the back, so every existing object is
+     * moved at most once. Row insertions are then announced once per contiguous range of
+     * new rows, in ascending order, so the rows of each announced range are already final.
+     * @param newObjects must be sorted and must not contain any object from @p objects.
+     */
+    void insertSortedObjects(const QModelIndex &parent, QVector<QObject *> &objects,
+                             const QVector<QObject *> &newObjects)
+    {
+        if (newObjects.isEmpty())
+            return;
+
+        // find the runs of new objects ending up next to each other, as (row in objects, count)
+        QVector<QPair<int, int> > runs;
+        int searchStart = 0;
+        int first = 0;
+        while (first < newObjects.size()) {
+            const QVector<QObject *>::const_iterator it = std::lower_bound(
+                objects.constBegin() + searchStart, objects.constEnd(), newObjects.at(first));
+            const int row = std::distance(objects.constBegin(), it);
+
+            int last = first + 1;
+            if (it == objects.constEnd()) {
+                last = newObjects.size();
+            } else {
+                while (last < newObjects.size() && newObjects.at(last) < *it)
+                    ++last;
+            }
+            runs.push_back(qMakePair(row, last - first));
+
+            searchStart = row;
+            first = last;
+        }
+
+        int src = objects.size();
+        objects.resize(objects.size() + newObjects.size());
+        int dst = objects.size();
+        int next = newObjects.size();
+        for (int i = runs.size() - 1; i >= 0; --i) {
+            const int row = runs.at(i).first;
+            const int count = runs.at(i).second;
+            dst = std::copy_backward(objects.begin() + row, objects.begin() + src,
+                                     objects.begin() + dst) - objects.begin();
+            src = row;
+            next -= count;
+            dst -= count;
+            std::copy(newObjects.constBegin() + next, newObjects.constBegin() + next + count,
+                      objects.begin() + dst);
+        }
+
+        int inserted = 0;
+        for (int i = 0; i < runs.size(); ++i) {
+            const int row = runs.at(i).first + inserted;
+            const int count = runs.at(i).second;
+            Base::beginInsertRows(parent, row, row + count - 1);
+            Base::endInsertRows();
+            inserted += count;
+        }
+    }
 };
 }
 
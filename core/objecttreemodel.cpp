@@ -33,6 +33,7 @@
 #include <QEvent>
 #include <QMutex>
 #include <QThread>
+#include <QTimer>
 #include <QCoreApplication>
 
 #include <algorithm>
@@ -47,7 +48,12 @@ using namespace GammaRay;
 
 ObjectTreeModel::ObjectTreeModel(Probe *probe)
     : ObjectModelBase< QAbstractItemModel >(probe)
+    , m_pendingTimer(new QTimer(this))
 {
+    m_pendingTimer->setSingleShot(true);
+    m_pendingTimer->setInterval(0);
+    connect(m_pendingTimer, SIGNAL(timeout()), this, SLOT(insertPendingObjects()));
+
     connect(probe, SIGNAL(objectCreated(QObject*)),
             this, SLOT(objectAdded(QObject*)));
     connect(probe, SIGNAL(objectDestroyed(QObject*)),
@@ -75,43 +81,74 @@ void ObjectTreeModel::objectAdded(QObject *obj)
 
     IF_DEBUG(cout << "tree obj added: " << hex << obj << " p: " << parentObject(obj) << endl;
              )
-    Q_ASSERT(!obj->parent() || Probe::instance()->isValidObject(parentObject(obj)));
 
-    if (indexForObject(obj).isValid()) {
+    if (m_childParentMap.contains(obj)) {
         IF_DEBUG(cout << "tree double obj added: " << hex << obj << endl;
                  )
         return;
     }
 
+    // the parent is looked up when inserting, so reparenting until then is handled implicitly
+    m_pendingObjects.insert(obj);
+    if (!m_pendingTimer->isActive())
+        m_pendingTimer->start();
+}
+
+void ObjectTreeModel::insertPendingObjects()
+{
+    Q_ASSERT(thread() == QThread::currentThread());
+    Probe::ObjectRegistryLocker lock;
+
+    // group new objects by parent
     // this is ugly, but apparently it can happen
     // that an object gets created without parent
     // then later the delayed signal comes in
-    // so catch this gracefully by first adding the
-    // parent if required
-    if (parentObject(obj)) {
-        const QModelIndex index = indexForObject(parentObject(obj));
-        if (!index.isValid()) {
-            IF_DEBUG(cout << "tree: handle parent first" << endl;
-                     )
-            objectAdded(parentObject(obj));
+    // so catch this gracefully by also adding unknown ancestors
+    QHash<QObject *, QVector<QObject *> > newChildren;
+    QSet<QObject *> newObjects;
+    foreach (QObject *obj, m_pendingObjects) {
+        for (QObject *o = obj; o; o = parentObject(o)) {
+            if (newObjects.contains(o) || m_childParentMap.contains(o))
+                break;
+            if (!Probe::instance()->isValidObject(o))
+                break;
+            newObjects.insert(o);
+            newChildren[parentObject(o)].push_back(o);
         }
     }
+    m_pendingObjects.clear();
 
-    const QModelIndex index = indexForObject(parentObject(obj));
-
-    // either we get a proper parent and hence valid index or there is no parent
-    Q_ASSERT(index.isValid() || !parentObject(obj));
+    // insert top-down, starting at parents already in the model
+    QVector<QObject *> parents;
+    for (auto it = newChildren.constBegin(); it != newChildren.constEnd(); ++it) {
+        if (!it.key() || m_childParentMap.contains(it.key()))
+            parents.push_back(it.key());
+    }
 
-    QVector<QObject *> &children = m_parentChildMap[ parentObject(obj) ];
-    QVector<QObject *>::iterator it = std::lower_bound(children.begin(), children.end(), obj);
-    const int row = std::distance(children.begin(), it);
+    while (!parents.isEmpty()) {
+        QObject *parent = parents.last();
+        parents.pop_back();
 
-    beginInsertRows(index, row, row);
+        QVector<QObject *> children = newChildren.take(parent);
+        std::sort(children.begin(), children.end());
+        foreach (QObject *child, children) {
+            m_childParentMap.insert(child, parent);
+            if (newChildren.contains(child))
+                parents.push_back(child);
+        }
 
-    children.insert(it, obj);
-    m_childParentMap.insert(obj, parentObject(obj));
+        const QModelIndex index = indexForObject(parent);
+        // either we get a proper parent and hence valid index or there is no parent
+        Q_ASSERT(index.isValid() || !parent);
+        insertSortedObjects(index, m_parentChildMap[parent], children);
+    }
 
-    endInsertRows();
+    // what is left has an ancestor that is not known yet, e.g. because it is still
+    // queued in the probe, keep those pending until that ancestor gets added
+    for (auto it = newChildren.constBegin(); it != newChildren.constEnd(); ++it) {
+        foreach (QObject *obj, it.value())
+            m_pendingObjects.insert(obj);
+    }
 }
 
 void ObjectTreeModel::objectRemoved(QObject *obj)
@@ -127,6 +164,9 @@ void ObjectTreeModel::objectRemoved(QObject *obj)
              << m_parentChildMap.contains(obj) << endl;
              )
 
+    if (m_pendingObjects.remove(obj))
+        return; // never made it into the model
+
     if (!m_childParentMap.contains(obj)) {
         Q_ASSERT(!m_parentChildMap.contains(obj));
         return;
@@ -161,12 +201,20 @@ void ObjectTreeModel::objectReparented(QObject *obj)
     IF_DEBUG(cout << "object reparented: " << hex << obj << dec << endl;
              )
 
-    QMutexLocker objectLock(Probe::objectLock());
+    Probe::ObjectRegistryLocker lock;
     if (!Probe::instance()->isValidObject(obj)) {
         objectRemoved(obj);
         return;
     }
 
+    // not inserted yet, will end up at the right place anyway
+    if (m_pendingObjects.contains(obj))
+        return;
+
+    // the new parent might not be inserted yet
+    if (!m_pendingObjects.isEmpty())
+        insertPendingObjects();
+
     // we didn't know obj yet
     if (!m_childParentMap.contains(obj)) {
         Q_ASSERT(!m_parentChildMap.contains(obj));
@@ -212,7 +260,7 @@ QVariant ObjectTreeModel::data(const QModelIndex &index, int role) const
 
     QObject *obj = reinterpret_cast<QObject *>(index.internalPointer());
 
-    QMutexLocker lock(Probe::objectLock());
+    QMutexLocker lock(Probe::objectLock(obj));
     if (Probe::instance()->isValidObject(obj)) {
         return dataForObject(obj, index, role);
     } else if (role == Qt::DisplayRole) {
@@ -31,8 +31,13 @@
 
 #include "objectmodelbase.h"
 
+#include <QSet>
 #include <QVector>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class Probe;
 
@@ -55,6 +60,7 @@ private slots:
     void objectAdded(QObject *obj);
     void objectRemoved(QObject *obj);
     void objectReparented(QObject *obj);
+    void insertPendingObjects();
 
 private:
     QModelIndex indexForObject(QObject *object) const;
@@ -62,6 +68,9 @@ private:
 private:
     QHash<QObject *, QObject *> m_childParentMap;
     QHash<QObject *, QVector<QObject *> > m_parentChildMap;
+    // objects created during the current event loop iteration, inserted in one batch
+    QSet<QObject *> m_pendingObjects;
+    QTimer *m_pendingTimer;
 };
 }
 
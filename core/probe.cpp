@@ -49,6 +49,7 @@
 #include "remote/selectionmodelserver.h"
 #include "toolpluginerrormodel.h"
 #include "probeguard.h"
+#include "stripedobjectset.h"
 
 #include <common/objectbroker.h>
 #include <common/streamoperators.h>
@@ -100,6 +101,11 @@ using namespace std;
 
 QAtomicPointer<Probe> Probe::s_instance = QAtomicPointer<Probe>(0);
 
+// the global object lock, see Probe::objectLock()
+// also protects the bookkeeping of objects added before the probe instance exists
+// and of pending reparentings, object additions and removals don't need it
+Q_GLOBAL_STATIC_WITH_ARGS(QMutex, s_lock, (QMutex::Recursive))
+
 namespace GammaRay {
 static void signal_begin_callback(QObject *caller, int method_index, void **argv)
 {
@@ -117,10 +123,12 @@ static void signal_begin_callback(QObject *caller, int method_index, void **argv
 
 static void signal_end_callback(QObject *caller, int method_index)
 {
-    if (method_index == 0)
+    if (method_index == 0 || !Probe::instance()->isValidObject(caller))
         return;
 
-    QMutexLocker locker(Probe::objectLock());
+    // the callbacks might look at other objects too
+    QMutexLocker globalLocker(Probe::objectLock());
+    QMutexLocker locker(Probe::objectLock(caller));
     if (!Probe::instance()->isValidObject(caller)) // implies filterObject()
         return; // deleted in the slot
 
@@ -146,10 +154,12 @@ static void slot_begin_callback(QObject *caller, int method_index, void **argv)
 
 static void slot_end_callback(QObject *caller, int method_index)
 {
-    if (method_index == 0)
+    if (method_index == 0 || !Probe::instance()->isValidObject(caller))
         return;
 
-    QMutexLocker locker(Probe::objectLock());
+    // the callbacks might look at other objects too
+    QMutexLocker globalLocker(Probe::objectLock());
+    QMutexLocker locker(Probe::objectLock(caller));
     if (!Probe::instance()->isValidObject(caller)) // implies filterObject()
         return; // deleted in the slot
 
@@ -199,9 +209,15 @@ struct Listener
 
 Q_GLOBAL_STATIC(Listener, s_listener)
 
-// ensures proper information is returned by isValidObject by
-// locking it in objectAdded/Removed
-Q_GLOBAL_STATIC_WITH_ARGS(QMutex, s_lock, (QMutex::Recursive))
+template<typename T>
+static inline T *loadAcquire(QAtomicPointer<T> &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.loadAcquire();
+#else
+    return value.fetchAndAddAcquire(0);
+#endif
+}
 
 Probe::Probe(QObject *parent)
     : QObject(parent)
@@ -209,6 +225,8 @@ Probe::Probe(QObject *parent)
     , m_objectTreeModel(new ObjectTreeModel(this))
     , m_metaObjectTreeModel(new MetaObjectTreeModel(this))
     , m_window(0)
+    , m_validObjects(new StripedObjectSet)
+    , m_queuedObjectChanges(0)
     , m_queueTimer(new QTimer(this))
     , m_server(Q_NULLPTR)
 {
@@ -273,6 +291,14 @@ Probe::~Probe()
     VariantHandler::clear();
 
     s_instance = QAtomicPointer<Probe>(0);
+    delete m_validObjects;
+
+    ObjectChange *change = m_queuedObjectChanges.fetchAndStoreAcquire(0);
+    while (change) {
+        ObjectChange *next = change->next;
+        delete change;
+        change = next;
+    }
 }
 
 void Probe::setWindow(QObject *window)
@@ -501,9 +527,9 @@ QObject *Probe::probe() const
 
 bool Probe::isValidObject(QObject *obj) const
 {
-    ///TODO: can we somehow assert(s_lock().isLocked()) ?!
-    ///  -> Not with a recursive mutex. Make it non-recursive, and you can do Q_ASSERT(!s_lock().tryLock());
-    return m_validObjects.contains(obj);
+    // thread-safe on its own, only contends with lookups/changes of objects in the same stripe
+    // the object lock is needed only for the result to stay valid beyond this call
+    return m_validObjects->contains(obj);
 }
 
 QMutex *Probe::objectLock()
@@ -511,6 +537,24 @@ QMutex *Probe::objectLock()
     return s_lock();
 }
 
+QMutex *Probe::objectLock(QObject *obj)
+{
+    return instance()->m_validObjects->mutex(obj);
+}
+
+Probe::ObjectRegistryLocker::ObjectRegistryLocker()
+{
+    // the global lock first, holding several stripes is only allowed with it
+    s_lock()->lock();
+    Probe::instance()->m_validObjects->lockAll();
+}
+
+Probe::ObjectRegistryLocker::~ObjectRegistryLocker()
+{
+    Probe::instance()->m_validObjects->unlockAll();
+    s_lock()->unlock();
+}
+
 /*
  * We need to handle 4 different cases in here:
  * (1) our thread, from ctor:
@@ -526,12 +570,10 @@ QMutex *Probe::objectLock()
  * - post information to our thread
  * - emit objectCreated there right away if object still valid
  *
- * Pre-conditions: lock may or may not be held already, arbitrary thread
+ * Pre-conditions: arbitrary thread
  */
 void Probe::objectAdded(QObject *obj, bool fromCtor)
 {
-    QMutexLocker lock(s_lock());
-
     // attempt to ignore objects created by GammaRay itself, especially short-lived ones
     if (fromCtor && ProbeGuard::insideProbe() && obj->thread() == QThread::currentThread())
         return;
@@ -544,16 +586,26 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
 #endif
 
     if (!isInitialized()) {
-        IF_DEBUG(cout
-                 << "objectAdded Before: "
-                 << hex << obj
-                 << (fromCtor ? " (from ctor)" : "") << endl;
-                 )
-        s_listener()->addedBeforeProbeInstance << obj;
-        return;
+        QMutexLocker lock(s_lock());
+        // the probe instance is published with the lock held, check again
+        if (!isInitialized()) {
+            IF_DEBUG(cout
+                     << "objectAdded Before: "
+                     << hex << obj
+                     << (fromCtor ? " (from ctor)" : "") << endl;
+                     )
+            s_listener()->addedBeforeProbeInstance << obj;
+            return;
+        }
     }
 
-    if (instance()->filterObject(obj)) {
+    instance()->addObject(obj, fromCtor);
+}
+
+// pre-conditions: probe is initialized, arbitrary thread
+void Probe::addObject(QObject *obj, bool fromCtor)
+{
+    if (filterObject(obj)) {
         IF_DEBUG(cout
                  << "objectAdded Filter: "
                  << hex << obj
@@ -562,7 +614,7 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
         return;
     }
 
-    if (instance()->m_validObjects.contains(obj)) {
+    if (m_validObjects->contains(obj)) {
         // this happens when we get a child event before the objectAdded call from the ctor
         // or when we add an item from addedBeforeProbeInstance who got added already
         // due to the add-parent-before-child logic
@@ -575,65 +627,95 @@ void Probe::objectAdded(QObject *obj, bool fromCtor)
     }
 
     // make sure we already know the parent
-    if (obj->parent() && !instance()->m_validObjects.contains(obj->parent()))
-        objectAdded(obj->parent(), fromCtor);
-    Q_ASSERT(!obj->parent() || instance()->m_validObjects.contains(obj->parent()));
-
-    instance()->m_validObjects << obj;
-    if (!instance()->hasReliableObjectTracking()) {
-        // when we did not use a preload variant that
-        // overwrites qt_removeObject we must track object
-        // deletion manually
-        connect(obj, SIGNAL(destroyed(QObject*)),
-                instance(), SLOT(handleObjectDestroyed(QObject*)),
-                Qt::DirectConnection);
+    QObject *parent = obj->parent();
+    if (parent && !m_validObjects->contains(parent)) {
+        addObject(parent, fromCtor);
+        Q_ASSERT(m_validObjects->contains(parent));
     }
 
-    if (!fromCtor && obj->parent() && instance()->isObjectCreationQueued(obj->parent())) {
+    if (!fromCtor && parent && isObjectCreationQueued(parent)) {
         // when a child event triggers a call to objectAdded while inside the ctor
         // the parent is already tracked but it's call to objectFullyConstructed
         // was delayed. hence we must do the same for the child for integrity
         fromCtor = true;
     }
 
+    ObjectChange *change = 0;
+    if (fromCtor) {
+        change = new ObjectChange;
+        change->obj = obj;
+        change->type = ObjectChange::Create;
+    }
+    if (!m_validObjects->insert(obj, change)) {
+        // added concurrently by another thread
+        delete change;
+        return;
+    }
+
+    if (!hasReliableObjectTracking()) {
+        // when we did not use a preload variant that
+        // overwrites qt_removeObject we must track object
+        // deletion manually
+        connect(obj, SIGNAL(destroyed(QObject*)),
+                this, SLOT(handleObjectDestroyed(QObject*)),
+                Qt::DirectConnection);
+    }
+
     IF_DEBUG(cout << "objectAdded: " << hex << obj
                   << (fromCtor ? " (from ctor)" : "")
-                  << ", p: " << obj->parent() << endl;
+                  << ", p: " << parent << endl;
              )
 
-    if (fromCtor)
-        instance()->queueCreatedObject(obj);
-    else
-        instance()->objectFullyConstructed(obj);
+    if (change) {
+        queueObjectChange(change);
+    } else {
+        QMutexLocker globalLock(s_lock());
+        QMutexLocker lock(objectLock(obj));
+        objectFullyConstructed(obj);
+    }
 }
 
-// pre-conditions: lock may or may not be held already, our thread
+// pre-conditions: our thread
 void Probe::processQueuedObjectChanges()
 {
-    QMutexLocker lock(s_lock());
-
-    IF_DEBUG(cout << Q_FUNC_INFO << " " << m_queuedObjectChanges.size() << endl;
-             )
-
     // must be called from the main thread via timeout
     Q_ASSERT(QThread::currentThread() == thread());
 
-    foreach (const auto &change, m_queuedObjectChanges) {
-        switch (change.type) {
-        case ObjectChange::Create:
-            objectFullyConstructed(change.obj);
-            break;
-        case ObjectChange::Destroy:
-            emit objectDestroyed(change.obj);
-            break;
+    // changes queued while we process this are handled in the same run
+    while (ObjectChange *head = m_queuedObjectChanges.fetchAndStoreAcquire(0)) {
+        QVector<ObjectChange *> changes;
+        for (ObjectChange *change = head; change; change = change->next)
+            changes.push_back(change);
+
+        IF_DEBUG(cout << Q_FUNC_INFO << " " << changes.size() << endl;
+                 )
+
+        for (int i = changes.size() - 1; i >= 0; --i) {
+            ObjectChange *change = changes.at(i);
+            switch (change->type) {
+            case ObjectChange::Create:
+            {
+                // looks at the parents and emits objectCreated(), so we need the global lock too
+                QMutexLocker globalLock(s_lock());
+                QMutexLocker lock(objectLock(change->obj));
+                // skip objects destroyed meanwhile, nobody has been told about those yet,
+                // so there's nobody to tell about their removal either
+                if (m_validObjects->takePendingCreation(change->obj, change))
+                    objectFullyConstructed(change->obj);
+                break;
+            }
+            case ObjectChange::Destroy:
+                emit objectDestroyed(change->obj);
+                break;
+            }
+            delete change;
         }
     }
 
     IF_DEBUG(cout << Q_FUNC_INFO << " done" << endl;
              )
 
-    m_queuedObjectChanges.clear();
-
+    QMutexLocker lock(s_lock());
     foreach (QObject *obj, m_pendingReparents) {
         if (!isValidObject(obj))
             continue;
@@ -645,12 +727,12 @@ void Probe::processQueuedObjectChanges()
     m_pendingReparents.clear();
 }
 
-// pre-condition: lock is held already, our thread
+// pre-condition: global objectLock() and objectLock() of obj are held, our thread
 void Probe::objectFullyConstructed(QObject *obj)
 {
     Q_ASSERT(thread() == QThread::currentThread());
 
-    if (!m_validObjects.contains(obj)) {
+    if (!m_validObjects->contains(obj)) {
         // deleted already
         IF_DEBUG(cout << "stale fully constructed: " << hex << obj << endl;
                  )
@@ -661,7 +743,7 @@ void Probe::objectFullyConstructed(QObject *obj)
         // when the call was delayed from the ctor construction,
         // the parent might not have been set properly yet. hence
         // apply the filter again
-        m_validObjects.remove(obj);
+        m_validObjects->remove(obj);
         IF_DEBUG(cout << "now filtered fully constructed: " << hex << obj << endl;
                  )
         return;
@@ -672,12 +754,12 @@ void Probe::objectFullyConstructed(QObject *obj)
 
     // ensure we know all our ancestors already
     for (QObject *parent = obj->parent(); parent; parent = parent->parent()) {
-        if (!m_validObjects.contains(parent)) {
+        if (!m_validObjects->contains(parent)) {
             objectAdded(parent); // will also handle any further ancestors
             break;
         }
     }
-    Q_ASSERT(!obj->parent() || m_validObjects.contains(obj->parent()));
+    Q_ASSERT(!obj->parent() || m_validObjects->contains(obj->parent()));
 
     // QQuickItem has the briliant idea of suppressing child events, so we need an
     // alternative way of detecting reparenting...
@@ -697,13 +779,19 @@ void Probe::objectFullyConstructed(QObject *obj)
  * (2) other thread:
  * - post information to our thread, emit objectDestroyed() there
  *
- * pre-conditions: arbitrary thread, lock may or may not be held already
+ * pre-conditions: arbitrary thread
  */
 void Probe::objectRemoved(QObject *obj)
 {
-    QMutexLocker lock(s_lock());
-
     if (!isInitialized()) {
+        QMutexLocker lock(s_lock());
+        if (isInitialized()) {
+            // the probe instance got published meanwhile
+            lock.unlock();
+            objectRemoved(obj);
+            return;
+        }
+
         IF_DEBUG(cout
                  << "objectRemoved Before: "
                  << hex << obj
@@ -723,23 +811,30 @@ void Probe::objectRemoved(QObject *obj)
         return;
     }
 
-    IF_DEBUG(cout << "object removed:" << hex << obj << " " << obj->parent() << endl;
-             )
-
-    bool success = instance()->m_validObjects.remove(obj);
-    if (!success) {
+    Probe *probe = instance();
+    const void *pendingCreation = 0;
+    if (!probe->m_validObjects->remove(obj, &pendingCreation)) {
         // object was not tracked by the probe, probably a gammaray object
-        EXPENSIVE_ASSERT(!instance()->isObjectCreationQueued(obj));
         return;
     }
 
-    instance()->purgeChangesForObject(obj);
-    EXPENSIVE_ASSERT(!instance()->isObjectCreationQueued(obj));
+    IF_DEBUG(cout << "object removed:" << hex << obj << endl;
+             )
+
+    if (pendingCreation) {
+        // nobody has been told about this object yet, so there's nobody to tell about its removal either
+        // the queued creation is discarded when processed, as it no longer matches
+        return;
+    }
 
-    if (instance()->thread() == QThread::currentThread())
-        emit instance()->objectDestroyed(obj);
-    else
-        instance()->queueDestroyedObject(obj);
+    if (probe->thread() == QThread::currentThread()) {
+        emit probe->objectDestroyed(obj);
+    } else {
+        ObjectChange *change = new ObjectChange;
+        change->obj = obj;
+        change->type = ObjectChange::Destroy;
+        probe->queueObjectChange(change);
+    }
 }
 
 void Probe::handleObjectDestroyed(QObject *obj)
@@ -753,50 +848,27 @@ void Probe::objectParentChanged()
         emit objectReparented(sender());
 }
 
-// pre-condition: we have the lock, arbitrary thread
-void Probe::queueCreatedObject(QObject *obj)
+// pre-condition: arbitrary thread
+void Probe::queueObjectChange(ObjectChange *change)
 {
-    EXPENSIVE_ASSERT(!isObjectCreationQueued(obj));
-
-    ObjectChange c;
-    c.obj = obj;
-    c.type = ObjectChange::Create;
-    m_queuedObjectChanges.push_back(c);
-    notifyQueuedObjectChanges();
-}
+    ObjectChange *head;
+    do {
+        head = loadAcquire(m_queuedObjectChanges);
+        change->next = head;
+    } while (!m_queuedObjectChanges.testAndSetRelease(head, change));
 
-// pre-condition: we have the lock, arbitrary thread
-void Probe::queueDestroyedObject(QObject *obj)
-{
-    ObjectChange c;
-    c.obj = obj;
-    c.type = ObjectChange::Destroy;
-    m_queuedObjectChanges.push_back(c);
-    notifyQueuedObjectChanges();
+    // whoever finds the queue empty schedules processing
+    if (!head)
+        notifyQueuedObjectChanges();
 }
 
-// pre-condition: we have the lock, arbitrary thread
+// pre-condition: arbitrary thread
 bool Probe::isObjectCreationQueued(QObject *obj) const
 {
-    return std::find_if(m_queuedObjectChanges.begin(), m_queuedObjectChanges.end(),
-                        [obj](const ObjectChange &c) {
-        return c.obj == obj && c.type == Probe::ObjectChange::Create;
-    }) != m_queuedObjectChanges.end();
+    return m_validObjects->isCreationPending(obj);
 }
 
-// pre-condition: we have the lock, arbitrary thread
-void Probe::purgeChangesForObject(QObject *obj)
-{
-    for (int i = 0; i < m_queuedObjectChanges.size(); ++i) {
-        if (m_queuedObjectChanges.at(i).obj == obj
-            && m_queuedObjectChanges.at(i).type == ObjectChange::Create) {
-            m_queuedObjectChanges.remove(i);
-            return;
-        }
-    }
-}
-
-// pre-condition: we have the lock, arbitrary thread
+// pre-condition: arbitrary thread
 void Probe::notifyQueuedObjectChanges()
 {
     if (m_queueTimer->isActive())
@@ -825,8 +897,7 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
         QChildEvent *childEvent = static_cast<QChildEvent *>(event);
         QObject *obj = childEvent->child();
 
-        QMutexLocker lock(s_lock());
-        const bool tracked = m_validObjects.contains(obj);
+        const bool tracked = m_validObjects->contains(obj);
         const bool filtered = filterObject(obj);
 
         IF_DEBUG(cout << "child event: " << hex << obj << ", p: " << obj->parent() << dec
@@ -846,11 +917,13 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
                 // BUT: only when we did not queue this item before
                 IF_DEBUG(cout << "update pos: " << hex << obj << endl;
                          )
+                QMutexLocker lock(s_lock());
                 m_pendingReparents.removeAll(obj);
                 emit objectReparented(obj);
             }
         } else if (tracked) {
             if (hasReliableObjectTracking()) { // defer processing this until we know its final location
+                QMutexLocker lock(s_lock());
                 m_pendingReparents.push_back(obj);
                 notifyQueuedObjectChanges();
             } else {
@@ -862,7 +935,7 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
     // widget only unfortunately, but more precise than ChildAdded/Removed...
     if (event->type() == QEvent::ParentChange) {
         QMutexLocker lock(s_lock());
-        const bool tracked = m_validObjects.contains(receiver);
+        const bool tracked = m_validObjects->contains(receiver);
         const bool filtered = filterObject(receiver);
         if (!filtered && tracked && !isObjectCreationQueued(receiver)
             && !isObjectCreationQueued(receiver->parent())) {
@@ -877,11 +950,9 @@ bool Probe::eventFilter(QObject *receiver, QEvent *event)
         && event->type() != QEvent::ParentChange // already handled above
         && event->type() != QEvent::Destroy
         && event->type() != QEvent::WinIdChange // unsafe since emitted from dtors
-        && !filterObject(receiver)) {
-        QMutexLocker lock(s_lock());
-        const bool tracked = m_validObjects.contains(receiver);
-        if (!tracked)
-            discoverObject(receiver);
+        && !filterObject(receiver)
+        && !m_validObjects->contains(receiver)) {
+        discoverObject(receiver);
     }
 
     // filters provided by plugins
@@ -910,13 +981,25 @@ void Probe::discoverObject(QObject *obj)
     if (!obj)
         return;
 
-    QMutexLocker lock(s_lock());
-    if (m_validObjects.contains(obj))
+    // register the entire subtree in one go, while nothing in it can get destroyed
+    ObjectRegistryLocker lock;
+    if (m_validObjects->contains(obj))
         return;
 
-    objectAdded(obj);
-    foreach (QObject *child, obj->children())
-        discoverObject(child);
+    QVector<QObject *> pending;
+    pending.push_back(obj);
+    while (!pending.isEmpty()) {
+        QObject *o = pending.last();
+        pending.pop_back();
+        if (m_validObjects->contains(o))
+            continue;
+
+        addObject(o, false);
+        const QObjectList &children = o->children();
+        // reverse, so we keep the pre-order of the previous recursive implementation
+        for (int i = children.size() - 1; i >= 0; --i)
+            pending.push_back(children.at(i));
+    }
 }
 
 void Probe::installGlobalEventFilter(QObject *filter)
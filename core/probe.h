@@ -34,6 +34,7 @@
 #include "signalspycallbackset.h"
 
 #include <QObject>
+#include <QHash>
 #include <QList>
 #include <QSet>
 #include <QVector>
@@ -55,6 +56,7 @@ class ObjectTreeModel;
 class MainWindow;
 class BenchSuite;
 class Server;
+class StripedObjectSet;
 class ToolManager;
 
 class GAMMARAY_CORE_EXPORT Probe : public QObject, public ProbeInterface
@@ -95,15 +97,52 @@ public:
     QObject *probe() const Q_DECL_OVERRIDE;
 
     /**
-     * Lock this to check the validity of a QObject
-     * and to access it safely afterwards.
+     * The global object lock.
+     *
+     * This has to be locked before objectLock(QObject*) if you need to access more than one
+     * object, or if you create objects, emit signals or call into other tools while holding
+     * an object lock. Only the thread holding it may hold several object locks at once.
+     * It does not prevent changes to the object registry on its own.
+     *
+     * Code written against the former single global lock can keep using this as is, as long as
+     * it additionally locks objectLock(QObject*) for every object it checks with isValidObject().
      */
     static QMutex *objectLock();
 
+    /**
+     * Lock this to check the validity of @p obj and to access it safely afterwards.
+     *
+     * This only blocks the registration and destruction of objects sharing a lock stripe
+     * with @p obj, so other threads are barely affected by holding it. Do not lock other
+     * objects, create or destroy objects, or emit signals while holding only this, lock
+     * objectLock() first in that case.
+     */
+    static QMutex *objectLock(QObject *obj);
+
+    /**
+     * Locks objectLock() and the entire object registry while it exists, ie. no objects are
+     * added to or removed from it meanwhile, in any thread.
+     *
+     * Use this only when you need a consistent view of many objects, e.g. when walking
+     * the object tree, objectLock(QObject*) is sufficient for accessing single objects.
+     */
+    class GAMMARAY_CORE_EXPORT ObjectRegistryLocker
+    {
+    public:
+        ObjectRegistryLocker();
+        ~ObjectRegistryLocker();
+
+    private:
+        Q_DISABLE_COPY(ObjectRegistryLocker)
+    };
+
     /**
      * check whether @p obj is still valid
      *
-     * NOTE: the objectLock must be locked when this is called!
+     * This is thread-safe and does not contend on any global lock, so it can be used
+     * as a cheap pre-check. If you want to access @p obj afterwards, objectLock(QObject*)
+     * must be locked when this is called though, as otherwise @p obj might get
+     * destroyed concurrently.
      */
     bool isValidObject(QObject *obj) const;
 
@@ -136,7 +175,7 @@ signals:
      *   tracking for objects from other threads. Use objectDestroyed() instead.
      * - Do not put @p obj into a QWeakPointer, even if it's exclusively handled in the same thread as
      *   the Probe instance. Qt4 asserts if target code tries to put @p obj into a QSharedPointer afterwards.
-     * - The objectLock() is locked.
+     * - The global objectLock() and the objectLock(QObject*) of @p obj are locked.
      */
     void objectCreated(QObject *obj);
 
@@ -149,7 +188,6 @@ signals:
      *   safe at this point.
      * - In a multi-threaded application, this signal might reach you way after @p obj has been
      *   destroyed, see isValidObject() for a way to check if the object is still valid before accessing it.
-     * - The objectLock() is locked.
      */
     void objectDestroyed(QObject *obj);
     void objectReparented(QObject *obj);
@@ -173,12 +211,12 @@ private:
      */
     bool hasReliableObjectTracking() const;
 
+    void addObject(QObject *obj, bool fromCtor);
     void objectFullyConstructed(QObject *obj);
 
-    void queueCreatedObject(QObject *obj);
-    void queueDestroyedObject(QObject *obj);
+    struct ObjectChange;
+    void queueObjectChange(ObjectChange *change);
     bool isObjectCreationQueued(QObject *obj) const;
-    void purgeChangesForObject(QObject *obj);
     void notifyQueuedObjectChanges();
 
     void findExistingObjects();
@@ -201,17 +239,20 @@ private:
     MetaObjectTreeModel *m_metaObjectTreeModel;
     ToolManager *m_toolManager;
     QObject *m_window;
-    QSet<QObject *> m_validObjects;
+    StripedObjectSet *m_validObjects;
 
     // all delayed object changes need to go through a single queue, as the order is crucial
+    // lock-free stack, in reverse order, the Create changes also serve as the pending creation
+    // token in m_validObjects, which is how changes of already destroyed objects are discarded
     struct ObjectChange {
         QObject *obj;
         enum Type {
             Create,
             Destroy
         } type;
+        ObjectChange *next;
     };
-    QVector<ObjectChange> m_queuedObjectChanges;
+    QAtomicPointer<ObjectChange> m_queuedObjectChanges;
 
     QList<QObject *> m_pendingReparents;
     QTimer *m_queueTimer;
@@ -38,23 +38,47 @@
 #include <QDataStream>
 #include <QDebug>
 #include <QBuffer>
+#include <QCryptographicHash>
 #include <QIcon>
+#include <QImage>
+#include <QPixmap>
+#include <QTimer>
+#include <QVarLengthArray>
 
 #include <iostream>
+#include <limits>
 
 using namespace GammaRay;
 using namespace std;
 
 void(*RemoteModelServer::s_registerServerCallback)() = 0;
 
+// roughly one frame, so continuously changing models don't update faster than the client repaints
+static const int DefaultFlushInterval = 16;
+static const int MaxFlushInterval = 250;
+static const int MaxPendingDataChanges = 256;
+// icon cache keys remembered before starting over, icons created on the fly each have their own
+static const int MaxIconCacheKeys = 4096;
+// distinct icons in the registry before starting over, bounds the icon cache of the client as well
+static const int MaxIcons = 1024;
+
 RemoteModelServer::RemoteModelServer(const QString &objectName, QObject *parent)
     : QObject(parent)
     , m_model(0)
     , m_dummyBuffer(new QBuffer(&m_dummyData, this))
+    , m_nextIconId(1)
     , m_monitored(false)
+    , m_flushTimer(new QTimer(this))
+    , m_flushInterval(DefaultFlushInterval)
+    , m_roundTripTime(0)
+    , m_nextHandle(Protocol::RootModelIndexHandle + 1)
+    , m_handleLookupDirty(false)
 {
     setObjectName(objectName);
     m_dummyBuffer->open(QIODevice::WriteOnly);
+    m_roundTripClock.invalidate();
+    m_flushTimer->setSingleShot(true);
+    connect(m_flushTimer, SIGNAL(timeout()), this, SLOT(flushPendingChanges()));
     registerServer();
 }
 
@@ -75,6 +99,7 @@ void RemoteModelServer::setModel(QAbstractItemModel *model)
     if (m_model)
         disconnectModel();
 
+    clearHandles();
     m_model = model;
     if (m_model && m_monitored)
         connectModel();
@@ -83,6 +108,18 @@ void RemoteModelServer::setModel(QAbstractItemModel *model)
         modelReset();
 }
 
+int RemoteModelServer::flushInterval() const
+{
+    return m_flushInterval;
+}
+
+void RemoteModelServer::setFlushInterval(int msecs)
+{
+    m_flushInterval = msecs;
+    if (m_flushInterval <= 0)
+        flushPendingChanges();
+}
+
 void RemoteModelServer::connectModel()
 {
     Q_ASSERT(m_model);
@@ -168,6 +205,9 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
         return;
 
     ProbeGuard g;
+    // replies must not overtake change notifications the client hasn't seen yet
+    flushPendingChanges();
+
     switch (msg.type()) {
     case Protocol::ModelRowColumnCountRequest:
     {
@@ -189,31 +229,25 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
 
     case Protocol::ModelContentRequest:
     {
+        quint8 addressing;
+        QVector<qint32> roles;
         quint32 size;
-        msg >> size;
+        msg >> addressing >> roles >> size;
         Q_ASSERT(size > 0);
 
-        QVector<QModelIndex> indexes;
-        indexes.reserve(size);
-        for (quint32 i = 0; i < size; ++i) {
-            Protocol::ModelIndex index;
-            msg >> index;
-            const QModelIndex qmIndex = Protocol::toQModelIndex(m_model, index);
-            if (!qmIndex.isValid())
-                continue;
-            indexes.push_back(qmIndex);
+        // a request following a content change gives us the client round-trip time,
+        // unless the client was busy with something else in the meantime
+        if (m_roundTripClock.isValid()) {
+            const qint64 sample = m_roundTripClock.elapsed();
+            if (sample <= 2 * MaxFlushInterval)
+                m_roundTripTime = static_cast<int>((3 * m_roundTripTime + sample) / 4);
+            m_roundTripClock.invalidate();
         }
-        if (indexes.isEmpty())
-            break;
-
-        Message msg(m_myAddress, Protocol::ModelContentReply);
-        msg << quint32(indexes.size());
-        foreach (const auto &qmIndex, indexes)
-            msg << Protocol::fromQModelIndex(qmIndex)
-                          << filterItemData(m_model->itemData(qmIndex))
-                          << qint32(m_model->flags(qmIndex));
 
-        sendMessage(msg);
+        if (addressing == Protocol::ModelIndexHandles)
+            sendContentReplyByHandle(msg, size, roles);
+        else
+            sendContentReply(msg, size, roles);
         break;
     }
 
@@ -259,6 +293,16 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
         break;
     }
 
+    case Protocol::ModelIndexHandleRelease:
+    {
+        QVector<Protocol::ModelIndexHandle> handles;
+        msg >> handles;
+        foreach (const auto handle, handles)
+            m_handles.remove(handle);
+        m_handleLookupDirty = true;
+        break;
+    }
+
     case Protocol::ModelSyncBarrier:
     {
         qint32 barrierId;
@@ -271,58 +315,308 @@ void RemoteModelServer::newRequest(const GammaRay::Message &msg)
     }
 }
 
-QMap<int, QVariant> RemoteModelServer::filterItemData(const QMap< int, QVariant > &data) const
+void RemoteModelServer::sendContentReply(const Message &msg, quint32 size,
+                                         const QVector<qint32> &roles)
+{
+    QVector<QModelIndex> indexes;
+    indexes.reserve(size);
+    for (quint32 i = 0; i < size; ++i) {
+        Protocol::ModelIndex index;
+        msg >> index;
+        const QModelIndex qmIndex = Protocol::toQModelIndex(m_model, index);
+        if (!qmIndex.isValid())
+            continue;
+        indexes.push_back(qmIndex);
+    }
+    if (indexes.isEmpty())
+        return;
+
+    limitIconRegistry();
+    Message reply(m_myAddress, Protocol::ModelContentReply);
+    reply << quint8(Protocol::ModelIndexPaths) << roles << quint32(indexes.size());
+    foreach (const auto &qmIndex, indexes) {
+        reply << Protocol::fromQModelIndex(qmIndex);
+        writeItemData(reply, qmIndex, roles);
+        reply << qint32(m_model->flags(qmIndex));
+    }
+
+    // the client needs to know the icons referenced by the reply first
+    sendPendingIcons();
+    sendMessage(reply);
+}
+
+void RemoteModelServer::sendContentReplyByHandle(const Message &msg, quint32 size,
+                                                 const QVector<qint32> &roles)
+{
+    // handles assigned for parents the client addressed by path
+    QHash<Protocol::ModelIndexHandle, Protocol::ModelIndex> newHandles;
+    QVector<QPair<Protocol::ModelIndexHandle, QModelIndex> > indexes;
+    indexes.reserve(size);
+
+    for (quint32 i = 0; i < size; ++i) {
+        Protocol::ModelIndexHandle handle;
+        msg >> handle;
+        QModelIndex parent;
+        bool parentValid = false;
+        if (handle == Protocol::InvalidModelIndexHandle) {
+            Protocol::ModelIndex parentPath;
+            msg >> parentPath;
+            parent = Protocol::toQModelIndex(m_model, parentPath);
+            parentValid = parentPath.isEmpty() || parent.isValid();
+            if (parentValid) {
+                handle = handleForParent(parent);
+                if (handle != Protocol::RootModelIndexHandle)
+                    newHandles.insert(handle, parentPath);
+            }
+        } else {
+            parent = parentForHandle(handle, &parentValid);
+        }
+
+        qint32 row, column;
+        msg >> row >> column;
+        if (!parentValid)
+            continue;
+        const QModelIndex qmIndex = m_model->index(row, column, parent);
+        if (!qmIndex.isValid())
+            continue;
+        indexes.push_back(qMakePair(handle, qmIndex));
+    }
+    if (indexes.isEmpty())
+        return;
+
+    limitIconRegistry();
+    Message reply(m_myAddress, Protocol::ModelContentReply);
+    reply << quint8(Protocol::ModelIndexHandles) << quint32(newHandles.size());
+    for (auto it = newHandles.constBegin(); it != newHandles.constEnd(); ++it)
+        reply << it.key() << it.value();
+    reply << roles << quint32(indexes.size());
+    foreach (const auto &index, indexes) {
+        reply << index.first << qint32(index.second.row()) << qint32(index.second.column());
+        writeItemData(reply, index.second, roles);
+        reply << qint32(m_model->flags(index.second));
+    }
+
+    // the client needs to know the icons referenced by the reply first
+    sendPendingIcons();
+    sendMessage(reply);
+}
+
+Protocol::ModelIndexHandle RemoteModelServer::handleForParent(const QModelIndex &parent)
+{
+    if (!parent.isValid())
+        return Protocol::RootModelIndexHandle;
+
+    if (m_handleLookupDirty) {
+        m_handleLookup.clear();
+        for (auto it = m_handles.constBegin(); it != m_handles.constEnd(); ++it) {
+            if (it.value().isValid())
+                m_handleLookup.insert(it.value(), it.key());
+        }
+        m_handleLookupDirty = false;
+    }
+
+    const auto it = m_handleLookup.constFind(parent);
+    if (it != m_handleLookup.constEnd())
+        return it.value();
+
+    const auto handle = m_nextHandle++;
+    m_handles.insert(handle, QPersistentModelIndex(parent));
+    m_handleLookup.insert(parent, handle);
+    return handle;
+}
+
+QModelIndex RemoteModelServer::parentForHandle(Protocol::ModelIndexHandle handle, bool *ok) const
+{
+    if (handle == Protocol::RootModelIndexHandle) {
+        *ok = true;
+        return QModelIndex();
+    }
+    const QModelIndex parent = m_handles.value(handle);
+    *ok = parent.isValid();
+    return parent;
+}
+
+void RemoteModelServer::pruneHandles()
+{
+    m_handleLookupDirty = true;
+    for (auto it = m_handles.begin(); it != m_handles.end();) {
+        if (it.value().isValid())
+            ++it;
+        else
+            it = m_handles.erase(it);
+    }
+}
+
+void RemoteModelServer::clearHandles()
 {
-    QMap<int, QVariant> itemData(data);
-    for (QMap<int, QVariant>::iterator it = itemData.begin(); it != itemData.end();) {
-        if (!it.value().isValid()) {
-            it = itemData.erase(it);
-        } else if (it.value().userType() == qMetaTypeId<QIcon>()) {
+    m_handles.clear();
+    m_handleLookup.clear();
+    m_handleLookupDirty = false;
+}
+
+void RemoteModelServer::writeItemData(Message &msg, const QModelIndex &index,
+                                      const QVector<qint32> &roles) const
+{
+    QMap<int, QVariant> data;
+    if (roles.isEmpty()) {
+        data = m_model->itemData(index);
+    } else {
+        // only compute what the client asked for, e.g. on demand roles such as tooltips
+        foreach (qint32 role, roles)
+            data.insert(role, m_model->data(index, role));
+    }
+    QVarLengthArray<QPair<qint32, QVariant>, 16> itemData;
+    QVarLengthArray<QPair<qint32, quint32>, 4> icons;
+    for (QMap<int, QVariant>::const_iterator it = data.constBegin(); it != data.constEnd(); ++it) {
+        if (!it.value().isValid())
+            continue;
+        if (it.value().userType() == qMetaTypeId<QIcon>()) {
             // see also: https://bugreports.qt-project.org/browse/QTBUG-33321
             const QIcon icon = it.value().value<QIcon>();
-            ///TODO: what size to use? icon.availableSizes is empty...
-            if (!icon.isNull())
-                it.value() = icon.pixmap(QSize(16, 16));
-            ++it;
+            if (!icon.isNull() && icons.size() < std::numeric_limits<quint8>::max())
+                icons.append(qMakePair<qint32, quint32>(it.key(), iconId(icon)));
         } else if (canSerialize(it.value())) {
-            ++it;
-        } else {
-// qWarning() << "Cannot serialize QVariant of type" << it.value().typeName();
-            it = itemData.erase(it);
+            itemData.append(qMakePair<qint32, QVariant>(it.key(), it.value()));
         }
     }
-    return itemData;
+
+    // same format as QMap<int, QVariant>, serialized in a single pass
+    msg << quint32(itemData.size());
+    for (int i = 0; i < itemData.size(); ++i)
+        msg << itemData.at(i);
+
+    // icons by reference, see sendPendingIcons()
+    msg << quint8(icons.size());
+    for (int i = 0; i < icons.size(); ++i)
+        msg << icons.at(i).first << icons.at(i).second;
+}
+
+quint32 RemoteModelServer::iconId(const QIcon &icon) const
+{
+    ///TODO: what size to use? icon.availableSizes is empty...
+    const QSize iconSize(16, 16);
+    QPixmap pixmap;
+    quint32 id = m_iconIds.value(icon.cacheKey());
+    if (!id) {
+        pixmap = icon.pixmap(iconSize);
+
+        // icons created on the fly get a new cache key every time, recognize those by content
+        const QImage image = pixmap.toImage();
+        QCryptographicHash hash(QCryptographicHash::Md5);
+        const qint32 header[] = { image.width(), image.height(), image.format() };
+        hash.addData(reinterpret_cast<const char *>(header), sizeof(header));
+        hash.addData(reinterpret_cast<const char *>(image.constBits()), image.byteCount());
+        const QByteArray contentKey = hash.result();
+
+        id = m_iconContentIds.value(contentKey);
+        if (!id) {
+            id = m_nextIconId++;
+            m_iconContentIds.insert(contentKey, id);
+        }
+
+        if (m_iconIds.size() >= MaxIconCacheKeys)
+            m_iconIds.clear();
+        m_iconIds.insert(icon.cacheKey(), id);
+    }
+
+    if (!m_sentIcons.contains(id)) {
+        m_sentIcons.insert(id);
+        m_pendingIcons.push_back(qMakePair(id, pixmap.isNull() ? icon.pixmap(iconSize) : pixmap));
+    }
+    return id;
+}
+
+void RemoteModelServer::limitIconRegistry() const
+{
+    if (m_iconContentIds.size() < MaxIcons)
+        return;
+
+    m_iconIds.clear();
+    m_iconContentIds.clear();
+    if (m_sentIcons.isEmpty())
+        return;
+    m_sentIcons.clear();
+
+    Message msg(m_myAddress, Protocol::ModelIconData);
+    msg << true << quint32(0);
+    sendMessage(msg);
+}
+
+void RemoteModelServer::sendPendingIcons() const
+{
+    if (m_pendingIcons.isEmpty())
+        return;
+
+    Message msg(m_myAddress, Protocol::ModelIconData);
+    msg << false << quint32(m_pendingIcons.size());
+    for (int i = 0; i < m_pendingIcons.size(); ++i)
+        msg << m_pendingIcons.at(i).first << m_pendingIcons.at(i).second;
+    m_pendingIcons.clear();
+    sendMessage(msg);
 }
 
 bool RemoteModelServer::canSerialize(const QVariant &value) const
 {
-    if (qstrcmp(value.typeName(), "QJSValue") == 0) {
-        // QJSValue tries to serialize nested elements and asserts if that fails
-        // too bad it can contain QObject* as nested element, which obviously can't be serialized...
-        return false;
-    }
+    const int type = value.userType();
 
-    // recurse into containers
-#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
-    if (value.canConvert<QVariantList>()) {
-        QSequentialIterable it = value.value<QSequentialIterable>();
-        foreach (const QVariant &v, it) {
+    // the content of variant containers can differ from value to value
+    switch (type) {
+    case QMetaType::QVariantList:
+    {
+        const QVariantList list = value.toList();
+        foreach (const QVariant &v, list) {
             if (!canSerialize(v))
                 return false;
         }
-    } else if (value.canConvert<QVariantMap>()) {
-        auto iterable = value.value<QAssociativeIterable>();
-        for (auto it = iterable.begin(); it != iterable.end(); ++it) {
+        return true;
+    }
+    case QMetaType::QVariantMap:
+    {
+        const QVariantMap map = value.toMap();
+        for (QVariantMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it) {
+            if (!canSerialize(it.value()))
+                return false;
+        }
+        return true;
+    }
+    case QMetaType::QVariantHash:
+    {
+        const QVariantHash hash = value.toHash();
+        for (QVariantHash::const_iterator it = hash.constBegin(); it != hash.constEnd(); ++it) {
             if (!canSerialize(it.value()))
                 return false;
         }
+        return true;
+    }
+    default:
+        break;
     }
-#endif
 
-    // ugly, but there doesn't seem to be a better way atm to find out without trying
-    m_dummyBuffer->seek(0);
-    QDataStream stream(m_dummyBuffer);
-    return QMetaType::save(stream, value.userType(), value.constData());
+    // everything else, including typed containers, can only be serialized if stream operators
+    // have been registered for its type, which is independent of the actual value
+    const QHash<int, bool>::const_iterator it = m_serializableTypes.constFind(type);
+    if (it != m_serializableTypes.constEnd())
+        return it.value();
+
+    bool serializable = false;
+    if (qstrcmp(value.typeName(), "QJSValue") == 0) {
+        // QJSValue tries to serialize nested elements and asserts if that fails
+        // too bad it can contain QObject* as nested element, which obviously can't be serialized...
+        serializable = false;
+    } else {
+        // ugly, but there doesn't seem to be a better way atm to find out without trying
+        // QMetaType::save() only fails if there are no stream operators, but it is given a default
+        // constructed value rather than this one, so the result doesn't depend on the first value seen
+        void *defaultValue = QMetaType::create(type);
+        if (defaultValue) {
+            m_dummyBuffer->seek(0);
+            QDataStream stream(m_dummyBuffer);
+            serializable = QMetaType::save(stream, type, defaultValue);
+            QMetaType::destroy(type, defaultValue);
+        }
+    }
+    m_serializableTypes.insert(type, serializable);
+    return serializable;
 }
 
 void RemoteModelServer::modelMonitored(bool monitored)
@@ -330,6 +624,16 @@ void RemoteModelServer::modelMonitored(bool monitored)
     if (m_monitored == monitored)
         return;
     m_monitored = monitored;
+    // we miss structural changes while not monitored
+    m_handleLookupDirty = true;
+    if (!m_monitored) {
+        clearPendingChanges();
+        // handles are only meaningful to the client that requested them
+        clearHandles();
+        // the next client starts with an empty icon cache
+        m_sentIcons.clear();
+        m_pendingIcons.clear();
+    }
     if (m_model) {
         if (m_monitored)
             connectModel();
@@ -343,15 +647,14 @@ void RemoteModelServer::dataChanged(const QModelIndex &begin, const QModelIndex
 {
     if (!isConnected())
         return;
-    Message msg(m_myAddress, Protocol::ModelContentChanged);
-    msg << Protocol::fromQModelIndex(begin) << Protocol::fromQModelIndex(end) << roles;
-    sendMessage(msg);
+    queueDataChange(begin, end, roles);
 }
 
 void RemoteModelServer::headerDataChanged(Qt::Orientation orientation, int first, int last)
 {
     if (!isConnected())
         return;
+    flushPendingChanges();
     Message msg(m_myAddress, Protocol::ModelHeaderChanged);
     msg <<  qint8(orientation) << first << last;
     sendMessage(msg);
@@ -359,6 +662,7 @@ void RemoteModelServer::headerDataChanged(Qt::Orientation orientation, int first
 
 void RemoteModelServer::rowsInserted(const QModelIndex &parent, int start, int end)
 {
+    m_handleLookupDirty = true;
     sendAddRemoveMessage(Protocol::ModelRowsAdded, parent, start, end);
 }
 
@@ -378,6 +682,7 @@ void RemoteModelServer::rowsMoved(const QModelIndex &sourceParent, int sourceSta
 {
     Q_UNUSED(sourceParent);
     Q_UNUSED(destinationParent);
+    m_handleLookupDirty = true;
     Q_ASSERT(m_preOpIndexes.size() >= 2);
     const auto destParentIdx = m_preOpIndexes.takeLast();
     const auto sourceParentIdx = m_preOpIndexes.takeLast();
@@ -387,11 +692,13 @@ void RemoteModelServer::rowsMoved(const QModelIndex &sourceParent, int sourceSta
 
 void RemoteModelServer::rowsRemoved(const QModelIndex &parent, int start, int end)
 {
+    pruneHandles();
     sendAddRemoveMessage(Protocol::ModelRowsRemoved, parent, start, end);
 }
 
 void RemoteModelServer::columnsInserted(const QModelIndex &parent, int start, int end)
 {
+    m_handleLookupDirty = true;
     sendAddRemoveMessage(Protocol::ModelColumnsAdded, parent, start, end);
 }
 
@@ -399,6 +706,7 @@ void RemoteModelServer::columnsMoved(const QModelIndex &sourceParent, int source
                                      int sourceEnd, const QModelIndex &destinationParent,
                                      int destinationColumn)
 {
+    m_handleLookupDirty = true;
     sendMoveMessage(Protocol::ModelColumnsMoved,
                     Protocol::fromQModelIndex(sourceParent), sourceStart, sourceEnd,
                     Protocol::fromQModelIndex(destinationParent), destinationColumn);
@@ -406,12 +714,14 @@ void RemoteModelServer::columnsMoved(const QModelIndex &sourceParent, int source
 
 void RemoteModelServer::columnsRemoved(const QModelIndex &parent, int start, int end)
 {
+    pruneHandles();
     sendAddRemoveMessage(Protocol::ModelColumnsRemoved, parent, start, end);
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 void RemoteModelServer::layoutChanged()
 {
+    m_handleLookupDirty = true;
     sendLayoutChanged();
 }
 
@@ -420,6 +730,7 @@ void RemoteModelServer::layoutChanged()
 void RemoteModelServer::layoutChanged(const QList<QPersistentModelIndex> &parents,
                                       QAbstractItemModel::LayoutChangeHint hint)
 {
+    m_handleLookupDirty = true;
     QVector<Protocol::ModelIndex> indexes;
     indexes.reserve(parents.size());
     foreach (const auto &index, parents)
@@ -434,6 +745,7 @@ void RemoteModelServer::sendLayoutChanged(const QVector< Protocol::ModelIndex >
 {
     if (!isConnected())
         return;
+    flushPendingChanges();
     Message msg(m_myAddress, Protocol::ModelLayoutChanged);
     msg << parents << hint;
     sendMessage(msg);
@@ -441,16 +753,113 @@ void RemoteModelServer::sendLayoutChanged(const QVector< Protocol::ModelIndex >
 
 void RemoteModelServer::modelReset()
 {
+    // anything pending is obsoleted by the reset
+    clearPendingChanges();
+    clearHandles();
     if (!isConnected())
         return;
     sendMessage(Message(m_myAddress, Protocol::ModelReset));
 }
 
+void RemoteModelServer::queueDataChange(const QModelIndex &begin, const QModelIndex &end,
+                                        const QVector<int> &roles)
+{
+    if (!begin.isValid() || !end.isValid())
+        return;
+
+    PendingDataChange change;
+    change.parent = Protocol::fromQModelIndex(begin.parent());
+    change.top = begin.row();
+    change.left = begin.column();
+    change.bottom = end.row();
+    change.right = end.column();
+    change.roles = roles;
+
+    // merge with an overlapping or adjacent range of the same parent
+    for (auto it = m_pendingDataChanges.begin(); it != m_pendingDataChanges.end(); ++it) {
+        if (it->parent != change.parent
+            || change.top > it->bottom + 1 || change.bottom + 1 < it->top
+            || change.left > it->right + 1 || change.right + 1 < it->left)
+            continue;
+
+        it->top = qMin(it->top, change.top);
+        it->left = qMin(it->left, change.left);
+        it->bottom = qMax(it->bottom, change.bottom);
+        it->right = qMax(it->right, change.right);
+        if (it->roles.isEmpty() || change.roles.isEmpty()) {
+            it->roles.clear(); // all roles
+        } else {
+            foreach (int role, change.roles) {
+                if (!it->roles.contains(role))
+                    it->roles.push_back(role);
+            }
+        }
+        scheduleFlush();
+        return;
+    }
+
+    m_pendingDataChanges.push_back(change);
+    if (m_pendingDataChanges.size() >= MaxPendingDataChanges)
+        flushPendingChanges();
+    else
+        scheduleFlush();
+}
+
+int RemoteModelServer::effectiveFlushInterval() const
+{
+    // no point in sending changes faster than the client can re-request the content anyway
+    return qBound(m_flushInterval, m_roundTripTime / 2, MaxFlushInterval);
+}
+
+void RemoteModelServer::scheduleFlush()
+{
+    if (m_flushInterval <= 0) {
+        flushPendingChanges();
+        return;
+    }
+    if (!m_flushTimer->isActive())
+        m_flushTimer->start(effectiveFlushInterval());
+}
+
+void RemoteModelServer::clearPendingChanges()
+{
+    m_flushTimer->stop();
+    m_pendingDataChanges.clear();
+}
+
+void RemoteModelServer::flushPendingChanges()
+{
+    m_flushTimer->stop();
+    if (!isConnected()) {
+        clearPendingChanges();
+        return;
+    }
+
+    if (m_pendingDataChanges.isEmpty())
+        return;
+
+    Message msg(m_myAddress, Protocol::ModelContentChanged);
+    msg << quint32(m_pendingDataChanges.size());
+    foreach (const auto &change, m_pendingDataChanges) {
+        auto begin = change.parent;
+        begin.push_back(qMakePair(change.top, change.left));
+        auto end = change.parent;
+        end.push_back(qMakePair(change.bottom, change.right));
+        msg << begin << end << change.roles;
+    }
+    m_pendingDataChanges.clear();
+    sendMessage(msg);
+
+    if (!m_roundTripClock.isValid())
+        m_roundTripClock.start();
+}
+
 void RemoteModelServer::sendAddRemoveMessage(Protocol::MessageType type, const QModelIndex &parent,
                                              int start, int end)
 {
     if (!isConnected())
         return;
+    flushPendingChanges();
     Message msg(m_myAddress, type);
     msg << Protocol::fromQModelIndex(parent) << start << end;
     sendMessage(msg);
@@ -464,6 +873,7 @@ void RemoteModelServer::sendMoveMessage(Protocol::MessageType type,
 {
     if (!isConnected())
         return;
+    flushPendingChanges();
     Message msg(m_myAddress, type);
     msg << sourceParent << qint32(sourceStart) << qint32(sourceEnd)
                   << destinationParent << qint32(destinationIndex);
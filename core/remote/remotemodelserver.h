@@ -31,12 +31,20 @@
 
 #include <common/protocol.h>
 
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPixmap>
 #include <QObject>
+#include <QPersistentModelIndex>
 #include <QPointer>
 #include <QRegExp>
+#include <QSet>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
+class QIcon;
 class QBuffer;
+class QTimer;
 class QAbstractItemModel;
 QT_END_NAMESPACE
 
@@ -66,6 +74,16 @@ public:
     /** Set the source model for this model server instance. */
     void setModel(QAbstractItemModel *model);
 
+    /** Returns the minimum time in milliseconds change notifications are accumulated before
+     *  being sent to the client.
+     */
+    int flushInterval() const;
+    /** Set the minimum time window in which content change notifications are accumulated
+     *  and merged. The effective window grows with the measured client round-trip time.
+     *  A value of 0 sends every change immediately. Structural changes are never delayed.
+     */
+    void setFlushInterval(int msecs);
+
 public slots:
     void newRequest(const GammaRay::Message &msg);
     /** Notifications about an object on the client side (un)monitoring this object.
@@ -76,15 +94,37 @@ public slots:
 private:
     void connectModel();
     void disconnectModel();
+    void queueDataChange(const QModelIndex &begin, const QModelIndex &end,
+                         const QVector<int> &roles);
+    void scheduleFlush();
+    void clearPendingChanges();
+    int effectiveFlushInterval() const;
+    void sendContentReply(const Message &msg, quint32 size, const QVector<qint32> &roles);
+    void sendContentReplyByHandle(const Message &msg, quint32 size, const QVector<qint32> &roles);
+    Protocol::ModelIndexHandle handleForParent(const QModelIndex &parent);
+    QModelIndex parentForHandle(Protocol::ModelIndexHandle handle, bool *ok) const;
+    /// drops handles of removed parents
+    void pruneHandles();
+    void clearHandles();
     void sendAddRemoveMessage(Protocol::MessageType type, const QModelIndex &parent, int start,
                               int end);
     void sendMoveMessage(Protocol::MessageType type, const Protocol::ModelIndex &sourceParent,
                          int sourceStart, int sourceEnd,
                          const Protocol::ModelIndex &destinationParent, int destinationIndex);
-    QMap< int, QVariant > filterItemData(const QMap< int, QVariant > &data) const;
+    /// writes the item data of @p index in the format of QMap<int, QVariant>, skipping what can't be serialized
+    /// @p roles selects the roles to write, all roles provided by itemData() if empty
+    void writeItemData(Message &msg, const QModelIndex &index, const QVector<qint32> &roles) const;
+    /// id of @p icon in the icon registry, the icon is queued for sending if the client doesn't have it yet
+    quint32 iconId(const QIcon &icon) const;
+    /// starts over with an empty icon registry once it is full, and tells the client to do the same
+    /// has to happen before writing a reply, so the reply doesn't reference icons from before
+    void limitIconRegistry() const;
+    /// sends queued icons, has to happen before sending the reply referencing them
+    void sendPendingIcons() const;
     void sendLayoutChanged(
         const QVector<Protocol::ModelIndex> &parents = QVector<Protocol::ModelIndex>(),
         quint32 hint = 0);
+    /// decided per type and cached, except for variant containers which are checked element-wise
     bool canSerialize(const QVariant &value) const;
 
     // proxy model settings
@@ -129,18 +169,55 @@ private slots:
 
     void modelDeleted();
 
+    void flushPendingChanges();
+
 private:
+    struct PendingDataChange {
+        Protocol::ModelIndex parent;
+        int top;
+        int left;
+        int bottom;
+        int right;
+        QVector<int> roles;
+    };
+
     QPointer<QAbstractItemModel> m_model;
     // those two are used for canSerialize, since recreating the QBuffer is somewhat expensive,
     // especially since being a QObject triggers all kind of GammaRay internals
     QByteArray m_dummyData;
     QBuffer *m_dummyBuffer;
+    // serializability by metatype id, see canSerialize
+    mutable QHash<int, bool> m_serializableTypes;
+
+    // icon registry, icons are transferred once and then referenced by id
+    // pixmaps are only kept until they are sent, ids are never reused
+    mutable QHash<qint64, quint32> m_iconIds; // QIcon::cacheKey -> id
+    mutable QHash<QByteArray, quint32> m_iconContentIds; // content hash -> id
+    mutable QSet<quint32> m_sentIcons;
+    mutable QVector<QPair<quint32, QPixmap> > m_pendingIcons;
+    mutable quint32 m_nextIconId;
     // converted model indexes from aboutToBeX signals, needed in cases where the operation changes
     // the serialized index (move to sub-tree of source parent for example)
     // as operations can occur nested, we need to have a stack for this
     QList<Protocol::ModelIndex> m_preOpIndexes;
     Protocol::ObjectAddress m_myAddress;
     bool m_monitored;
+
+    // outbound content change accumulator, structural changes are sent right away since other
+    // objects (selection models for example) refer to our rows by index and don't wait for us
+    QVector<PendingDataChange> m_pendingDataChanges;
+    QTimer *m_flushTimer;
+    int m_flushInterval;
+    // started when sending content changes, stopped by the client re-requesting content
+    QElapsedTimer m_roundTripClock;
+    int m_roundTripTime;
+
+    // parent index handles, see Protocol::ModelIndexHandle
+    QHash<Protocol::ModelIndexHandle, QPersistentModelIndex> m_handles;
+    // reverse lookup, rebuilt on demand since structural changes invalidate the QModelIndex keys
+    QHash<QModelIndex, Protocol::ModelIndexHandle> m_handleLookup;
+    Protocol::ModelIndexHandle m_nextHandle;
+    bool m_handleLookupDirty;
 };
 }
 
@@ -36,6 +36,7 @@
 #include <common/protocol.h>
 #include <common/message.h>
 #include <common/propertysyncer.h>
+#include <common/transferimage.h>
 
 #ifdef Q_OS_ANDROID
 # include <QDir>
@@ -123,13 +124,17 @@ void Server::newConnection()
     if (isConnected()) {
         cerr << Q_FUNC_INFO << " connected already, refusing incoming connection." << endl;
         auto con = m_serverDevice->nextPendingConnection();
-        con->close();
-        con->deleteLater();
+        if (con) {
+            con->close();
+            con->deleteLater();
+        }
         return;
     }
 
-    m_broadcastTimer->stop();
     auto con = m_serverDevice->nextPendingConnection();
+    if (!con)
+        return; // keep waiting for the next client
+    m_broadcastTimer->stop();
     connect(con, SIGNAL(disconnected()), con, SLOT(deleteLater()));
     setDevice(con);
 
@@ -148,6 +153,7 @@ void Server::sendServerGreeting()
     {
         Message msg(endpointAddress(), Protocol::ServerInfo);
         msg << label(); // TODO: expand with anything else needed here: Qt/GammaRay version, hostname, that kind of stuff
+        msg << quint8(Protocol::LZ4StreamCompression) << TransferImage::supportedEncoders();
         send(msg);
     }
 
@@ -180,6 +186,14 @@ void Server::messageReceived(const Message &msg)
                                       Q_ARG(bool, msg.type() == Protocol::ObjectMonitored));
             break;
         }
+        case Protocol::CompressionSelect:
+        {
+            quint8 compression, imageEncodings;
+            msg >> compression >> imageEncodings;
+            setCompression(static_cast<Protocol::Compression>(compression));
+            setImageEncodings(imageEncodings & TransferImage::supportedEncoders());
+            break;
+        }
         }
     } else {
         dispatchMessage(msg);
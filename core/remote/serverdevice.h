@@ -49,6 +49,7 @@ public:
 
     virtual bool listen() = 0;
     virtual QString errorString() const = 0;
+    /** Returns the next incoming connection, or @c 0 if setting it up failed. */
     virtual QIODevice *nextPendingConnection() = 0;
 
     /** An externally useable address of this server.
@@ -30,17 +30,187 @@
 
 #include <core/remote/server.h>
 
+#include <common/protocol.h>
+#include <common/remoteviewframe.h>
+
 #include <QCoreApplication>
 #include <QDebug>
 #include <QMouseEvent>
+#include <QMutex>
+#include <QThread>
 #include <QTimer>
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
 #include <QWindow>
 #endif
 
+#include <algorithm>
+
 using namespace GammaRay;
 
+// reduces frame to the part visible on the client, at the resolution the client displays it
+static RemoteViewFrame cropToViewport(const RemoteViewFrame &frame, const QRectF &viewport, double zoom)
+{
+    const QImage image = frame.image();
+    const QRectF viewRect = frame.viewRect();
+    if (!viewport.isValid() || image.isNull() || viewRect.isEmpty())
+        return frame;
+
+    // device pixels per view unit of the source image
+    const double sourceScale = image.width() / viewRect.width();
+    const QRectF visibleRect = viewport & QRectF(QPointF(), viewRect.size());
+    // a pixel of margin around the visible area avoids seams from smooth scaling on the client
+    const QRect pixelRect = QRectF(visibleRect.topLeft() * sourceScale,
+                                   visibleRect.size() * sourceScale).toAlignedRect()
+                            .adjusted(-1, -1, 1, 1) & image.rect();
+    const double scale = std::min(1.0, zoom / sourceScale);
+    if (pixelRect.isEmpty() || (pixelRect == image.rect() && scale >= 1.0))
+        return frame;
+
+    QImage croppedImage = image.copy(pixelRect);
+    if (scale < 1.0) {
+        const QSize targetSize(std::max(1, qRound(pixelRect.width() * scale)),
+                               std::max(1, qRound(pixelRect.height() * scale)));
+        croppedImage = croppedImage.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    croppedImage.setDevicePixelRatio(image.devicePixelRatio() * croppedImage.width() / pixelRect.width());
+#endif
+
+    RemoteViewFrame croppedFrame(frame);
+    // those default to values derived from the image, so fix them before replacing it
+    croppedFrame.setViewRect(viewRect);
+    croppedFrame.setSceneRect(frame.sceneRect());
+    croppedFrame.setImage(croppedImage);
+    croppedFrame.setImageRect(QRectF(viewRect.topLeft() + QPointF(pixelRect.topLeft()) / sourceScale,
+                                     QSizeF(pixelRect.size()) / sourceScale));
+    return croppedFrame;
+}
+
+namespace GammaRay {
+// a full frame should make it to the client within this time, in msecs
+static const int TargetFrameLatency = 100;
+// smaller frames are dominated by latency rather than link throughput
+static const int MinThroughputSampleSize = 64 * 1024;
+static const int MinJpegQuality = 25;
+static const int MaxJpegQuality = 90;
+static const int DefaultJpegQuality = 75;
+
+/** Prepares frames for remote clients on a worker thread: cropping, delta computation
+ *  and encoding, so that none of that blocks the GUI thread of the target application.
+ */
+class RemoteViewEncoder : public QObject
+{
+    Q_OBJECT
+public:
+    struct Job {
+        Job()
+            : zoom(1.0)
+            , encodings(0)
+            , jpegQuality(DefaultJpegQuality)
+            , maxLosslessSize(-1)
+            , generation(0)
+            , size(0)
+            , lossy(false)
+        {
+        }
+
+        RemoteViewFrame frame;
+        QImage deltaBase;
+        QRectF viewport;
+        double zoom;
+        quint8 encodings; // Protocol::ImageEncoding flags
+        int jpegQuality;
+        int maxLosslessSize; // full frames above this are encoded lossy, -1 for no limit
+        int generation;
+
+        // results
+        int size;
+        bool lossy;
+    };
+
+    explicit RemoteViewEncoder(QObject *receiver)
+        : m_receiver(receiver)
+        , m_hasJob(false)
+        , m_hasResult(false)
+    {
+    }
+
+    /// thread-safe, frameEncoded() is invoked on the receiver once done
+    void post(const Job &job)
+    {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_job = job;
+            m_hasJob = true;
+        }
+        QMetaObject::invokeMethod(this, "processJob", Qt::QueuedConnection);
+    }
+
+    /// thread-safe
+    bool takeResult(Job *result)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_hasResult)
+            return false;
+        *result = m_result;
+        m_result = Job();
+        m_hasResult = false;
+        return true;
+    }
+
+private slots:
+    void processJob()
+    {
+        Job job;
+        {
+            QMutexLocker lock(&m_mutex);
+            if (!m_hasJob)
+                return;
+            job = m_job;
+            m_job = Job();
+            m_hasJob = false;
+        }
+
+        process(job);
+
+        {
+            QMutexLocker lock(&m_mutex);
+            m_result = job;
+            m_hasResult = true;
+        }
+        QMetaObject::invokeMethod(m_receiver, "frameEncoded", Qt::QueuedConnection);
+    }
+
+private:
+    static void process(Job &job)
+    {
+        job.frame = cropToViewport(job.frame, job.viewport, job.zoom);
+        job.frame.setDeltaBase(job.deltaBase);
+        job.deltaBase = QImage();
+        if (!(job.encodings & Protocol::LosslessImageEncoding))
+            return;
+
+        job.frame.encodeImage(TransferImage::LosslessEncoding);
+        job.size = job.frame.encodedImageSize();
+        if ((job.encodings & Protocol::LossyImageEncoding) && job.maxLosslessSize >= 0
+            && job.size > job.maxLosslessSize) {
+            job.lossy = job.frame.encodeImage(TransferImage::LossyEncoding, job.jpegQuality)
+                        == TransferImage::LossyEncoding;
+            job.size = job.frame.encodedImageSize();
+        }
+    }
+
+    QObject *m_receiver;
+    QMutex m_mutex;
+    Job m_job;
+    bool m_hasJob;
+    Job m_result;
+    bool m_hasResult;
+};
+}
+
+
 RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     : RemoteViewInterface(name, parent)
     , m_eventReceiver(Q_NULLPTR)
@@ -48,6 +218,17 @@ RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     , m_clientActive(false)
     , m_sourceChanged(false)
     , m_clientReady(true)
+    , m_clientZoom(1.0)
+    , m_encoderThread(new QThread(this))
+    , m_encoder(new RemoteViewEncoder(this))
+    , m_encodingFrame(false)
+    , m_generation(0)
+    , m_frameInFlight(false)
+    , m_frameLossy(false)
+    , m_losslessRefresh(false)
+    , m_frameSize(0)
+    , m_throughput(0.0)
+    , m_jpegQuality(DefaultJpegQuality)
 {
     Server::instance()->registerMonitorNotifier(Endpoint::instance()->objectAddress(
                                                     name), this, "clientConnectedChanged");
@@ -55,6 +236,15 @@ RemoteViewServer::RemoteViewServer(const QString &name, QObject *parent)
     m_updateTimer->setSingleShot(true);
     m_updateTimer->setInterval(100);
     connect(m_updateTimer, SIGNAL(timeout()), this, SLOT(requestUpdateTimeout()));
+
+    m_encoder->moveToThread(m_encoderThread);
+}
+
+RemoteViewServer::~RemoteViewServer()
+{
+    m_encoderThread->quit();
+    m_encoderThread->wait();
+    delete m_encoder;
 }
 
 void RemoteViewServer::setEventReceiver(EventReceiver *receiver)
@@ -74,6 +264,8 @@ void RemoteViewServer::pickElementId(const GammaRay::ObjectId &id)
 
 void RemoteViewServer::resetView()
 {
+    m_lastSentImage = QImage();
+    ++m_generation;
     if (isActive())
         emit reset();
 }
@@ -86,7 +278,91 @@ bool RemoteViewServer::isActive() const
 void RemoteViewServer::sendFrame(const RemoteViewFrame &frame)
 {
     m_clientReady = false;
-    emit frameUpdated(frame);
+
+    if (!Endpoint::isConnected()) {
+        // in-process the frame doesn't get serialized, so there's nothing to save
+        m_lastSentImage = QImage();
+        emit frameUpdated(frame);
+        return;
+    }
+
+    if (m_encodingFrame) {
+        // the delta of this one depends on the frame being encoded, so wait for that
+        m_queuedFrame = frame;
+        return;
+    }
+    encodeFrame(frame);
+}
+
+void RemoteViewServer::encodeFrame(const RemoteViewFrame &frame)
+{
+    RemoteViewEncoder::Job job;
+    job.frame = frame;
+    job.deltaBase = m_lastSentImage;
+    job.viewport = m_clientViewport;
+    job.zoom = m_clientZoom;
+    job.encodings = Endpoint::instance()->imageEncodings();
+    job.jpegQuality = m_jpegQuality;
+    if (m_throughput > 0.0 && !m_losslessRefresh)
+        job.maxLosslessSize = m_throughput * TargetFrameLatency / 1000;
+    job.generation = m_generation;
+
+    m_encodingFrame = true;
+    if (!m_encoderThread->isRunning())
+        m_encoderThread->start();
+    m_encoder->post(job);
+}
+
+void RemoteViewServer::frameEncoded()
+{
+    RemoteViewEncoder::Job job;
+    if (!m_encoder->takeResult(&job))
+        return;
+    m_encodingFrame = false;
+
+    if (m_queuedFrame.isValid()) {
+        // superseded by a newer frame, which can still use our last sent image as delta base
+        const RemoteViewFrame frame = m_queuedFrame;
+        m_queuedFrame = RemoteViewFrame();
+        encodeFrame(frame);
+        return;
+    }
+
+    if (job.generation != m_generation || !isActive()) {
+        // the client dropped its frame in the meantime, so the delta is useless
+        if (isActive()) {
+            m_clientReady = true;
+            sourceChanged();
+        }
+        return;
+    }
+
+    // the client shows the JPEG decoded image, deltas against the original would keep its artifacts
+    m_lastSentImage = job.lossy ? QImage() : job.frame.image();
+    m_frameSize = job.size;
+    m_frameLossy = job.lossy;
+    if (!job.lossy)
+        m_losslessRefresh = false;
+    m_frameInFlight = true;
+    m_frameTimer.start();
+    emit frameUpdated(job.frame);
+}
+
+void RemoteViewServer::updateEncodingPolicy(qint64 latency)
+{
+    latency = std::max<qint64>(latency, 1);
+    if (m_frameSize >= MinThroughputSampleSize) {
+        const double sample = m_frameSize * 1000000000.0 / latency;
+        m_throughput = m_throughput > 0.0 ? 0.75 * m_throughput + 0.25 * sample : sample;
+    }
+
+    if (!m_frameLossy)
+        return;
+    const qint64 target = TargetFrameLatency * qint64(1000000);
+    if (latency > target)
+        m_jpegQuality = std::max(MinJpegQuality, m_jpegQuality - 10);
+    else if (latency < target / 2)
+        m_jpegQuality = std::min(MaxJpegQuality, m_jpegQuality + 5);
 }
 
 void RemoteViewServer::sourceChanged()
@@ -97,10 +373,30 @@ void RemoteViewServer::sourceChanged()
 
 void RemoteViewServer::clientViewUpdated()
 {
+    if (m_frameInFlight) {
+        m_frameInFlight = false;
+        const qint64 latency = m_frameTimer.nsecsElapsed();
+        updateEncodingPolicy(latency);
+        // replace a lossy frame by a full lossless one once the link is idle or fast enough for it
+        if (m_frameLossy
+            && (!m_sourceChanged || latency <= TargetFrameLatency * qint64(1000000))) {
+            m_losslessRefresh = true;
+            m_sourceChanged = true;
+        }
+    }
     m_clientReady = true;
     checkRequestUpdate();
 }
 
+void RemoteViewServer::setClientViewport(const QRectF &viewport, double zoom)
+{
+    if (m_clientViewport == viewport && m_clientZoom == zoom)
+        return;
+    m_clientViewport = viewport;
+    m_clientZoom = zoom > 0.0 ? zoom : 1.0;
+    sourceChanged();
+}
+
 void RemoteViewServer::checkRequestUpdate()
 {
     if (isActive() && !m_updateTimer->isActive() && m_clientReady && m_sourceChanged)
@@ -155,6 +451,12 @@ void RemoteViewServer::setViewActive(bool active)
 {
     m_clientActive = active;
     m_clientReady = active;
+    // the client might have lost its previous frame, next one has to be complete
+    m_lastSentImage = QImage();
+    ++m_generation;
+    m_frameInFlight = false;
+    m_frameLossy = false;
+    m_losslessRefresh = false;
     if (active)
         sourceChanged();
     else
@@ -163,8 +465,13 @@ void RemoteViewServer::setViewActive(bool active)
 
 void RemoteViewServer::clientConnectedChanged(bool connected)
 {
-    if (!connected)
+    if (!connected) {
+        m_clientViewport = QRectF();
+        m_clientZoom = 1.0;
+        m_throughput = 0.0;
+        m_jpegQuality = DefaultJpegQuality;
         setViewActive(false);
+    }
 }
 
 void RemoteViewServer::requestUpdateTimeout()
@@ -172,3 +479,5 @@ void RemoteViewServer::requestUpdateTimeout()
     emit requestUpdate();
     m_sourceChanged = false;
 }
+
+#include "remoteviewserver.moc"
@@ -31,14 +31,21 @@
 
 #include "gammaray_core_export.h"
 
+#include <common/remoteviewframe.h>
 #include <common/remoteviewinterface.h>
 
+#include <QElapsedTimer>
+#include <QImage>
+
 QT_BEGIN_NAMESPACE
+class QThread;
 class QTimer;
 class QWindow;
 QT_END_NAMESPACE
 
 namespace GammaRay {
+class RemoteViewEncoder;
+
 /** Server part of the remote view widget. */
 class GAMMARAY_CORE_EXPORT RemoteViewServer : public RemoteViewInterface
 {
@@ -46,6 +53,7 @@ class GAMMARAY_CORE_EXPORT RemoteViewServer : public RemoteViewInterface
     Q_INTERFACES(GammaRay::RemoteViewInterface)
 public:
     explicit RemoteViewServer(const QString &name, QObject *parent = Q_NULLPTR);
+    ~RemoteViewServer();
 
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
     typedef QWindow EventReceiver;
@@ -61,7 +69,9 @@ public:
     /// returns @c true if there is a client displaying our content
     bool isActive() const;
 
-    /// sends a new frame to the client
+    /** Sends a new frame to the client, only transferring the parts changed since the last frame.
+     *  For remote clients the frame is prepared and encoded on a worker thread.
+     */
     void sendFrame(const RemoteViewFrame &frame);
 
 public slots:
@@ -85,12 +95,17 @@ private:
                         int modifiers) Q_DECL_OVERRIDE;
     void setViewActive(bool active) Q_DECL_OVERRIDE;
     void clientViewUpdated() Q_DECL_OVERRIDE;
+    void setClientViewport(const QRectF &viewport, double zoom) Q_DECL_OVERRIDE;
 
     void checkRequestUpdate();
+    void encodeFrame(const RemoteViewFrame &frame);
+    /// adapts the image encoding to the acknowledgement latency of the last frame
+    void updateEncodingPolicy(qint64 latency);
 
 private slots:
     void clientConnectedChanged(bool connected);
     void requestUpdateTimeout();
+    void frameEncoded();
 
 private:
     EventReceiver *m_eventReceiver;
@@ -98,6 +113,24 @@ private:
     bool m_clientActive;
     bool m_sourceChanged;
     bool m_clientReady;
+    QImage m_lastSentImage;
+    QRectF m_clientViewport;
+    double m_clientZoom;
+
+    QThread *m_encoderThread;
+    RemoteViewEncoder *m_encoder;
+    bool m_encodingFrame;
+    RemoteViewFrame m_queuedFrame; // sent while m_encodingFrame was set
+    int m_generation; // incremented whenever the client drops its frame
+
+    // encoding policy state, for the frame currently in flight and the connection
+    QElapsedTimer m_frameTimer;
+    bool m_frameInFlight;
+    bool m_frameLossy;
+    bool m_losslessRefresh; // next frame is encoded lossless, to replace a lossy one
+    int m_frameSize;
+    double m_throughput; // bytes/s, 0 if unknown
+    int m_jpegQuality;
 };
 }
 
@@ -0,0 +1,127 @@
+/*
+  stripedobjectset.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stripedobjectset.h"
+
+using namespace GammaRay;
+
+StripedObjectSet::Stripe::Stripe()
+    : mutex(QMutex::Recursive)
+{
+}
+
+StripedObjectSet::StripedObjectSet()
+{
+}
+
+StripedObjectSet::~StripedObjectSet()
+{
+}
+
+int StripedObjectSet::stripeIndex(QObject *obj)
+{
+    // the lower bits are always zero due to alignment, mix in some higher ones instead
+    const quintptr p = reinterpret_cast<quintptr>(obj);
+    return static_cast<int>((p >> 4) ^ (p >> 10)) & (StripeCount - 1);
+}
+
+bool StripedObjectSet::contains(QObject *obj) const
+{
+    const Stripe &stripe = m_stripes[stripeIndex(obj)];
+    QMutexLocker lock(&stripe.mutex);
+    return stripe.objects.contains(obj);
+}
+
+bool StripedObjectSet::insert(QObject *obj, const void *pendingCreation)
+{
+    Stripe &stripe = m_stripes[stripeIndex(obj)];
+    QMutexLocker lock(&stripe.mutex);
+    if (stripe.objects.contains(obj))
+        return false;
+    stripe.objects.insert(obj, pendingCreation);
+    return true;
+}
+
+bool StripedObjectSet::remove(QObject *obj, const void **pendingCreation)
+{
+    Stripe &stripe = m_stripes[stripeIndex(obj)];
+    QMutexLocker lock(&stripe.mutex);
+    const auto it = stripe.objects.find(obj);
+    if (it == stripe.objects.end())
+        return false;
+    if (pendingCreation)
+        *pendingCreation = it.value();
+    stripe.objects.erase(it);
+    return true;
+}
+
+bool StripedObjectSet::isCreationPending(QObject *obj) const
+{
+    const Stripe &stripe = m_stripes[stripeIndex(obj)];
+    QMutexLocker lock(&stripe.mutex);
+    return stripe.objects.value(obj);
+}
+
+bool StripedObjectSet::takePendingCreation(QObject *obj, const void *pendingCreation)
+{
+    Stripe &stripe = m_stripes[stripeIndex(obj)];
+    QMutexLocker lock(&stripe.mutex);
+    const auto it = stripe.objects.find(obj);
+    if (it == stripe.objects.end() || it.value() != pendingCreation)
+        return false;
+    it.value() = 0;
+    return true;
+}
+
+QMutex *StripedObjectSet::mutex(QObject *obj) const
+{
+    return &m_stripes[stripeIndex(obj)].mutex;
+}
+
+void StripedObjectSet::lockAll()
+{
+    // always in the same order, so this doesn't deadlock with itself
+    for (int i = 0; i < StripeCount; ++i)
+        m_stripes[i].mutex.lock();
+}
+
+void StripedObjectSet::unlockAll()
+{
+    for (int i = StripeCount - 1; i >= 0; --i)
+        m_stripes[i].mutex.unlock();
+}
+
+int StripedObjectSet::size() const
+{
+    int count = 0;
+    for (int i = 0; i < StripeCount; ++i) {
+        QMutexLocker lock(&m_stripes[i].mutex);
+        count += m_stripes[i].objects.size();
+    }
+    return count;
+}
@@ -0,0 +1,100 @@
+/*
+  stripedobjectset.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_STRIPEDOBJECTSET_H
+#define GAMMARAY_STRIPEDOBJECTSET_H
+
+#include <QHash>
+#include <QMutex>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/**
+ * A thread-safe set of QObject pointers, split into a number of independently locked stripes.
+ *
+ * This allows concurrent lookups and changes from many threads without contending on a single
+ * lock, as long as they hit different stripes.
+ *
+ * Each object can carry an opaque token identifying a pending creation notification, which
+ * allows to detect whether an object has been destroyed (and its address possibly reused)
+ * before that notification got delivered.
+ */
+class StripedObjectSet
+{
+public:
+    StripedObjectSet();
+    ~StripedObjectSet();
+
+    bool contains(QObject *obj) const;
+    /// Returns @c true if @p obj was not contained in the set before.
+    bool insert(QObject *obj, const void *pendingCreation = 0);
+    /** Returns @c true if @p obj was contained in the set.
+     *  @p pendingCreation is set to the token of its pending creation notification, if any.
+     */
+    bool remove(QObject *obj, const void **pendingCreation = 0);
+
+    bool isCreationPending(QObject *obj) const;
+    /** Marks the creation notification identified by @p pendingCreation as delivered.
+     *  Returns @c false if that is not pending for @p obj (anymore), ie. it is obsolete.
+     */
+    bool takePendingCreation(QObject *obj, const void *pendingCreation);
+
+    /** The (recursive) mutex protecting the stripe containing @p obj.
+     *  While holding it, @p obj is neither added nor removed.
+     */
+    QMutex *mutex(QObject *obj) const;
+    /// Locks all stripes, blocking any change to the set.
+    void lockAll();
+    void unlockAll();
+
+    int size() const;
+
+private:
+    Q_DISABLE_COPY(StripedObjectSet)
+
+    enum { StripeCount = 32 }; // must be a power of two
+
+    struct Stripe
+    {
+        Stripe();
+
+        mutable QMutex mutex;
+        // object -> pending creation token
+        QHash<QObject *, const void *> objects;
+    };
+
+    static int stripeIndex(QObject *obj);
+
+    Stripe m_stripes[StripeCount];
+};
+}
+
+#endif // GAMMARAY_STRIPEDOBJECTSET_H
@@ -77,7 +77,9 @@ void ToolManager::selectObject(const ObjectId &id, const QString &toolId)
         return;
     case ObjectId::QObjectType:
     {
-        QMutexLocker lock(Probe::objectLock());
+        // selecting notifies the tools, which look at other objects as well
+        QMutexLocker globalLock(Probe::objectLock());
+        QMutexLocker lock(Probe::objectLock(id.asQObject()));
         if (!Probe::instance()->isValidObject(id.asQObject()))
             return;
 
@@ -103,7 +105,7 @@ void ToolManager::requestToolsForObject(const ObjectId &id)
         return;
     case ObjectId::QObjectType:
     {
-        QMutexLocker lock(Probe::objectLock());
+        QMutexLocker lock(Probe::objectLock(id.asQObject()));
         if (!Probe::instance()->isValidObject(id.asQObject()))
             return;
 
@@ -0,0 +1,54 @@
+/*
+  backtrace.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "backtrace.h"
+
+#include <QHash>
+#include <QMutex>
+
+typedef QHash<quintptr, QString> SymbolCache;
+Q_GLOBAL_STATIC(SymbolCache, s_symbolCache)
+// also serializes symbolizeAddress(), the platform APIs used for that aren't necessarily thread-safe
+static QMutex s_symbolCacheMutex;
+
+QStringList symbolizeBacktrace(const Backtrace &backtrace)
+{
+    QStringList frames;
+    frames.reserve(backtrace.size());
+
+    QMutexLocker lock(&s_symbolCacheMutex);
+    SymbolCache *cache = s_symbolCache();
+    foreach (quintptr address, backtrace) {
+        SymbolCache::const_iterator it = cache->constFind(address);
+        if (it == cache->constEnd())
+            it = cache->insert(address, symbolizeAddress(address));
+        frames.push_back(it.value());
+    }
+    return frames;
+}
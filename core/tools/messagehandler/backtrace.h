@@ -31,9 +31,20 @@
 #define GAMMARAY_MESSAGEHANDLER_BACKTRACE_H
 
 #include <QStringList>
+#include <QVector>
 
-typedef QStringList Backtrace;
+/** Raw return addresses of a call stack, see symbolizeBacktrace(). */
+typedef QVector<quintptr> Backtrace;
 
+/** Captures the current call stack, without resolving any symbols. */
 Backtrace getBacktrace(int levels = -1);
 
+/** Resolves the frames of @p backtrace into human-readable form.
+ *  Results are cached per address, frames shared between backtraces are only resolved once.
+ */
+QStringList symbolizeBacktrace(const Backtrace &backtrace);
+
+/** Platform-specific resolution of a single return address, see symbolizeBacktrace(). */
+QString symbolizeAddress(quintptr address);
+
 #endif // BACKTRACE_H
@@ -33,3 +33,9 @@ Backtrace getBacktrace(int levels)
     Q_UNUSED(levels);
     return Backtrace();
 }
+
+QString symbolizeAddress(quintptr address)
+{
+    Q_UNUSED(address);
+    return QString();
+}
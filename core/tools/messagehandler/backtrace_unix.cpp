@@ -70,26 +70,34 @@ static QString maybeDemangleName(char *name)
 
 Backtrace getBacktrace(int levels)
 {
-    QStringList s;
+    Backtrace bt;
 #ifdef HAVE_BACKTRACE
     void *trace[256];
     int n = backtrace(trace, 256);
-    if (!n)
-        return s;
-    char **strings = backtrace_symbols(trace, n);
-
     if (levels != -1)
         n = qMin(n, levels);
 
-    s.reserve(n);
+    bt.reserve(n);
     for (int i = 0; i < n; ++i)
-        s << maybeDemangleName(strings[i]);
-
-    if (strings)
-        free(strings);
-
+        bt.push_back(reinterpret_cast<quintptr>(trace[i]));
 #else
     Q_UNUSED(levels);
 #endif
-    return s;
+    return bt;
+}
+
+QString symbolizeAddress(quintptr address)
+{
+#ifdef HAVE_BACKTRACE
+    void *trace[] = { reinterpret_cast<void *>(address) };
+    char **strings = backtrace_symbols(trace, 1);
+    if (!strings)
+        return QString();
+    const QString frame = maybeDemangleName(strings[0]);
+    free(strings);
+    return frame;
+#else
+    Q_UNUSED(address);
+    return QString();
+#endif
 }
@@ -28,47 +28,55 @@
 */
 
 #include "backtrace.h"
-#include <StackWalker/StackWalker.h>
 
-class StackWalkerToQStringList : public StackWalker
-{
-public:
-    QStringList getStackWalkerBacktrace()
-    {
-        m_stackTrace.clear();
-        ShowCallstack();
-        return m_stackTrace;
-    }
+#include <windows.h>
+#include <dbghelp.h>
 
-protected:
-    virtual void OnOutput(LPCSTR szText)
-    {
-        m_stackTrace << szText;
-    }
+#pragma comment(lib, "dbghelp.lib")
 
-    virtual void OnSymInit(LPCSTR szSearchPath, DWORD symOptions, LPCSTR szUserName)
-    {
-    }
+// CaptureStackBackTrace doesn't support more than 62 frames on Windows XP/2003
+static const int MaxFrames = 62;
 
-    virtual void OnLoadModule(LPCSTR img, LPCSTR mod, DWORD64 baseAddr, DWORD size, DWORD result,
-                              LPCSTR symType, LPCSTR pdbName, ULONGLONG fileVersion)
-    {
-    }
+Backtrace getBacktrace(int levels)
+{
+    void *trace[MaxFrames];
+    const int n = CaptureStackBackTrace(0, levels == -1 ? MaxFrames : qMin(levels, MaxFrames),
+                                        trace, NULL);
+    Backtrace bt;
+    bt.reserve(n);
+    for (int i = 0; i < n; ++i)
+        bt.push_back(reinterpret_cast<quintptr>(trace[i]));
+    return bt;
+}
 
-    virtual void OnDbgHelpErr(LPCSTR szFuncName, DWORD gle, DWORD64 addr)
-    {
+QString symbolizeAddress(quintptr address)
+{
+    const HANDLE process = GetCurrentProcess();
+
+    // symbolizeBacktrace() serializes this, as required by dbghelp
+    static bool symbolsInitialized = false;
+    if (!symbolsInitialized) {
+        SymSetOptions(SymGetOptions() | SYMOPT_UNDNAME | SYMOPT_LOAD_LINES | SYMOPT_DEFERRED_LOADS);
+        SymInitialize(process, NULL, TRUE);
+        symbolsInitialized = true;
     }
 
-private:
-    QStringList m_stackTrace;
-};
-
-static StackWalkerToQStringList *stackWalkerToQStringList = 0;
-
-Backtrace getBacktrace(int /*levels*/)
-{
-    // FIXME: Perhaps take the levels into account
-    if (!stackWalkerToQStringList)
-        stackWalkerToQStringList = new StackWalkerToQStringList();
-    return stackWalkerToQStringList->getStackWalkerBacktrace();
+    char buffer[sizeof(SYMBOL_INFO) + MAX_SYM_NAME * sizeof(CHAR)];
+    SYMBOL_INFO *symbol = reinterpret_cast<SYMBOL_INFO *>(buffer);
+    symbol->SizeOfStruct = sizeof(SYMBOL_INFO);
+    symbol->MaxNameLen = MAX_SYM_NAME;
+    DWORD64 symbolDisplacement = 0;
+    const QString name = SymFromAddr(process, address, &symbolDisplacement, symbol)
+                         ? QString::fromLatin1(symbol->Name)
+                         : QStringLiteral("0x%1").arg(address, 0, 16);
+
+    IMAGEHLP_LINE64 line;
+    line.SizeOfStruct = sizeof(IMAGEHLP_LINE64);
+    DWORD lineDisplacement = 0;
+    if (SymGetLineFromAddr64(process, address, &lineDisplacement, &line)) {
+        // same format as StackWalker used to produce
+        return QStringLiteral("%1 (%2): %3").arg(QString::fromLocal8Bit(line.FileName))
+               .arg(line.LineNumber).arg(name);
+    }
+    return name;
 }
@@ -46,6 +46,7 @@
 #include <QSortFilterProxyModel>
 #include <QThread>
 
+#include <cstdio>
 #include <iostream>
 
 using namespace GammaRay;
@@ -62,9 +63,33 @@ static MessageHandlerCallback(*const installMessageHandler)(MessageHandlerCallba
 
 static MessageModel *s_model = 0;
 static MessageHandlerCallback s_handler = 0;
-static bool s_handlerDisabled = false;
 static QMutex s_mutex(QMutex::Recursive);
 
+/** Output of Qt's default message handler, for when there is no previous handler to call. */
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+static void defaultMessageOutput(QtMsgType type, const char *rawMsg)
+{
+    Q_UNUSED(type);
+    fprintf(stderr, "%s\n", rawMsg);
+    fflush(stderr);
+}
+#else
+static void defaultMessageOutput(QtMsgType type, const QMessageLogContext &context, const QString &msg)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+    const QString formattedMsg = qFormatLogMessage(type, context, msg);
+    if (formattedMsg.isNull())
+        return; // filtered out by the message pattern
+#else
+    Q_UNUSED(type);
+    Q_UNUSED(context);
+    const QString &formattedMsg = msg;
+#endif
+    fprintf(stderr, "%s\n", formattedMsg.toLocal8Bit().constData());
+    fflush(stderr);
+}
+#endif
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 static void handleMessage(QtMsgType type, const char *rawMsg)
 #else
@@ -91,19 +116,9 @@ static void handleMessage(QtMsgType type, const QMessageLogContext &context, con
 
     if (type == QtCriticalMsg || type == QtFatalMsg
         || (type == QtWarningMsg && !ProbeGuard::insideProbe())) {
+        // only capture the return addresses here, resolving them is expensive and
+        // happens on demand, if at all
         message.backtrace = getBacktrace(50);
-        // remove trailing internal functions
-        // be a bit careful and first make sure that we find this function...
-        // TODO: go even higher until qWarning/qFatal/qDebug/... ?
-        int removeUntil = -1;
-        for (int i = 0; i < message.backtrace.size(); ++i) {
-            if (message.backtrace.at(i).contains(QLatin1String("handleMessage"))) {
-                removeUntil = i;
-                break;
-            }
-        }
-        if (removeUntil != -1)
-            message.backtrace = message.backtrace.mid(removeUntil + 1);
     }
 
     if (!message.backtrace.isEmpty()
@@ -113,7 +128,7 @@ static void handleMessage(QtMsgType type, const QMessageLogContext &context, con
                 qApp->applicationFilePath()) << ')' << std::endl;
         std::cerr << "START BACKTRACE:" << std::endl;
         int i = 0;
-        foreach (const QString &frame, message.backtrace)
+        foreach (const QString &frame, message.symbolizedBacktrace())
             std::cerr << (++i) << "\t" << qPrintable(frame) << std::endl;
         std::cerr << "END BACKTRACE" << std::endl;
     }
@@ -126,34 +141,20 @@ static void handleMessage(QtMsgType type, const QMessageLogContext &context, con
                                   Q_ARG(GammaRay::DebugMessage, message));
     }
 
-    // reset msg handler so the app still works as usual
-    // but make sure we don't let other threads bypass our
-    // handler during that time
-    QMutexLocker lock(&s_mutex);
-    s_handlerDisabled = true;
-    if (s_handler) { // try a direct call to the previous handler first, that avoids triggering the recursion detection in Qt5
-#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
-        s_handler(type, context, msg);
-#else
-        s_handler(type, rawMsg);
-#endif
-    } else {
-        installMessageHandler(s_handler);
+    // call the previous handler directly, rather than reinstalling it temporarily, that avoids
+    // triggering the recursion detection in Qt5, and doesn't need to serialize the logging threads
+    MessageHandlerCallback handler = s_handler;
+    if (!handler)
+        handler = defaultMessageOutput;
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
-        qt_message_output(type, context, msg);
+    handler(type, context, msg);
 #else
-        qt_message_output(type, rawMsg);
+    handler(type, rawMsg);
 #endif
-        installMessageHandler(handleMessage);
-    }
-    s_handlerDisabled = false;
-    lock.unlock();
 
-    if (s_model) {
-        // add directly from foreground thread, delay from background thread
-        QMetaObject::invokeMethod(s_model, "addMessage", Qt::AutoConnection,
-                                  Q_ARG(GammaRay::DebugMessage, message));
-    }
+    // lock-free, inserted in batches by the model's thread
+    if (s_model)
+        s_model->addMessage(message);
 }
 
 MessageHandler::MessageHandler(ProbeInterface *probe, QObject *parent)
@@ -166,7 +167,6 @@ MessageHandler::MessageHandler(ProbeInterface *probe, QObject *parent)
     auto proxy = new ServerProxyModel<QSortFilterProxyModel>(this);
     proxy->addRole(MessageModelRole::Type);
     proxy->addRole(MessageModelRole::Line);
-    proxy->addRole(MessageModelRole::Backtrace);
     proxy->setSourceModel(m_messageModel);
     proxy->setSortRole(MessageModelRole::Sort);
     probe->registerModel(QStringLiteral("com.kdab.GammaRay.MessageModel"), proxy);
@@ -202,9 +202,6 @@ void MessageHandler::ensureHandlerInstalled()
 {
     QMutexLocker lock(&s_mutex);
 
-    if (s_handlerDisabled)
-        return;
-
     MessageHandlerCallback prevHandler = installMessageHandler(handleMessage);
 
     if (prevHandler != handleMessage)
@@ -216,7 +213,7 @@ void MessageHandler::handleFatalMessage(const DebugMessage &message)
     const QString app = qApp->applicationName().isEmpty()
                         ? qApp->applicationFilePath()
                         : qApp->applicationName();
-    emit fatalMessageReceived(app, message.message, message.time, message.backtrace);
+    emit fatalMessageReceived(app, message.message, message.time, message.symbolizedBacktrace());
     if (Endpoint::isConnected())
         Endpoint::instance()->waitForMessagesWritten();
 }
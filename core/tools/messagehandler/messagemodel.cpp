@@ -29,19 +29,79 @@
 #include "messagemodel.h"
 
 #include <common/tools/messagehandler/messagemodelroles.h>
+#include <core/probesettings.h>
 
 #include <QDebug>
 
+#include <algorithm>
+
 using namespace GammaRay;
 
+QStringList DebugMessage::symbolizedBacktrace() const
+{
+    const QStringList frames = symbolizeBacktrace(backtrace);
+    // remove trailing internal functions
+    // be a bit careful and first make sure that we find this function...
+    // TODO: go even higher until qWarning/qFatal/qDebug/... ?
+    for (int i = 0; i < frames.size(); ++i) {
+        if (frames.at(i).contains(QLatin1String("handleMessage")))
+            return frames.mid(i + 1);
+    }
+    return frames;
+}
+
+static const int DefaultCapacity = 20000;
+
+template<typename T>
+static inline T *loadAcquire(QAtomicPointer<T> &value)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    return value.loadAcquire();
+#else
+    return value.fetchAndAddAcquire(0);
+#endif
+}
+
 MessageModel::MessageModel(QObject *parent)
     : QAbstractTableModel(parent)
+    , m_pendingMessages(0)
+    , m_firstMessage(0)
+    , m_messageCount(0)
+    , m_capacity(qMax(1, ProbeSettings::value(QStringLiteral("MessageHistorySize"),
+                                              DefaultCapacity).toInt()))
 {
     qRegisterMetaType<DebugMessage>();
 }
 
 MessageModel::~MessageModel()
 {
+    PendingMessage *pending = m_pendingMessages.fetchAndStoreAcquire(0);
+    while (pending) {
+        PendingMessage *next = pending->next;
+        delete pending;
+        pending = next;
+    }
+}
+
+int MessageModel::capacity() const
+{
+    return m_capacity;
+}
+
+void MessageModel::setCapacity(int capacity)
+{
+    capacity = qMax(1, capacity);
+    if (capacity == m_capacity)
+        return;
+
+    if (m_messageCount > capacity) {
+        beginRemoveRows(QModelIndex(), 0, m_messageCount - capacity - 1);
+        removeOldestMessages(m_messageCount - capacity);
+        endRemoveRows();
+    }
+    linearize();
+    m_messages.resize(m_messageCount);
+    m_capacity = capacity;
 }
 
 void MessageModel::addMessage(const DebugMessage &message)
@@ -49,11 +109,100 @@ void MessageModel::addMessage(const DebugMessage &message)
     ///WARNING: do not trigger *any* kind of debug output here
     ///         this would trigger an infinite loop and hence crash!
 
-    beginInsertRows(QModelIndex(), m_messages.count(), m_messages.count());
-    m_messages << message;
+    PendingMessage *pending = new PendingMessage;
+    pending->message = message;
+    PendingMessage *head;
+    do {
+        head = loadAcquire(m_pendingMessages);
+        pending->next = head;
+    } while (!m_pendingMessages.testAndSetRelease(head, pending));
+
+    // whoever finds the stack empty schedules processing, everything pushed
+    // until then is inserted in the same batch
+    if (!head)
+        QMetaObject::invokeMethod(this, "processPendingMessages", Qt::QueuedConnection);
+}
+
+void MessageModel::processPendingMessages()
+{
+    ///WARNING: do not trigger *any* kind of debug output here
+    ///         this would trigger an infinite loop and hence crash!
+
+    PendingMessage *pending = m_pendingMessages.fetchAndStoreAcquire(0);
+    if (!pending)
+        return;
+
+    // the stack has the newest message first, restore the original order
+    QVector<DebugMessage> batch;
+    while (pending) {
+        PendingMessage *next = pending->next;
+        batch.push_back(pending->message);
+        delete pending;
+        pending = next;
+    }
+    std::reverse(batch.begin(), batch.end());
+
+    // messages that would be discarded right away are not inserted at all
+    const int skipped = qMax(0, batch.size() - m_capacity);
+    const int inserted = batch.size() - skipped;
+    const int removed = qMax(0, m_messageCount + inserted - m_capacity);
+
+    if (removed > 0) {
+        beginRemoveRows(QModelIndex(), 0, removed - 1);
+        removeOldestMessages(removed);
+        endRemoveRows();
+    }
+
+    beginInsertRows(QModelIndex(), m_messageCount, m_messageCount + inserted - 1);
+    if (m_messageCount + inserted > m_messages.size())
+        linearize(); // growing the storage requires a contiguous layout
+    for (int i = skipped; i < batch.size(); ++i) {
+        DebugMessage &msg = batch[i];
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        msg.category = intern(msg.category);
+        msg.file = intern(msg.file);
+        msg.function = intern(msg.function);
+#endif
+        if (m_messages.size() < m_capacity && m_firstMessage == 0 && m_messageCount == m_messages.size())
+            m_messages.push_back(msg);
+        else
+            m_messages[(m_firstMessage + m_messageCount) % m_messages.size()] = msg;
+        ++m_messageCount;
+    }
     endInsertRows();
 }
 
+const DebugMessage &MessageModel::messageAt(int row) const
+{
+    return m_messages.at((m_firstMessage + row) % m_messages.size());
+}
+
+void MessageModel::removeOldestMessages(int count)
+{
+    Q_ASSERT(count <= m_messageCount);
+    for (int i = 0; i < count; ++i)
+        m_messages[(m_firstMessage + i) % m_messages.size()] = DebugMessage(); // release the data
+    m_firstMessage = m_messageCount == count ? 0 : (m_firstMessage + count) % m_messages.size();
+    m_messageCount -= count;
+}
+
+void MessageModel::linearize()
+{
+    if (m_firstMessage == 0)
+        return;
+    std::rotate(m_messages.begin(), m_messages.begin() + m_firstMessage, m_messages.end());
+    m_firstMessage = 0;
+}
+
+QString MessageModel::intern(const QString &str)
+{
+    const QSet<QString>::const_iterator it = m_strings.constFind(str);
+    if (it != m_strings.constEnd())
+        return *it;
+    m_strings.insert(str);
+    return str;
+}
+
 int MessageModel::columnCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
@@ -69,15 +218,15 @@ int MessageModel::rowCount(const QModelIndex &parent) const
     if (parent.isValid())
         return 0;
 
-    return m_messages.count();
+    return m_messageCount;
 }
 
 QVariant MessageModel::data(const QModelIndex &index, int role) const
 {
-    if (!index.isValid() || index.row() > rowCount() || index.column() > columnCount())
+    if (!index.isValid() || index.row() >= rowCount() || index.column() >= columnCount())
         return QVariant();
 
-    const DebugMessage &msg = m_messages.at(index.row());
+    const DebugMessage &msg = messageAt(index.row());
 
     if (role == Qt::DisplayRole) {
         switch (index.column()) {
@@ -116,7 +265,7 @@ QVariant MessageModel::data(const QModelIndex &index, int role) const
         return msg.line;
 #endif
     } else if (role == MessageModelRole::Backtrace && index.column() == 0) {
-        return msg.backtrace;
+        return msg.symbolizedBacktrace();
     }
 
     return QVariant();
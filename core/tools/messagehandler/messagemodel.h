@@ -33,15 +33,20 @@
 #include <common/tools/messagehandler/messagemodelroles.h>
 
 #include <QAbstractTableModel>
+#include <QAtomicPointer>
+#include <QSet>
 #include <QTime>
 #include <QVector>
 
 namespace GammaRay {
 struct DebugMessage {
+    /** The resolved backtrace, without the frames of the message handler itself. */
+    QStringList symbolizedBacktrace() const;
+
     QtMsgType type;
     QString message;
     QTime time;
-    Backtrace backtrace;
+    Backtrace backtrace; // resolved on demand, see symbolizedBacktrace()
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
     QString category;
     QString file;
@@ -57,6 +62,10 @@ QT_BEGIN_NAMESPACE
 QT_END_NAMESPACE
 
 namespace GammaRay {
+/** Keeps the most recent messages, up to capacity().
+ *  Messages can be added from any thread without blocking, they are inserted in batches
+ *  by the thread owning the model.
+ */
 class MessageModel : public QAbstractTableModel
 {
     Q_OBJECT
@@ -64,17 +73,48 @@ public:
     explicit MessageModel(QObject *parent = 0);
     ~MessageModel();
 
+    /** Maximum number of messages kept, older messages are discarded beyond that.
+     *  Defaults to the MessageHistorySize probe setting.
+     */
+    int capacity() const;
+    void setCapacity(int capacity);
+
+    /** Queues @p message for insertion. Thread-safe and lock-free. */
+    void addMessage(const GammaRay::DebugMessage &message);
+
     int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
     int columnCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
     QVariant headerData(int section, Qt::Orientation orientation,
                         int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
 
-public slots:
-    void addMessage(const GammaRay::DebugMessage &message);
+private slots:
+    void processPendingMessages();
 
 private:
+    struct PendingMessage {
+        DebugMessage message;
+        PendingMessage *next;
+    };
+
+    const DebugMessage &messageAt(int row) const;
+    /// discards the @p count oldest messages from the ring
+    void removeOldestMessages(int count);
+    /// moves the oldest message to the start of the storage
+    void linearize();
+    QString intern(const QString &str);
+
+    // lock-free stack of messages not yet inserted, newest first
+    QAtomicPointer<PendingMessage> m_pendingMessages;
+
+    // ring buffer of messages, the oldest one being at m_firstMessage
     QVector<DebugMessage> m_messages;
+    int m_firstMessage;
+    int m_messageCount;
+    int m_capacity;
+
+    // shared string data of categories, files and functions
+    QSet<QString> m_strings;
 };
 }
 
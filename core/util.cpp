@@ -194,33 +194,65 @@ static IconDatabase readIconData()
     return data;
 }
 
+static const IconCacheEntry *findIconEntry(const IconDatabase &iconDataBase, const QMetaObject *mo)
+{
+    for (; mo; mo = mo->superClass()) {
+        // stupid Qt convention to use int for sizes... the static cast shuts down warnings about conversion from size_t to int.
+        const QByteArray className
+            = QByteArray::fromRawData(mo->className(), static_cast<int>(strlen(mo->className())));
+        IconDatabase::const_iterator it = iconDataBase.constFind(className);
+        if (it != iconDataBase.constEnd())
+            return &it.value();
+    }
+    return 0;
+}
+
+/// resolved icon entry for a meta object, or 0 if there is none in the class hierarchy
+struct MetaObjectIcon
+{
+    // to detect reused addresses of dynamic meta objects
+    const char *className;
+    const IconCacheEntry *entry;
+};
+
+// dynamic meta objects can be per instance, so don't let this grow unbounded
+static const int MaxCachedMetaObjects = 4096;
+
 static QVariant iconForObject(const QMetaObject *mo, const QObject *obj)
 {
     static const IconDatabase iconDataBase = readIconData();
-    // stupid Qt convention to use int for sizes... the static cast shuts down warnings about conversion from size_t to int.
-    const QByteArray className
-        = QByteArray::fromRawData(mo->className(), static_cast<int>(strlen(mo->className())));
-    IconDatabase::const_iterator it = iconDataBase.constFind(className);
-    if (it != iconDataBase.constEnd()) {
-        foreach (const IconCacheEntry::PropertyIcon &propertyIcon, it->propertyIcons) {
-            bool allMatch = true;
-            Q_ASSERT(!propertyIcon.second.isEmpty());
-            foreach (const IconCacheEntry::PropertyPair &keyValue, propertyIcon.second) {
-                if (stringifyProperty(obj, keyValue.first) != keyValue.second) {
-                    allMatch = false;
-                    break;
-                }
+    static QHash<const QMetaObject *, MetaObjectIcon> metaObjectIcons;
+
+    QHash<const QMetaObject *, MetaObjectIcon>::const_iterator it = metaObjectIcons.constFind(mo);
+    if (it == metaObjectIcons.constEnd() || it->className != mo->className()) {
+        if (metaObjectIcons.size() >= MaxCachedMetaObjects)
+            metaObjectIcons.clear();
+        MetaObjectIcon icon;
+        icon.className = mo->className();
+        icon.entry = findIconEntry(iconDataBase, mo);
+        it = metaObjectIcons.insert(mo, icon);
+    }
+
+    const IconCacheEntry *entry = it->entry;
+    if (!entry)
+        return QVariant();
+    // only classes with property-specific icons need to look at the object itself
+    if (entry->propertyIcons.isEmpty())
+        return entry->defaultIcon;
+
+    foreach (const IconCacheEntry::PropertyIcon &propertyIcon, entry->propertyIcons) {
+        bool allMatch = true;
+        Q_ASSERT(!propertyIcon.second.isEmpty());
+        foreach (const IconCacheEntry::PropertyPair &keyValue, propertyIcon.second) {
+            if (stringifyProperty(obj, keyValue.first) != keyValue.second) {
+                allMatch = false;
+                break;
             }
-            if (allMatch)
-                return propertyIcon.first;
         }
-        return it->defaultIcon;
+        if (allMatch)
+            return propertyIcon.first;
     }
-
-    if (mo->superClass())
-        return iconForObject(mo->superClass(), obj);
-
-    return QVariant();
+    return entry->defaultIcon;
 }
 }
 
@@ -128,8 +128,8 @@ QVariant ActionModel::data(const QModelIndex &index, int role) const
     if (!index.isValid())
         return QVariant();
 
-    QMutexLocker lock(Probe::objectLock());
     QAction *action = m_actions.at(index.row());
+    QMutexLocker lock(Probe::objectLock(action));
     if (!Probe::instance()->isValidObject(action))
         return QVariant();
 
@@ -72,10 +72,19 @@
 #include <private/qquickshadereffectsource_p.h>
 #include <QMatrix4x4>
 #include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QOpenGLFunctions>
 
 #include <private/qquickanchors_p.h>
 #include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
 #include <private/qsgbatchrenderer_p.h>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+#include <private/qsgsoftwarerenderer_p.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
 
 Q_DECLARE_METATYPE(QQmlError)
 
@@ -244,7 +253,12 @@ QuickInspector::QuickInspector(ProbeInterface *probe, QObject *parent)
                                                         "com.kdab.GammaRay.QuickSceneGraph"), this))
     , m_remoteView(new RemoteViewServer(QStringLiteral("com.kdab.GammaRay.QuickRemoteView"), this))
     , m_isGrabbingWindow(false)
+    , m_captureTime(-1)
 {
+    m_frameCapture.latest = -1;
+    m_frameCapture.captureTime = -1;
+    m_frameCapture.generation = 0;
+
     registerPCExtensions();
     registerMetaTypes();
     registerVariantHandlers();
@@ -312,6 +326,7 @@ void QuickInspector::selectWindow(QQuickWindow *window)
     }
 
     m_window = window;
+    resetFrameCapture();
     m_itemModel->setWindow(window);
     m_sgModel->setWindow(window);
     m_remoteView->setEventReceiver(m_window);
@@ -321,6 +336,10 @@ void QuickInspector::selectWindow(QQuickWindow *window)
         // make sure we have selected something for the property editor to not be entirely empty
         selectItem(m_window->contentItem());
 
+        // needs to be connected first, so the frame is available once slotSceneChanged triggers an update request
+        connect(window, &QQuickWindow::afterRendering, this, [this, window]() {
+            captureFrame(window);
+        }, Qt::DirectConnection);
         // frame swapped isn't enough, we don't get that for FBO render targets such as in QQuickWidget
         connect(window, &QQuickWindow::afterRendering, this, &QuickInspector::slotSceneChanged);
         connect(window, &QQuickWindow::frameSwapped, this, &QuickInspector::slotSceneChanged);
@@ -393,6 +412,8 @@ void QuickInspector::sendRenderedScene(const QImage &currentFrame)
 
     RemoteViewFrame frame;
     frame.setImage(currentFrame);
+    frame.setCaptureTime(m_captureTime);
+    m_captureTime = -1;
     QuickItemGeometry itemGeometry;
     if (m_currentItem) {
         QQuickItem *parent = m_currentItem->parentItem();
@@ -453,6 +474,11 @@ void QuickInspector::sendRenderedScene(const QImage &currentFrame)
 
 void QuickInspector::slotSceneChanged()
 {
+    if (!m_remoteView->isActive() && m_frameCapture.enabled.load()) {
+        // the scene changes unobserved from now on, so drop what we have
+        m_frameCapture.enabled.store(0);
+        resetFrameCapture();
+    }
     if (!m_isGrabbingWindow)
         m_remoteView->sourceChanged();
 }
@@ -469,9 +495,34 @@ void QuickInspector::slotGrabWindow()
             return;
     }
 
+    if (canCaptureFrames()) {
+        // use the last frame the render thread copied for us, rather than forcing another render pass
+        m_frameCapture.enabled.store(1);
+        QImage img;
+        {
+            QMutexLocker lock(&m_frameCapture.mutex);
+            if (m_frameCapture.latest >= 0) {
+                img = m_frameCapture.images[m_frameCapture.latest];
+                m_captureTime = m_frameCapture.captureTime;
+            }
+        }
+        if (!img.isNull()) {
+            sendRenderedScene(img);
+            return;
+        }
+
+        // nothing captured yet, the next frame will trigger another update request
+        m_isGrabbingWindow = false;
+        m_window->update();
+        return;
+    }
+
     // delay this so we can process the signals to slotSceneChanged first, while we are in the m_isGrabbingWindow state
     // otherwise we end up with an infinite update loop even on static scenes
+    QElapsedTimer grabTimer;
+    grabTimer.start();
     auto img = m_window->grabWindow();
+    m_captureTime = grabTimer.nsecsElapsed();
     // See QTBUG-53795
 #if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
     img.setDevicePixelRatio(m_window->effectiveDevicePixelRatio());
@@ -481,6 +532,120 @@ void QuickInspector::slotGrabWindow()
     QMetaObject::invokeMethod(this, "sendRenderedScene", Qt::QueuedConnection, Q_ARG(QImage, img));
 }
 
+bool QuickInspector::canCaptureFrames() const
+{
+    if (!m_window)
+        return false;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    const auto rif = m_window->rendererInterface();
+    if (!rif)
+        return false;
+    return rif->graphicsApi() == QSGRendererInterface::OpenGL
+           || rif->graphicsApi() == QSGRendererInterface::Software;
+#else
+    return true;
+#endif
+}
+
+static qreal windowDevicePixelRatio(QQuickWindow *window)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
+    return window->effectiveDevicePixelRatio();
+#else
+    return window->devicePixelRatio();
+#endif
+}
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+static bool copySoftwareFrame(QQuickWindow *window, QImage &target)
+{
+    auto renderer = static_cast<QSGSoftwareRenderer *>(QQuickWindowPrivate::get(window)->renderer);
+    QPaintDevice *device = renderer ? renderer->currentPaintDevice() : Q_NULLPTR;
+    if (!device || device->devType() != QInternal::Image)
+        return false;
+
+    const QImage &source = *static_cast<QImage *>(device);
+    const QSize size = (QSizeF(window->size()) * windowDevicePixelRatio(window)).toSize().boundedTo(source.size());
+    if (target.size() != size || target.format() != source.format())
+        target = QImage(size, source.format());
+    const int lineSize = qMin(source.bytesPerLine(), target.bytesPerLine());
+    for (int y = 0; y < size.height(); ++y)
+        memcpy(target.scanLine(y), source.constScanLine(y), lineSize);
+    return true;
+}
+#endif
+
+static bool readOpenGLFrame(QQuickWindow *window, QImage &target)
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    if (!context)
+        return false;
+
+    const QSize size = window->renderTarget()
+                       ? window->renderTargetSize()
+                       : (QSizeF(window->size()) * windowDevicePixelRatio(window)).toSize();
+    if (size.isEmpty())
+        return false;
+    if (target.size() != size || target.format() != QImage::Format_RGBA8888)
+        target = QImage(size, QImage::Format_RGBA8888);
+
+    context->functions()->glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, target.bits());
+
+    // OpenGL has the origin at the bottom left
+    for (int y = 0; y < size.height() / 2; ++y) {
+        uchar *top = target.scanLine(y);
+        uchar *bottom = target.scanLine(size.height() - y - 1);
+        std::swap_ranges(top, top + target.bytesPerLine(), bottom);
+    }
+    return true;
+}
+
+void QuickInspector::captureFrame(QQuickWindow *window)
+{
+    if (!m_frameCapture.enabled.load() || !m_frameCapture.busy.testAndSetAcquire(0, 1))
+        return;
+
+    QElapsedTimer captureTimer;
+    captureTimer.start();
+
+    int slot;
+    int generation;
+    {
+        QMutexLocker lock(&m_frameCapture.mutex);
+        slot = m_frameCapture.latest == 0 ? 1 : 0;
+        generation = m_frameCapture.generation;
+    }
+
+    // the GUI thread only ever looks at the latest image, so we can write into the other one without locking
+    QImage &img = m_frameCapture.images[slot];
+    bool captured = false;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 8, 0)
+    if (window->rendererInterface()->graphicsApi() == QSGRendererInterface::Software)
+        captured = copySoftwareFrame(window, img);
+    else
+#endif
+    captured = readOpenGLFrame(window, img);
+
+    if (captured) {
+        img.setDevicePixelRatio(windowDevicePixelRatio(window));
+        QMutexLocker lock(&m_frameCapture.mutex);
+        if (generation == m_frameCapture.generation) {
+            m_frameCapture.latest = slot;
+            m_frameCapture.captureTime = captureTimer.nsecsElapsed();
+        }
+    }
+
+    m_frameCapture.busy.storeRelease(0);
+}
+
+void QuickInspector::resetFrameCapture()
+{
+    QMutexLocker lock(&m_frameCapture.mutex);
+    ++m_frameCapture.generation;
+    m_frameCapture.latest = -1;
+    m_frameCapture.captureTime = -1;
+}
+
 static QByteArray renderModeToString(GammaRay::QuickInspectorInterface::RenderMode customRenderMode)
 {
     switch (customRenderMode) {
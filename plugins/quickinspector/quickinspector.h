@@ -35,6 +35,7 @@
 #include <core/toolfactory.h>
 
 #include <QQuickWindow>
+#include <QAtomicInt>
 #include <QImage>
 #include <QMutex>
 
@@ -113,6 +114,11 @@ private:
     void registerPCExtensions();
     QString findSGNodeType(QSGNode *node) const;
     void applyRenderMode();
+    /// @c true if frames of the current window can be copied by captureFrame()
+    bool canCaptureFrames() const;
+    /// copies the just rendered frame into the frame pool, called in the render thread
+    void captureFrame(QQuickWindow *window);
+    void resetFrameCapture();
 
     GammaRay::ObjectIds recursiveItemsAt(QQuickItem *parent, const QPointF &pos,
                                          GammaRay::RemoteViewInterface::RequestMode mode, int& bestCandidate) const;
@@ -132,6 +138,19 @@ private:
     QImage m_currentFrame;
     QVector<GrabWindowCallback> m_grabWindowCallbacks;
     bool m_isGrabbingWindow;
+    // time it took to obtain the frame passed to sendRenderedScene in nsecs, -1 if unknown
+    qint64 m_captureTime;
+    struct {
+        // double-buffered, the render thread writes into the one that isn't latest
+        QImage images[2];
+        int latest;
+        qint64 captureTime;
+        // incremented on window changes, to discard frames captured for the previous window
+        int generation;
+        QMutex mutex;
+        QAtomicInt enabled;
+        QAtomicInt busy;
+    } m_frameCapture;
     struct {
         RenderMode mode;
         QMetaObject::Connection connection;
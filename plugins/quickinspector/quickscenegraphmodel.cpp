@@ -29,13 +29,16 @@
 #include "quickscenegraphmodel.h"
 
 #include <private/qquickitem_p.h>
+#include <private/qquickwindow_p.h>
 #include "quickitemmodelroles.h"
 
+#include <QMutexLocker>
 #include <QQuickWindow>
 #include <QThread>
 #include <QSGNode>
 
 #include <algorithm>
+#include <limits>
 
 Q_DECLARE_METATYPE(QSGNode *)
 
@@ -44,6 +47,8 @@ using namespace GammaRay;
 QuickSceneGraphModel::QuickSceneGraphModel(QObject *parent)
     : ObjectModelBase<QAbstractItemModel>(parent)
     , m_rootNode(0)
+    , m_fullUpdateNeeded(true)
+    , m_stopAtItemNodes(false)
 {
 }
 
@@ -55,12 +60,17 @@ void QuickSceneGraphModel::setWindow(QQuickWindow *window)
 {
     beginResetModel();
     clear();
-    if (m_window)
-        disconnect(window, SIGNAL(beforeRendering()), this, SLOT(updateSGTree()));
+    if (m_window) {
+        disconnect(m_window, SIGNAL(beforeSynchronizing()), this, SLOT(collectDirtyItems()));
+        disconnect(m_window, SIGNAL(afterSynchronizing()), this, SLOT(collectDirtyNodes()));
+        disconnect(m_window, SIGNAL(beforeRendering()), this, SLOT(updateSGTree()));
+    }
     m_window = window;
     m_rootNode = currentRootNode();
     if (m_window && m_rootNode) {
         updateSGTree(false);
+        connect(window, SIGNAL(beforeSynchronizing()), this, SLOT(collectDirtyItems()), Qt::DirectConnection);
+        connect(window, SIGNAL(afterSynchronizing()), this, SLOT(collectDirtyNodes()), Qt::DirectConnection);
         connect(window, SIGNAL(beforeRendering()), this, SLOT(updateSGTree()));
     }
 
@@ -77,16 +87,108 @@ void QuickSceneGraphModel::updateSGTree(bool emitSignals)
         if (m_window && m_rootNode)
             updateSGTree(false);
         endResetModel();
-    } else {
+        return;
+    }
+
+    QVector<QPair<QQuickItem *, QSGNode *> > dirtyItemNodes;
+    bool fullUpdate;
+    {
+        QMutexLocker lock(&m_dirtyMutex);
+        dirtyItemNodes.swap(m_dirtyItemNodes);
+        fullUpdate = m_fullUpdateNeeded;
+        m_fullUpdateNeeded = false;
+    }
+
+    if (fullUpdate) {
         m_childParentMap[m_rootNode] = 0;
         m_parentChildMap[0].resize(1);
         m_parentChildMap[0][0] = m_rootNode;
 
         populateFromNode(m_rootNode, emitSignals);
         collectItemNodes(m_window->contentItem());
+        return;
+    }
+
+    // item nodes are only recorded once they are part of our tree, pruneSubTree() wouldn't
+    // remove them again otherwise, nodes reachable only after the update are recorded after it
+    QVector<QSGNode *> dirtyNodes;
+    dirtyNodes.reserve(dirtyItemNodes.size());
+    for (auto it = dirtyItemNodes.constBegin(); it != dirtyItemNodes.constEnd(); ++it) {
+        if (!it->second)
+            continue;
+        if (isInTree(it->second))
+            addItemNode(it->first, it->second);
+        dirtyNodes.push_back(it->second);
+    }
+    updateDirtySubTrees(dirtyNodes, emitSignals);
+
+    for (auto it = dirtyItemNodes.constBegin(); it != dirtyItemNodes.constEnd(); ++it) {
+        if (it->second && !m_itemNodeItemMap.contains(it->second) && isInTree(it->second))
+            addItemNode(it->first, it->second);
     }
 }
 
+void QuickSceneGraphModel::collectDirtyItems()
+{
+    if (!m_window)
+        return;
+    // the dirty item list is consumed by the synchronization, so grab it before that
+    m_syncDirtyItems.clear();
+    QQuickWindowPrivate *windowPriv = QQuickWindowPrivate::get(m_window);
+    for (QQuickItem *item = windowPriv->dirtyItemList; item;
+         item = QQuickItemPrivate::get(item)->nextDirtyItem)
+        m_syncDirtyItems.push_back(item);
+}
+
+void QuickSceneGraphModel::collectDirtyNodes()
+{
+    QMutexLocker lock(&m_dirtyMutex);
+    if (m_fullUpdateNeeded) {
+        m_syncDirtyItems.clear();
+        return;
+    }
+
+    // the item nodes only exist after synchronization, we must not create them ourselves here
+    foreach (QQuickItem *item, m_syncDirtyItems)
+        m_dirtyItemNodes.push_back(qMakePair(item, static_cast<QSGNode *>(QQuickItemPrivate::get(item)->itemNodeInstance)));
+    m_syncDirtyItems.clear();
+
+    // with most of the scene changed a full update is cheaper than many partial ones
+    // (reading the item map is safe here, the GUI thread is blocked during synchronization)
+    if (m_dirtyItemNodes.size() > m_itemItemNodeMap.size() / 2) {
+        m_dirtyItemNodes.clear();
+        m_fullUpdateNeeded = true;
+    }
+}
+
+void QuickSceneGraphModel::updateDirtySubTrees(const QVector<QSGNode *> &dirtyNodes, bool emitSignals)
+{
+    // handle parents before their children, removing a subtree makes updating nodes in there unnecessary,
+    // and nodes not (yet) in our tree are picked up by their parent if they are reachable at all
+    QVector<QPair<int, QSGNode *> > sortedNodes;
+    sortedNodes.reserve(dirtyNodes.size());
+    foreach (QSGNode *node, dirtyNodes) {
+        if (node != m_rootNode && !m_childParentMap.contains(node)) {
+            sortedNodes.push_back(qMakePair(std::numeric_limits<int>::max(), node));
+            continue;
+        }
+        int depth = 0;
+        for (QSGNode *parent = m_childParentMap.value(node); parent; parent = m_childParentMap.value(parent))
+            ++depth;
+        sortedNodes.push_back(qMakePair(depth, node));
+    }
+    std::sort(sortedNodes.begin(), sortedNodes.end());
+    sortedNodes.erase(std::unique(sortedNodes.begin(), sortedNodes.end()), sortedNodes.end());
+
+    m_stopAtItemNodes = true;
+    for (auto it = sortedNodes.constBegin(); it != sortedNodes.constEnd(); ++it) {
+        // only dereference nodes we know to be still part of the tree
+        if (it->second == m_rootNode || m_childParentMap.contains(it->second))
+            populateFromNode(it->second, emitSignals);
+    }
+    m_stopAtItemNodes = false;
+}
+
 QSGNode *QuickSceneGraphModel::currentRootNode() const
 {
     if (!m_window)
@@ -165,6 +267,12 @@ void QuickSceneGraphModel::clear()
 {
     m_childParentMap.clear();
     m_parentChildMap.clear();
+    m_itemItemNodeMap.clear();
+    m_itemNodeItemMap.clear();
+
+    QMutexLocker lock(&m_dirtyMutex);
+    m_dirtyItemNodes.clear();
+    m_fullUpdateNeeded = true;
 }
 
 // indexForNode() is expensive, so only use it when really needed
@@ -217,7 +325,8 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                 i = childList.insert(i, *j);
                 if (emitSignals)
                     endMoveRows();
-                populateFromNode(*j, emitSignals);
+                if (descendInto(*j))
+                    populateFromNode(*j, emitSignals);
             } else { // entirely new
                 if (emitSignals)
                     beginInsertRows(myIndex, idx, idx);
@@ -230,7 +339,8 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
             ++i;
             ++j;
         } else { // already known node, no change
-            populateFromNode(*j, emitSignals);
+            if (descendInto(*j))
+                populateFromNode(*j, emitSignals);
             ++i;
             ++j;
         }
@@ -274,7 +384,8 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
                 childList.append(*j);
                 if (emitSignals)
                     endMoveRows();
-                populateFromNode(*j, emitSignals);
+                if (descendInto(*j))
+                    populateFromNode(*j, emitSignals);
                 ++j;
             }
         }
@@ -300,19 +411,35 @@ void QuickSceneGraphModel::populateFromNode(QSGNode *node, bool emitSignals)
 
 #undef GET_INDEX
 
+bool QuickSceneGraphModel::descendInto(QSGNode *node) const
+{
+    return !m_stopAtItemNodes || !m_itemNodeItemMap.contains(node);
+}
+
 void QuickSceneGraphModel::collectItemNodes(QQuickItem *item)
 {
     if (!item)
         return;
 
     QSGNode *itemNode = QQuickItemPrivate::get(item)->itemNode();
-    m_itemItemNodeMap[item] = itemNode;
-    m_itemNodeItemMap[itemNode] = item;
+    if (isInTree(itemNode))
+        addItemNode(item, itemNode);
 
     foreach (QQuickItem *child, item->childItems())
         collectItemNodes(child);
 }
 
+bool QuickSceneGraphModel::isInTree(QSGNode *node) const
+{
+    return node == m_rootNode || m_childParentMap.contains(node);
+}
+
+void QuickSceneGraphModel::addItemNode(QQuickItem *item, QSGNode *node)
+{
+    m_itemItemNodeMap[item] = node;
+    m_itemNodeItemMap[node] = item;
+}
+
 QModelIndex QuickSceneGraphModel::indexForNode(QSGNode *node) const
 {
     if (!node)
@@ -380,4 +507,12 @@ void QuickSceneGraphModel::pruneSubTree(QSGNode *node)
         pruneSubTree(child);
     m_parentChildMap.remove(node);
     m_childParentMap.remove(node);
+
+    const auto itemIt = m_itemNodeItemMap.find(node);
+    if (itemIt != m_itemNodeItemMap.end()) {
+        // the item might have a new node already
+        if (m_itemItemNodeMap.value(itemIt.value()) == node)
+            m_itemItemNodeMap.remove(itemIt.value());
+        m_itemNodeItemMap.erase(itemIt);
+    }
 }
@@ -34,6 +34,7 @@
 #include "core/objectmodelbase.h"
 
 #include <QHash>
+#include <QMutex>
 #include <QPointer>
 #include <QVector>
 
@@ -44,7 +45,11 @@ class QQuickWindow;
 QT_END_NAMESPACE
 
 namespace GammaRay {
-/** QQ2 scene graph model. */
+/** QQ2 scene graph model.
+ *
+ *  After the initial population, only the subtrees of items that were synchronized to the
+ *  scene graph since the last update are re-examined, as reported by the window's dirty item list.
+ */
 class QuickSceneGraphModel : public ObjectModelBase<QAbstractItemModel>
 {
     Q_OBJECT
@@ -68,12 +73,19 @@ signals:
 
 private slots:
     void updateSGTree(bool emitSignals = true);
+    // called on the render thread while the GUI thread is blocked
+    void collectDirtyItems();
+    void collectDirtyNodes();
 
 private:
     void clear();
     QSGNode *currentRootNode() const;
+    void updateDirtySubTrees(const QVector<QSGNode *> &dirtyNodes, bool emitSignals);
     void populateFromNode(QSGNode *node, bool emitSignals);
+    bool descendInto(QSGNode *node) const;
     void collectItemNodes(QQuickItem *item);
+    bool isInTree(QSGNode *node) const;
+    void addItemNode(QQuickItem *item, QSGNode *node);
     bool recursivelyFindChild(QSGNode *root, QSGNode *child) const;
     void pruneSubTree(QSGNode *node);
 
@@ -84,6 +96,15 @@ private:
     QHash<QSGNode *, QVector<QSGNode *> > m_parentChildMap;
     QHash<QQuickItem *, QSGNode *> m_itemItemNodeMap;
     QHash<QSGNode *, QQuickItem *> m_itemNodeItemMap;
+
+    // items about to be synchronized, only accessed during synchronization
+    QVector<QQuickItem *> m_syncDirtyItems;
+    // changes since the last update, protected by m_dirtyMutex
+    QMutex m_dirtyMutex;
+    QVector<QPair<QQuickItem *, QSGNode *> > m_dirtyItemNodes;
+    bool m_fullUpdateNeeded;
+    // don't descend into known item nodes of other items, those are updated separately when dirty
+    bool m_stopAtItemNodes;
 };
 }
 
@@ -48,6 +48,7 @@
 #include <common/endpoint.h>
 #include <common/metatypedeclarations.h>
 #include <common/objectmodel.h>
+#include <common/protocol.h>
 
 #include <kde/krecursivefilterproxymodel.h>
 
@@ -59,8 +60,14 @@
 #include <QGraphicsWidget>
 #include <QGraphicsView>
 #include <QItemSelectionModel>
+#include <QPainter>
+#include <QRunnable>
+#include <QStyle>
+#include <QStyleOptionGraphicsItem>
+#include <QThreadPool>
 
 #include <iostream>
+#include <typeinfo>
 
 using namespace GammaRay;
 using namespace std;
@@ -76,11 +83,167 @@ Q_DECLARE_METATYPE(QGraphicsItem::GraphicsItemFlags)
 Q_DECLARE_METATYPE(QGraphicsItem::PanelModality)
 Q_DECLARE_METATYPE(QGraphicsPixmapItem::ShapeMode)
 
+// rendered tiles kept beyond the visible ones before unused ones are dropped
+static const int MaxCachedTiles = 128;
+
+/** Index of the tile containing tile grid coordinate @p pos. */
+static int tileIndex(int pos)
+{
+    const int size = SceneInspectorInterface::TileSize;
+    return pos >= 0 ? pos / size : (pos + 1) / size - 1;
+}
+
+/** Range of tile indexes intersecting @p rect, given in tile grid coordinates. */
+static QRect tileRange(const QRect &rect)
+{
+    if (rect.isEmpty())
+        return QRect();
+    return QRect(QPoint(tileIndex(rect.left()), tileIndex(rect.top())),
+                 QPoint(tileIndex(rect.right()), tileIndex(rect.bottom())));
+}
+
+/** Transform from scene to the pixels of tile @p index. */
+static QTransform transformForTile(const QTransform &transform, const QPoint &index)
+{
+    const int size = SceneInspectorInterface::TileSize;
+    return transform * QTransform::fromTranslate(-index.x() * size, -index.y() * size);
+}
+
+static bool isTextureBrush(const QBrush &brush)
+{
+    return brush.style() == Qt::TexturePattern;
+}
+
+/** Checks whether QGraphicsScene::render() output for @p item can be reproduced by calling
+ *  its paint() method directly, off the GUI thread. That is limited to the standard shape items,
+ *  which don't touch any shared state while painting (QPixmap or font based items do).
+ */
+static bool canPaintInThread(QGraphicsItem *item)
+{
+    const std::type_info &type = typeid(*item);
+    if (type == typeid(QGraphicsRectItem) || type == typeid(QGraphicsEllipseItem)
+        || type == typeid(QGraphicsPathItem) || type == typeid(QGraphicsPolygonItem)) {
+        const QAbstractGraphicsShapeItem *shape = static_cast<QAbstractGraphicsShapeItem *>(item);
+        if (isTextureBrush(shape->brush()) || isTextureBrush(shape->pen().brush()))
+            return false;
+    } else if (type == typeid(QGraphicsLineItem)) {
+        if (isTextureBrush(static_cast<QGraphicsLineItem *>(item)->pen().brush()))
+            return false;
+    } else if (type != typeid(QGraphicsItemGroup)) {
+        return false;
+    }
+
+    if (item->isClipped())
+        return false;
+    for (QGraphicsItem *it = item; it; it = it->parentItem()) {
+        if (it->graphicsEffect() || (it->flags() & QGraphicsItem::ItemIgnoresTransformations))
+            return false;
+    }
+    return true;
+}
+
+namespace GammaRay {
+/** An item painted directly into the tiles, bypassing QGraphicsScene::render(). */
+struct TileItem
+{
+    QGraphicsItem *item;
+    // item to tile grid
+    QTransform transform;
+    qreal opacity;
+    QStyleOptionGraphicsItem option;
+};
+
+/** Input shared by the TileRenderer jobs, read-only while those run. */
+struct TileRenderContext
+{
+    QTransform transform;
+    QBrush backgroundBrush;
+    QBrush foregroundBrush;
+    QVector<TileItem> items;
+};
+
+/** Renders one tile from the items intersecting it, in the same way QGraphicsScene::render() would. */
+class TileRenderer : public QRunnable
+{
+public:
+    TileRenderer(const TileRenderContext *context, const QPoint &index, const QVector<int> &items,
+                 QImage *result)
+        : m_context(context)
+        , m_index(index)
+        , m_items(items)
+        , m_result(result)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        const int size = SceneInspectorInterface::TileSize;
+        *m_result = QImage(size, size, QImage::Format_ARGB32_Premultiplied);
+        m_result->fill(Qt::transparent);
+
+        const QTransform transform = transformForTile(m_context->transform, m_index);
+        const QRectF exposedRect = transform.inverted().mapRect(QRectF(0, 0, size, size));
+        QPainter painter(m_result);
+        fillRect(&painter, transform, exposedRect, m_context->backgroundBrush);
+
+        const QTransform translation
+            = QTransform::fromTranslate(-m_index.x() * size, -m_index.y() * size);
+        foreach (int i, m_items) {
+            const TileItem &item = m_context->items.at(i);
+            painter.save();
+            painter.setWorldTransform(item.transform * translation);
+            painter.setOpacity(item.opacity);
+            item.item->paint(&painter, &item.option, 0);
+            painter.restore();
+        }
+
+        fillRect(&painter, transform, exposedRect, m_context->foregroundBrush);
+    }
+
+private:
+    // the default QGraphicsScene::drawBackground()/drawForeground() implementation
+    static void fillRect(QPainter *painter, const QTransform &transform, const QRectF &rect,
+                         const QBrush &brush)
+    {
+        if (brush.style() == Qt::NoBrush)
+            return;
+        painter->setWorldTransform(transform);
+        painter->setBrushOrigin(0, 0);
+        painter->fillRect(rect, brush);
+    }
+
+    const TileRenderContext *m_context;
+    QPoint m_index;
+    QVector<int> m_items;
+    QImage *m_result;
+};
+
+/** Encodes a tile for transfer, off the GUI thread. */
+class TileEncoder : public QRunnable
+{
+public:
+    explicit TileEncoder(TransferImage *image)
+        : m_image(image)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        m_image->encode(TransferImage::LosslessEncoding);
+    }
+
+private:
+    TransferImage *m_image;
+};
+}
+
 SceneInspector::SceneInspector(ProbeInterface *probe, QObject *parent)
     : SceneInspectorInterface(parent)
     , m_propertyController(new PropertyController(QStringLiteral("com.kdab.GammaRay.SceneInspector"),
                                                   this))
     , m_clientConnected(false)
+    , m_decoratedItem(0)
+    , m_tileRenderPool(new QThreadPool(this))
 {
     Server::instance()->registerMonitorNotifier(Endpoint::instance()->objectAddress(
                                                     objectName()), this, "clientConnectedChanged");
@@ -129,6 +292,7 @@ void SceneInspector::sceneSelected(const QItemSelection &selection)
         disconnect(m_sceneModel->scene(), 0, this, 0);
 
     m_sceneModel->setScene(scene);
+    clearTiles();
     connectToScene();
     // TODO remote support when a different graphics scene was selected
 // ui->graphicsSceneView->setGraphicsScene(scene);
@@ -143,7 +307,7 @@ void SceneInspector::connectToScene()
     connect(scene, SIGNAL(sceneRectChanged(QRectF)),
             this, SIGNAL(sceneRectChanged(QRectF)));
     connect(scene, SIGNAL(changed(QList<QRectF>)),
-            this, SIGNAL(sceneChanged()));
+            this, SLOT(invalidateTiles(QList<QRectF>)), Qt::UniqueConnection);
 
     initializeGui();
 }
@@ -165,9 +329,52 @@ void SceneInspector::initializeGui()
 void SceneInspector::clientConnectedChanged(bool clientConnected)
 {
     m_clientConnected = clientConnected;
+    clearTiles();
     connectToScene();
 }
 
+void SceneInspector::invalidateTiles(const QList<QRectF> &region)
+{
+    if (region.isEmpty()) {
+        clearTiles();
+    } else {
+        foreach (const QRectF &rect, region) {
+            // one extra pixel for antialiasing
+            const QRect range = tileRange(
+                m_tileTransform.mapRect(rect).toAlignedRect().adjusted(-1, -1, 1, 1));
+            for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+                if (range.contains(it.key())) {
+                    m_sentTiles.remove(it.key());
+                    it = m_tiles.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+
+    emit sceneChanged();
+}
+
+void SceneInspector::clearTiles()
+{
+    m_tiles.clear();
+    m_sentTiles.clear();
+    m_tileRange = QRect();
+    m_decoratedItem = 0;
+    m_decorationRect = QRect();
+}
+
+void SceneInspector::resendTiles(const QRect &range)
+{
+    for (auto it = m_sentTiles.begin(); it != m_sentTiles.end();) {
+        if (range.contains(*it))
+            it = m_sentTiles.erase(it);
+        else
+            ++it;
+    }
+}
+
 void SceneInspector::renderScene(const QTransform &transform, const QSize &size)
 {
     if (!Endpoint::isConnected()) {
@@ -179,27 +386,183 @@ void SceneInspector::renderScene(const QTransform &transform, const QSize &size)
     if (!scene)
         return;
 
-    // initialize transparent pixmap
-    QPixmap view(size);
-    view.fill(Qt::transparent);
+    // tiles are rendered at the view transform without its translation, so scrolling
+    // only needs the tiles that became visible
+    const QPoint offset(qRound(transform.dx()), qRound(transform.dy()));
+    const QTransform tileTransform = transform * QTransform::fromTranslate(-offset.x(), -offset.y());
+    if (tileTransform != m_tileTransform) {
+        clearTiles();
+        m_tileTransform = tileTransform;
+    }
+    const QRect range = tileRange(QRect(-offset, size));
 
-    // setup painter and apply transformation of client view
-    QPainter painter(&view);
-    painter.setWorldTransform(transform);
+    // the selection decoration is painted onto the tiles when sending them, resend those
+    // it moved away from or onto
+    QGraphicsItem *currentItem
+        = m_itemSelectionModel->currentIndex().data(SceneModel::SceneItemRole).value<QGraphicsItem *>();
+    const QRect decorationRect
+        = currentItem ? itemDecorationRect(currentItem, m_tileTransform).toAlignedRect() : QRect();
+    if (currentItem != m_decoratedItem || decorationRect != m_decorationRect) {
+        resendTiles(tileRange(m_decorationRect));
+        resendTiles(tileRange(decorationRect));
+        m_decoratedItem = currentItem;
+        m_decorationRect = decorationRect;
+    }
+    const QRect decorationTiles = tileRange(decorationRect);
+
+    QVector<QPoint> missingTiles;
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            if (!m_tiles.contains(QPoint(x, y)))
+                missingTiles.push_back(QPoint(x, y));
+        }
+    }
+    renderTiles(scene, missingTiles);
+
+    SceneTiles update;
+    update.transform = m_tileTransform;
+    update.range = range;
+    for (int y = range.top(); y <= range.bottom(); ++y) {
+        for (int x = range.left(); x <= range.right(); ++x) {
+            const QPoint index(x, y);
+            if (m_sentTiles.contains(index))
+                continue;
+
+            QImage image = m_tiles.value(index);
+            if (currentItem && decorationTiles.contains(index)) {
+                image = image.copy();
+                QPainter painter(&image);
+                painter.setWorldTransform(transformForTile(m_tileTransform, index));
+                paintItemDecoration(currentItem, m_tileTransform, &painter);
+            }
+
+            SceneTile tile;
+            tile.index = index;
+            tile.image.setImage(image);
+            update.tiles.push_back(tile);
+            m_sentTiles.insert(index);
+        }
+    }
+
+    // the client only keeps the visible tiles
+    for (auto it = m_sentTiles.begin(); it != m_sentTiles.end();) {
+        if (range.contains(*it))
+            ++it;
+        else
+            it = m_sentTiles.erase(it);
+    }
+    if (m_tiles.size() > MaxCachedTiles) {
+        for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+            if (range.contains(it.key()))
+                ++it;
+            else
+                it = m_tiles.erase(it);
+        }
+    }
 
-    // the area we want to paint has the size of the client's viewport _after_ applying
-    // the transformation. Thus first apply the inverse to yield the desired area afterwards
-    QRectF area(QPointF(0, 0), size);
-    area = transform.inverted().mapRect(area);
+    if (update.tiles.isEmpty() && range == m_tileRange)
+        return;
+    m_tileRange = range;
 
-    scene->render(&painter, area, area, Qt::IgnoreAspectRatio);
+    if (Endpoint::instance()->imageEncodings() & Protocol::LosslessImageEncoding) {
+        for (int i = 0; i < update.tiles.size(); ++i)
+            m_tileRenderPool->start(new TileEncoder(&update.tiles[i].image));
+        m_tileRenderPool->waitForDone();
+    }
 
-    QGraphicsItem *currentItem
-        = m_itemSelectionModel->currentIndex().data(SceneModel::SceneItemRole).value<QGraphicsItem *>();
-    if (currentItem)
-        paintItemDecoration(currentItem, transform, &painter);
+    emit sceneTilesRendered(update);
+}
+
+void SceneInspector::renderTiles(QGraphicsScene *scene, const QVector<QPoint> &indexes)
+{
+    if (indexes.isEmpty())
+        return;
+
+    QRect range;
+    foreach (const QPoint &index, indexes)
+        range |= QRect(index, QSize(1, 1));
+    const int size = TileSize;
+    const QRectF sceneArea = m_tileTransform.inverted().mapRect(
+        QRectF(range.left() * size, range.top() * size, range.width() * size, range.height() * size));
+
+    // painting the items ourselves in parallel is only possible if all of them allow that, and
+    // if the scene doesn't customize background or foreground painting
+    TileRenderContext context;
+    context.transform = m_tileTransform;
+    context.backgroundBrush = scene->backgroundBrush();
+    context.foregroundBrush = scene->foregroundBrush();
+    QHash<QPoint, QVector<int> > tileItems;
+    bool parallel = indexes.size() > 1 && typeid(*scene) == typeid(QGraphicsScene)
+                    && !isTextureBrush(context.backgroundBrush)
+                    && !isTextureBrush(context.foregroundBrush);
+    if (parallel) {
+        const QList<QGraphicsItem *> items = scene->items(sceneArea, Qt::IntersectsItemBoundingRect,
+                                                          Qt::AscendingOrder);
+        foreach (QGraphicsItem *item, items) {
+            if (!item->isVisible() || (item->flags() & QGraphicsItem::ItemHasNoContents))
+                continue;
+            if (!canPaintInThread(item)) {
+                parallel = false;
+                break;
+            }
+
+            TileItem tileItem;
+            tileItem.item = item;
+            tileItem.opacity = item->effectiveOpacity();
+            if (qFuzzyIsNull(tileItem.opacity))
+                continue;
+            tileItem.transform = item->sceneTransform() * m_tileTransform;
+
+            // also computes the lazily cached bounding rect the item uses while painting
+            const QRectF boundingRect = item->boundingRect();
+            QStyleOptionGraphicsItem &option = tileItem.option;
+            option.state = QStyle::State_None;
+            option.rect = boundingRect.toRect();
+            option.exposedRect = boundingRect;
+            option.palette = scene->palette();
+            if (item->isEnabled())
+                option.state |= QStyle::State_Enabled;
+            if (item->isSelected())
+                option.state |= QStyle::State_Selected;
+            if (item->hasFocus())
+                option.state |= QStyle::State_HasFocus;
+            if (item->isUnderMouse())
+                option.state |= QStyle::State_MouseOver;
+
+            context.items.push_back(tileItem);
+            const QRect itemTiles = range & tileRange(
+                tileItem.transform.mapRect(boundingRect).toAlignedRect().adjusted(-1, -1, 1, 1));
+            for (int y = itemTiles.top(); y <= itemTiles.bottom(); ++y) {
+                for (int x = itemTiles.left(); x <= itemTiles.right(); ++x)
+                    tileItems[QPoint(x, y)].push_back(context.items.size() - 1);
+            }
+        }
+    }
+
+    QVector<QImage> images(indexes.size());
+    if (parallel) {
+        // the GUI thread is blocked meanwhile, so the items can't change under our feet
+        for (int i = 0; i < indexes.size(); ++i)
+            m_tileRenderPool->start(new TileRenderer(&context, indexes.at(i),
+                                                     tileItems.value(indexes.at(i)), &images[i]));
+        m_tileRenderPool->waitForDone();
+    } else {
+        for (int i = 0; i < indexes.size(); ++i) {
+            QImage &image = images[i];
+            image = QImage(size, size, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+
+            QPainter painter(&image);
+            painter.setWorldTransform(transformForTile(m_tileTransform, indexes.at(i)));
+            // the area we want to paint is the tile _after_ applying the transformation,
+            // thus first apply the inverse to yield the desired area afterwards
+            const QRectF area = painter.worldTransform().inverted().mapRect(QRectF(0, 0, size, size));
+            scene->render(&painter, area, area, Qt::IgnoreAspectRatio);
+        }
+    }
 
-    emit sceneRendered(view);
+    for (int i = 0; i < indexes.size(); ++i)
+        m_tiles.insert(indexes.at(i), images.at(i));
 }
 
 void SceneInspector::sceneItemSelected(const QItemSelection &selection)
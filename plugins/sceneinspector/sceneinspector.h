@@ -34,9 +34,11 @@
 #include "sceneinspectorinterface.h"
 
 #include <QGraphicsScene>
+#include <QSet>
 
 QT_BEGIN_NAMESPACE
 class QItemSelectionModel;
+class QThreadPool;
 class QItemSelection;
 class QModelIndex;
 QT_END_NAMESPACE
@@ -64,8 +66,15 @@ private slots:
     void sceneClicked(const QPointF &pos) Q_DECL_OVERRIDE;
 
     void clientConnectedChanged(bool clientConnected);
+    void invalidateTiles(const QList<QRectF> &region);
 
 private:
+    /** Renders the tiles at @p indexes into m_tiles, in parallel if the scene permits that. */
+    void renderTiles(QGraphicsScene *scene, const QVector<QPoint> &indexes);
+    void clearTiles();
+    /** Marks the tiles in @p range as outdated on the client. */
+    void resendTiles(const QRect &range);
+
     QString findBestType(QGraphicsItem *item);
     void registerGraphicsViewMetaTypes();
     void registerVariantHandlers();
@@ -76,6 +85,16 @@ private:
     QItemSelectionModel *m_itemSelectionModel;
     PropertyController *m_propertyController;
     bool m_clientConnected;
+
+    // tile cache of the remote view, see SceneTiles
+    QTransform m_tileTransform;
+    QHash<QPoint, QImage> m_tiles;
+    // tiles the client has in their current state, a subset of m_tiles
+    QSet<QPoint> m_sentTiles;
+    QRect m_tileRange;
+    QGraphicsItem *m_decoratedItem;
+    QRect m_decorationRect;
+    QThreadPool *m_tileRenderPool;
 };
 
 class SceneInspectorFactory : public QObject,
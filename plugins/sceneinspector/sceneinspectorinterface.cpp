@@ -35,9 +35,37 @@
 
 using namespace GammaRay;
 
+namespace GammaRay {
+static QDataStream &operator<<(QDataStream &out, const SceneTile &tile)
+{
+    out << tile.index << tile.image;
+    return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, SceneTile &tile)
+{
+    in >> tile.index >> tile.image;
+    return in;
+}
+
+static QDataStream &operator<<(QDataStream &out, const SceneTiles &tiles)
+{
+    out << tiles.transform << tiles.range << tiles.tiles;
+    return out;
+}
+
+static QDataStream &operator>>(QDataStream &in, SceneTiles &tiles)
+{
+    in >> tiles.transform >> tiles.range >> tiles.tiles;
+    return in;
+}
+}
+
 SceneInspectorInterface::SceneInspectorInterface(QObject *parent)
     : QObject(parent)
 {
+    qRegisterMetaType<SceneTiles>();
+    qRegisterMetaTypeStreamOperators<SceneTiles>();
     ObjectBroker::registerObject<SceneInspectorInterface *>(this);
 }
 
@@ -72,3 +100,19 @@ void SceneInspectorInterface::paintItemDecoration(QGraphicsItem *item, const QTr
                          5.0 / transform.m11(),
                          5.0 / transform.m22());
 }
+
+QRectF SceneInspectorInterface::itemDecorationRect(QGraphicsItem *item, const QTransform &transform)
+{
+    // keep in sync with paintItemDecoration(), the axes cover the item bounding rect
+    const QRectF itemBoundingRect = item->boundingRect();
+    const qreal maxX = qMax(qAbs(itemBoundingRect.left()), qAbs(itemBoundingRect.right()));
+    const qreal maxY = qMax(qAbs(itemBoundingRect.top()), qAbs(itemBoundingRect.bottom()));
+    const qreal maxXY = qMax(maxX, maxY) * 1.5f;
+    const QPolygonF axes = item->mapToScene(QRectF(-maxXY, -maxXY, 2 * maxXY, 2 * maxXY));
+    QRectF rect = transform.map(axes).boundingRect();
+
+    const QPointF transformOrigin = transform.map(item->mapToScene(item->transformOriginPoint()));
+    rect |= QRectF(transformOrigin - QPointF(5, 5), QSizeF(10, 10));
+    // pen width
+    return rect.adjusted(-1, -1, 1, 1);
+}
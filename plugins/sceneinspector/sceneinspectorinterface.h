@@ -29,19 +29,52 @@
 #ifndef GAMMARAY_SCENEINSPECTOR_SCENEINSPECTORINTERFACE_H
 #define GAMMARAY_SCENEINSPECTOR_SCENEINSPECTORINTERFACE_H
 
+#include <common/transferimage.h>
+
+#include <QHash>
 #include <QObject>
+#include <QPoint>
+#include <QRect>
+#include <QTransform>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 class QPainter;
 class QGraphicsItem;
 class QSize;
-class QTransform;
 class QRectF;
-class QPixmap;
 class QPointF;
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+inline uint qHash(const QPoint &point)
+{
+    return qHash(qMakePair(point.x(), point.y()));
+}
+#endif
 QT_END_NAMESPACE
 
 namespace GammaRay {
+/** A tile of the remote scene view. */
+struct SceneTile
+{
+    /** Position in the tile grid, in units of SceneInspectorInterface::TileSize. */
+    QPoint index;
+    TransferImage image;
+};
+
+/** Tiles sent to the client, all rendered at the same transform. */
+struct SceneTiles
+{
+    /** Scene to tile grid transform, ie. the view transform without its translation.
+     *  Tiles rendered at a different transform are obsolete.
+     */
+    QTransform transform;
+    /** Range of tile indexes covering the view, the client drops tiles outside of it. */
+    QRect range;
+    /** Tiles that changed since the last update. */
+    QVector<SceneTile> tiles;
+};
+
 class SceneInspectorInterface : public QObject
 {
     Q_OBJECT
@@ -51,8 +84,13 @@ public:
 
     virtual void initializeGui() = 0;
 
+    /** Edge length of the scene view tiles, in pixels. */
+    enum { TileSize = 256 };
+
     static void paintItemDecoration(QGraphicsItem *item, const QTransform &transform,
                                     QPainter *painter);
+    /** Bounding rect of what paintItemDecoration() paints, in device coordinates of @p transform. */
+    static QRectF itemDecorationRect(QGraphicsItem *item, const QTransform &transform);
 
 public slots:
     virtual void renderScene(const QTransform &transform, const QSize &size) = 0;
@@ -61,12 +99,14 @@ public slots:
 signals:
     void sceneRectChanged(const QRectF &rect);
     void sceneChanged();
-    void sceneRendered(const QPixmap &view);
+    void sceneTilesRendered(const GammaRay::SceneTiles &tiles);
     void itemSelected(const QRectF &boundingRect);
 };
 }
 
+Q_DECLARE_METATYPE(GammaRay::SceneTiles)
 QT_BEGIN_NAMESPACE
+Q_DECLARE_TYPEINFO(GammaRay::SceneTile, Q_MOVABLE_TYPE);
 Q_DECLARE_INTERFACE(GammaRay::SceneInspectorInterface, "com.kdab.GammaRay.SceneInspector")
 QT_END_NAMESPACE
 
@@ -47,6 +47,7 @@
 #include <QMenu>
 #include <QMouseEvent>
 #include <QDebug>
+#include <QPainter>
 #include <QTimer>
 
 #include <iostream>
@@ -97,8 +98,8 @@ SceneInspectorWidget::SceneInspectorWidget(QWidget *parent)
             this, SLOT(sceneRectChanged(QRectF)));
     connect(m_interface, SIGNAL(sceneChanged()),
             this, SLOT(sceneChanged()));
-    connect(m_interface, SIGNAL(sceneRendered(QPixmap)),
-            this, SLOT(sceneRendered(QPixmap)));
+    connect(m_interface, SIGNAL(sceneTilesRendered(GammaRay::SceneTiles)),
+            this, SLOT(sceneTilesRendered(GammaRay::SceneTiles)));
     connect(m_interface, SIGNAL(itemSelected(QRectF)),
             this, SLOT(itemSelected(QRectF)));
 
@@ -185,14 +186,54 @@ void SceneInspectorWidget::requestSceneUpdate()
                              ui->graphicsSceneView->view()->viewport()->rect().size());
 }
 
-void SceneInspectorWidget::sceneRendered(const QPixmap &view)
+void SceneInspectorWidget::sceneTilesRendered(const SceneTiles &tiles)
 {
+    const int size = SceneInspectorInterface::TileSize;
+    const bool fullUpdate = tiles.transform != m_tileTransform || tiles.range != m_tileRange;
+    if (tiles.transform != m_tileTransform) {
+        m_tiles.clear();
+        m_tileTransform = tiles.transform;
+    }
+    m_tileRange = tiles.range;
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        if (m_tileRange.contains(it.key()))
+            ++it;
+        else
+            it = m_tiles.erase(it);
+    }
+    foreach (const SceneTile &tile, tiles.tiles)
+        m_tiles.insert(tile.index, tile.image.image());
+
+    if (m_tileRange.isEmpty()) {
+        m_pixmap->setPixmap(QPixmap());
+        return;
+    }
+
+    // the pixmap ignores the view transformation, the tile grid is in view coordinates already
+    QPixmap view;
+    if (fullUpdate) {
+        view = QPixmap(m_tileRange.size() * size);
+        view.fill(Qt::transparent);
+    } else {
+        view = m_pixmap->pixmap();
+    }
+    QPainter painter(&view);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    if (fullUpdate) {
+        for (auto it = m_tiles.constBegin(); it != m_tiles.constEnd(); ++it)
+            painter.drawImage((it.key() - m_tileRange.topLeft()) * size, it.value());
+    } else {
+        foreach (const SceneTile &tile, tiles.tiles)
+            painter.drawImage((tile.index - m_tileRange.topLeft()) * size, tile.image.image());
+    }
+    painter.end();
+
     m_pixmap->setPixmap(view);
+    m_pixmap->setPos(m_tileTransform.inverted().map(QPointF(m_tileRange.topLeft() * size)));
 }
 
 void SceneInspectorWidget::visibleSceneRectChanged()
 {
-    m_pixmap->setPos(ui->graphicsSceneView->view()->mapToScene(0, 0));
     sceneChanged();
 }
 
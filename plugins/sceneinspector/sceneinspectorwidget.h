@@ -30,8 +30,13 @@
 #ifndef GAMMARAY_SCENEINSPECTOR_SCENEINSPECTORWIDGET_H
 #define GAMMARAY_SCENEINSPECTOR_SCENEINSPECTORWIDGET_H
 
+#include "sceneinspectorinterface.h"
+
 #include <ui/uistatemanager.h>
 #include <ui/tooluifactory.h>
+
+#include <QHash>
+#include <QImage>
 #include <QWidget>
 
 QT_BEGIN_NAMESPACE
@@ -41,8 +46,6 @@ class QItemSelection;
 QT_END_NAMESPACE
 
 namespace GammaRay {
-class SceneInspectorInterface;
-
 namespace Ui {
 class SceneInspectorWidget;
 }
@@ -60,7 +63,7 @@ private slots:
     void sceneRectChanged(const QRectF &rect);
     void sceneChanged();
     void requestSceneUpdate();
-    void sceneRendered(const QPixmap &view);
+    void sceneTilesRendered(const GammaRay::SceneTiles &tiles);
     void visibleSceneRectChanged();
     void itemSelected(const QRectF &boundingRect);
     void sceneContextMenu(QPoint pos);
@@ -74,6 +77,11 @@ private:
     QGraphicsScene *m_scene;
     QGraphicsPixmapItem *m_pixmap;
     QTimer *m_updateTimer;
+
+    // tiles of the remote view, see SceneTiles
+    QTransform m_tileTransform;
+    QRect m_tileRange;
+    QHash<QPoint, QImage> m_tiles;
 };
 
 class SceneInspectorUiFactory : public QObject, public StandardToolUiFactory<SceneInspectorWidget>
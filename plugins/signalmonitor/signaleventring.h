@@ -0,0 +1,132 @@
+/*
+  signaleventring.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_SIGNALEVENTRING_H
+#define GAMMARAY_SIGNALEVENTRING_H
+
+#include <QAtomicInt>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
+
+namespace GammaRay {
+/// A single signal emission, as recorded by the emitting thread.
+struct SignalEvent
+{
+    QObject *sender; // never dereference, might be invalid!
+    int signalIndex;
+    qint64 timestamp;
+};
+
+/// Fixed-size single-producer/single-consumer queue of signal emissions.
+/// There is one of these per emitting thread, the history model is the only consumer.
+/// When the ring is full new events are dropped and counted, the emitting thread never blocks.
+class SignalEventRing
+{
+public:
+    enum { Capacity = 8192 }; // must be a power of two
+
+    SignalEventRing()
+        : m_head(0)
+        , m_tail(0)
+        , m_overruns(0)
+        , m_orphaned(0)
+    {
+    }
+
+    /// Called from the emitting thread only.
+    void push(QObject *sender, int signalIndex, qint64 timestamp)
+    {
+        const int head = loadAcquire(m_head);
+        const int next = (head + 1) & (Capacity - 1);
+        if (next == loadAcquire(m_tail)) {
+            m_overruns.ref();
+            return;
+        }
+        SignalEvent &ev = m_events[head];
+        ev.sender = sender;
+        ev.signalIndex = signalIndex;
+        ev.timestamp = timestamp;
+        storeRelease(m_head, next);
+    }
+
+    /// Called from the consuming thread only, returns the number of events appended to @p events.
+    int drain(QVector<SignalEvent> &events)
+    {
+        const int head = loadAcquire(m_head);
+        int tail = loadAcquire(m_tail);
+        int count = 0;
+        while (tail != head) {
+            events.push_back(m_events[tail]);
+            tail = (tail + 1) & (Capacity - 1);
+            ++count;
+        }
+        storeRelease(m_tail, tail);
+        return count;
+    }
+
+    /// Returns the number of dropped events since the last call.
+    int takeOverruns()
+    {
+        return m_overruns.fetchAndStoreRelaxed(0);
+    }
+
+    /// Marks the ring as no longer being written to, ie. its thread terminated.
+    void setOrphaned() { storeRelease(m_orphaned, 1); }
+    bool isOrphaned() { return loadAcquire(m_orphaned) != 0; }
+
+private:
+    static int loadAcquire(QAtomicInt &value)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        return value.loadAcquire();
+#else
+        return value.fetchAndAddAcquire(0);
+#endif
+    }
+
+    static void storeRelease(QAtomicInt &value, int newValue)
+    {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        value.storeRelease(newValue);
+#else
+        value.fetchAndStoreRelease(newValue);
+#endif
+    }
+
+    SignalEvent m_events[Capacity];
+    QAtomicInt m_head;
+    QAtomicInt m_tail;
+    QAtomicInt m_overruns;
+    QAtomicInt m_orphaned;
+};
+}
+
+#endif // GAMMARAY_SIGNALEVENTRING_H
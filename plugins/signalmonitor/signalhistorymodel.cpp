@@ -28,6 +28,7 @@
 
 #include "signalhistorymodel.h"
 #include "relativeclock.h"
+#include "signaleventring.h"
 #include "signalmonitorcommon.h"
 
 #include <core/probeinterface.h>
@@ -39,7 +40,10 @@
 #include <QLocale>
 #include <QMutex>
 #include <QSet>
+#include <QSharedPointer>
 #include <QThread>
+#include <QThreadStorage>
+#include <QTimer>
 
 using namespace GammaRay;
 
@@ -63,30 +67,102 @@ static T internString(const T &str)
     return str;
 }
 
+namespace {
+typedef QSharedPointer<SignalEventRing> SignalEventRingPtr;
+
+/// Thread-local handle on a ring, flags the ring as orphaned when the thread exits.
+/// The ring is shared with SignalEventRings, as it might still contain undrained events, and
+/// as either side can be destroyed first during application shutdown.
+struct ThreadRingRef
+{
+    explicit ThreadRingRef(const SignalEventRingPtr &r)
+        : ring(r)
+    {
+    }
+
+    ~ThreadRingRef();
+
+    SignalEventRingPtr ring;
+};
+
+struct SignalEventRings
+{
+    QMutex mutex; // protects rings, only needed when adding or removing a ring
+    QVector<SignalEventRingPtr> rings;
+    QThreadStorage<ThreadRingRef *> threadRing;
+};
+}
+
+Q_GLOBAL_STATIC(SignalEventRings, s_signalEventRings)
+
 static SignalHistoryModel *s_historyModel = 0;
 
+/// Call with SignalEventRings::mutex held.
+static void removeRing(SignalEventRings *rings, const SignalEventRingPtr &ring)
+{
+    const int index = rings->rings.indexOf(ring);
+    if (index >= 0)
+        rings->rings.remove(index);
+}
+
+ThreadRingRef::~ThreadRingRef()
+{
+    ring->setOrphaned();
+
+    // without a history model nobody drains and removes the ring anymore,
+    // so drop it right away rather than keeping it until exit
+    if (s_historyModel)
+        return;
+    SignalEventRings *rings = s_signalEventRings();
+    if (!rings) // already destroyed during shutdown
+        return;
+    QMutexLocker lock(&rings->mutex);
+    removeRing(rings, ring);
+}
+
+static SignalEventRing *ringForCurrentThread()
+{
+    SignalEventRings *rings = s_signalEventRings();
+    if (!rings)
+        return 0;
+    if (rings->threadRing.hasLocalData())
+        return rings->threadRing.localData()->ring.data();
+
+    SignalEventRingPtr ring(new SignalEventRing);
+    {
+        QMutexLocker lock(&rings->mutex);
+        rings->rings.push_back(ring);
+    }
+    rings->threadRing.setLocalData(new ThreadRingRef(ring));
+    return ring.data();
+}
+
 static void signal_begin_callback(QObject *caller, int method_index, void **argv)
 {
     Q_UNUSED(argv);
     if (s_historyModel) {
         const int signalIndex = method_index + 1; // offset 1, so unknown signals end up at 0
-        static const QMetaMethod m = s_historyModel->metaObject()->method(
-            s_historyModel->metaObject()->indexOfMethod("onSignalEmitted(QObject*,int)"));
-#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
-        Q_ASSERT(m.isValid());
-#endif
-        m.invoke(s_historyModel, Qt::AutoConnection, Q_ARG(QObject *, caller),
-                 Q_ARG(int, signalIndex));
+        SignalEventRing *ring = ringForCurrentThread();
+        if (ring)
+            ring->push(caller, signalIndex, RelativeClock::sinceAppStart()->mSecs());
     }
 }
 
 SignalHistoryModel::SignalHistoryModel(ProbeInterface *probe, QObject *parent)
     : QAbstractTableModel(parent)
+    , m_drainTimer(new QTimer(this))
+    , m_droppedSignalCount(0)
 {
     connect(probe->probe(), SIGNAL(objectCreated(QObject*)), this, SLOT(onObjectAdded(QObject*)));
     connect(probe->probe(), SIGNAL(objectDestroyed(QObject*)), this,
             SLOT(onObjectRemoved(QObject*)));
 
+    // signal emissions are recorded in per-thread rings, and merged into the model in batches
+    m_drainTimer->setInterval(20);
+    m_drainTimer->setSingleShot(false);
+    connect(m_drainTimer, SIGNAL(timeout()), this, SLOT(drainSignalEvents()));
+    m_drainTimer->start();
+
     SignalSpyCallbackSet spy;
     spy.signalBeginCallback = signal_begin_callback;
     probe->registerSignalSpyCallbackSet(spy);
@@ -97,6 +173,15 @@ SignalHistoryModel::SignalHistoryModel(ProbeInterface *probe, QObject *parent)
 SignalHistoryModel::~SignalHistoryModel()
 {
     s_historyModel = 0;
+
+    // rings of threads that exited already are not drained and removed by anyone else anymore
+    if (SignalEventRings *rings = s_signalEventRings()) {
+        QMutexLocker lock(&rings->mutex);
+        for (int i = rings->rings.size() - 1; i >= 0; --i) {
+            if (rings->rings.at(i)->isOrphaned())
+                rings->rings.remove(i);
+        }
+    }
     qDeleteAll(m_tracedObjects);
 }
 
@@ -168,6 +253,12 @@ QVariant SignalHistoryModel::headerData(int section, Qt::Orientation orientation
         }
     }
 
+    if (role == Qt::ToolTipRole && orientation == Qt::Horizontal && section == EventColumn
+        && m_droppedSignalCount > 0) {
+        return tr("%n signal emission(s) could not be recorded.", 0,
+                  static_cast<int>(m_droppedSignalCount));
+    }
+
     return QVariant();
 }
 
@@ -185,6 +276,8 @@ QMap< int, QVariant > SignalHistoryModel::itemData(const QModelIndex &index) con
 void SignalHistoryModel::onObjectAdded(QObject *object)
 {
     Q_ASSERT(thread() == QThread::currentThread());
+    // flush pending events, in case object reuses the address of a previously destroyed one
+    drainSignalEvents();
 
     // blacklist event dispatchers
     if (qstrncmp(object->metaObject()->className(), "QPAEventDispatcher", 18) == 0
@@ -204,6 +297,8 @@ void SignalHistoryModel::onObjectAdded(QObject *object)
 void SignalHistoryModel::onObjectRemoved(QObject *object)
 {
     Q_ASSERT(thread() == QThread::currentThread());
+    // attribute the last emissions of object before forgetting about it
+    drainSignalEvents();
 
     const auto it = m_itemIndex.find(object);
     if (it == m_itemIndex.end())
@@ -218,14 +313,65 @@ void SignalHistoryModel::onObjectRemoved(QObject *object)
     emit dataChanged(index(itemIndex, EventColumn), index(itemIndex, EventColumn));
 }
 
-void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
+void SignalHistoryModel::drainSignalEvents()
 {
     Q_ASSERT(thread() == QThread::currentThread());
-    const qint64 timestamp = RelativeClock::sinceAppStart()->mSecs();
 
+    SignalEventRings *rings = s_signalEventRings();
+    if (!rings)
+        return;
+
+    // our copies keep the rings alive, so we don't need to hold the lock while draining
+    QVector<SignalEventRingPtr> currentRings;
+    {
+        QMutexLocker lock(&rings->mutex);
+        currentRings = rings->rings;
+    }
+
+    QVector<SignalEvent> events;
+    QVector<SignalEventRingPtr> orphanedRings;
+    int overruns = 0;
+    foreach (const SignalEventRingPtr &ring, currentRings) {
+        // check this before draining, a ring flagged orphaned will not receive any more events
+        if (ring->isOrphaned())
+            orphanedRings.push_back(ring);
+        ring->drain(events);
+        overruns += ring->takeOverruns();
+    }
+
+    if (!orphanedRings.isEmpty()) {
+        QMutexLocker lock(&rings->mutex);
+        foreach (const SignalEventRingPtr &ring, orphanedRings)
+            removeRing(rings, ring);
+    }
+
+    if (overruns > 0) {
+        m_droppedSignalCount += overruns;
+        emit headerDataChanged(Qt::Horizontal, EventColumn, EventColumn);
+    }
+
+    if (events.isEmpty())
+        return;
+
+    int firstRow = m_tracedObjects.size();
+    int lastRow = -1;
+    foreach (const SignalEvent &ev, events) {
+        const int row = appendSignalEvent(ev.sender, ev.signalIndex, ev.timestamp);
+        if (row < 0)
+            continue;
+        firstRow = qMin(firstRow, row);
+        lastRow = qMax(lastRow, row);
+    }
+
+    if (lastRow >= 0)
+        emit dataChanged(index(firstRow, EventColumn), index(lastRow, EventColumn));
+}
+
+int SignalHistoryModel::appendSignalEvent(QObject *sender, int signalIndex, qint64 timestamp)
+{
     const auto it = m_itemIndex.constFind(sender);
     if (it == m_itemIndex.constEnd())
-        return;
+        return -1;
     const int itemIndex = *it;
 
     Item *data = m_tracedObjects.at(itemIndex);
@@ -233,9 +379,9 @@ void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
     // ensure the item is known
     if (signalIndex > 0 && !data->signalNames.contains(signalIndex)) {
         // protect dereferencing of sender here
-        QMutexLocker lock(Probe::objectLock());
+        QMutexLocker lock(Probe::objectLock(sender));
         if (!Probe::instance()->isValidObject(sender))
-            return;
+            return -1;
         const QByteArray signalName = sender->metaObject()->method(signalIndex - 1)
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
                                       .signature();
@@ -246,7 +392,12 @@ void SignalHistoryModel::onSignalEmitted(QObject *sender, int signalIndex)
     }
 
     data->events.push_back((timestamp << 16) | signalIndex);
-    emit dataChanged(index(itemIndex, EventColumn), index(itemIndex, EventColumn));
+    return itemIndex;
+}
+
+qint64 SignalHistoryModel::droppedSignalCount() const
+{
+    return m_droppedSignalCount;
 }
 
 SignalHistoryModel::Item::Item(QObject *obj)
@@ -37,6 +37,10 @@
 #include <QMetaMethod>
 #include <QByteArray>
 
+QT_BEGIN_NAMESPACE
+class QTimer;
+QT_END_NAMESPACE
+
 namespace GammaRay {
 class ProbeInterface;
 
@@ -87,20 +91,26 @@ public:
                         int role = Qt::DisplayRole) const Q_DECL_OVERRIDE;
     QMap<int, QVariant> itemData(const QModelIndex &index) const Q_DECL_OVERRIDE;
 
+    /// Number of signal emissions lost due to the per-thread event buffers overflowing.
+    qint64 droppedSignalCount() const;
+
     static qint64 timestamp(qint64 ev) { return ev >> 16; }
     static int signalIndex(qint64 ev) { return ev & 0xffff; }
 
 private:
     Item *item(const QModelIndex &index) const;
+    int appendSignalEvent(QObject *sender, int signalIndex, qint64 timestamp);
 
 private slots:
     void onObjectAdded(QObject *object);
     void onObjectRemoved(QObject *object);
-    void onSignalEmitted(QObject *sender, int signalIndex);
+    void drainSignalEvents();
 
 private:
     QVector<Item *> m_tracedObjects;
     QHash<QObject *, int> m_itemIndex;
+    QTimer *m_drainTimer;
+    qint64 m_droppedSignalCount;
 };
 } // namespace GammaRay
 
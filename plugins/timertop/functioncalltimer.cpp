@@ -27,38 +27,10 @@
 */
 #include "functioncalltimer.h"
 
-#ifdef Q_OS_WIN
-#include <qt_windows.h>
-#endif
-
-#if defined(Q_OS_MAC) && defined(__MACH__)
-#include <mach/clock.h>
-#include <mach/mach.h>
-#endif
-
 using namespace GammaRay;
 
-#ifndef Q_OS_WIN
-static void portableGetTimeUnix(timespec &t)
-{
-#if defined(Q_OS_MAC)
-    clock_serv_t cclock;
-    mach_timespec_t mts;
-    host_get_clock_service(mach_host_self(), CALENDAR_CLOCK, &cclock);
-    clock_get_time(cclock, &mts);
-    mach_port_deallocate(mach_task_self(), cclock);
-    t.tv_sec = mts.tv_sec;
-    t.tv_nsec = mts.tv_nsec;
-#else
-    clock_gettime(CLOCK_REALTIME, &t);
-#endif
-}
-
-#endif
-
 FunctionCallTimer::FunctionCallTimer()
-    : m_startTime()
-    , m_active(false)
+    : m_active(false)
 {
 }
 
@@ -67,15 +39,7 @@ bool FunctionCallTimer::start()
     if (m_active)
         return false;
 
-#if defined(Q_OS_WIN)
-    LARGE_INTEGER startTime;
-    bool ret = QueryPerformanceCounter(&startTime);
-    if (!ret)
-        return false;
-    m_startTime = startTime.QuadPart;
-#else
-    portableGetTimeUnix(m_startTime);
-#endif
+    m_startTime.start();
     m_active = true;
     return true;
 }
@@ -85,22 +49,9 @@ bool FunctionCallTimer::active() const
     return m_active;
 }
 
-int FunctionCallTimer::stop()
+qint64 FunctionCallTimer::stop()
 {
     Q_ASSERT(m_active);
     m_active = false;
-
-#if defined(Q_OS_WIN)
-    LARGE_INTEGER endTime;
-    LARGE_INTEGER frequency;
-    QueryPerformanceCounter(&endTime);
-    QueryPerformanceFrequency(&frequency);
-    int elapsed = ((endTime.QuadPart - m_startTime) * 1000000) / frequency.QuadPart;
-#else
-    timespec endTime;
-    portableGetTimeUnix(endTime);
-    int elapsed = (endTime.tv_nsec - m_startTime.tv_nsec) / 1000;
-    elapsed += (endTime.tv_sec - m_startTime.tv_sec) * 1000000;
-#endif
-    return elapsed;
+    return m_startTime.nsecsElapsed();
 }
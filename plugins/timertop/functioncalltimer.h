@@ -28,9 +28,7 @@
 #ifndef GAMMARAY_TIMERTOP_FUNCTIONCALLTIMER_H
 #define GAMMARAY_TIMERTOP_FUNCTIONCALLTIMER_H
 
-#include <qglobal.h>
-
-#include <ctime>
+#include <QElapsedTimer>
 
 namespace GammaRay {
 class FunctionCallTimer
@@ -39,14 +37,11 @@ public:
     FunctionCallTimer();
     bool start();
     bool active() const;
-    int stop();
+    /// @return elapsed time since start() in nsecs
+    qint64 stop();
 
 private:
-#ifndef Q_OS_WIN
-    timespec m_startTime;
-#else
-    qint64 m_startTime;
-#endif
+    QElapsedTimer m_startTime;
     bool m_active;
 };
 }
@@ -0,0 +1,142 @@
+/*
+  latencyhistogram.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "latencyhistogram.h"
+
+#include <cstring>
+
+using namespace GammaRay;
+
+static int highestBit(quint64 value)
+{
+    int bit = 0;
+    while (value >>= 1)
+        ++bit;
+    return bit;
+}
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+void LatencyHistogram::record(qint64 value)
+{
+    value = qMax<qint64>(0, value);
+    ++m_counts[bucketForValue(value)];
+    if (m_count == 0 || value < m_min)
+        m_min = value;
+    m_max = qMax(m_max, value);
+    m_sum += value;
+    ++m_count;
+}
+
+void LatencyHistogram::reset()
+{
+    memset(m_counts, 0, sizeof(m_counts));
+    m_count = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+quint64 LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 LatencyHistogram::minimum() const
+{
+    return m_min;
+}
+
+qint64 LatencyHistogram::maximum() const
+{
+    return m_max;
+}
+
+qint64 LatencyHistogram::mean() const
+{
+    if (m_count == 0)
+        return 0;
+    return m_sum / m_count;
+}
+
+qint64 LatencyHistogram::percentile(double percentile) const
+{
+    if (m_count == 0)
+        return -1;
+
+    const quint64 rank = qMax<quint64>(1, qMin<quint64>(m_count, qRound64(percentile / 100.0 * m_count)));
+    if (rank == m_count)
+        return m_max;
+
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += m_counts[i];
+        if (seen < rank)
+            continue;
+        // report the bucket center, the exact extremes are known though
+        const qint64 value = (bucketLowerBound(i) + bucketLowerBound(i + 1) - 1) / 2;
+        return qBound(m_min, value, m_max);
+    }
+
+    Q_ASSERT(false);
+    return m_max;
+}
+
+int LatencyHistogram::bucketCount()
+{
+    return BucketCount;
+}
+
+qint64 LatencyHistogram::bucketLowerBound(int bucket)
+{
+    if (bucket < SubBucketCount)
+        return bucket;
+    const int exponent = bucket / SubBucketCount + SubBucketBits - 1;
+    const qint64 subBucket = bucket % SubBucketCount;
+    return (SubBucketCount + subBucket) << (exponent - SubBucketBits);
+}
+
+int LatencyHistogram::bucketForValue(qint64 value)
+{
+    if (value < SubBucketCount)
+        return qMax<int>(0, value);
+    if (value >= (Q_INT64_C(1) << MaxValueBits))
+        return BucketCount - 1;
+    const int exponent = highestBit(value);
+    const int subBucket = (value >> (exponent - SubBucketBits)) & (SubBucketCount - 1);
+    return SubBucketCount * (exponent - SubBucketBits + 1) + subBucket;
+}
+
+quint32 LatencyHistogram::bucketValueCount(int bucket) const
+{
+    Q_ASSERT(bucket >= 0 && bucket < BucketCount);
+    return m_counts[bucket];
+}
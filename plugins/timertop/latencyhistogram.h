@@ -0,0 +1,83 @@
+/*
+  latencyhistogram.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_TIMERTOP_LATENCYHISTOGRAM_H
+#define GAMMARAY_TIMERTOP_LATENCYHISTOGRAM_H
+
+#include <qglobal.h>
+
+namespace GammaRay {
+/**
+ * Fixed-size log-linear histogram of durations in nanoseconds.
+ *
+ * Each power of two range is split into 16 linear sub-buckets, so the recorded
+ * values are kept with a relative error of at most 1/16, independent of the
+ * number of samples. Values above ~68 seconds are clamped into the last bucket.
+ */
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    /** Adds @p value (in nsecs) to the histogram, negative values are counted as 0. */
+    void record(qint64 value);
+    void reset();
+
+    quint64 count() const;
+    /** Exact minimum, maximum and mean of the recorded values, 0 if empty. */
+    qint64 minimum() const;
+    qint64 maximum() const;
+    qint64 mean() const;
+    /** Value below which @p percentile percent of all recorded values fall,
+     *  -1 if the histogram is empty.
+     */
+    qint64 percentile(double percentile) const;
+
+    static int bucketCount();
+    /** Smallest value falling into bucket @p bucket. */
+    static qint64 bucketLowerBound(int bucket);
+    static int bucketForValue(qint64 value);
+    quint32 bucketValueCount(int bucket) const;
+
+private:
+    enum {
+        SubBucketBits = 4,
+        SubBucketCount = 1 << SubBucketBits,
+        MaxValueBits = 36,
+        BucketCount = SubBucketCount * (MaxValueBits - SubBucketBits + 1)
+    };
+
+    quint32 m_counts[BucketCount];
+    quint64 m_count;
+    quint64 m_sum;
+    qint64 m_min;
+    qint64 m_max;
+};
+}
+
+#endif // GAMMARAY_TIMERTOP_LATENCYHISTOGRAM_H
@@ -31,31 +31,71 @@
 
 #include <core/util.h>
 
+#include <QAbstractEventDispatcher>
+#include <QElapsedTimer>
 #include <QObject>
+#include <QThread>
+
+#include <cstring>
 
 using namespace GammaRay;
 
-static const int maxTimeoutEvents = 1000;
-static const int maxTimeSpan = 10000;
+static const qint64 nsecsPerSec = Q_INT64_C(1000000000);
+
+namespace {
+struct MonotonicClock
+{
+    MonotonicClock()
+    {
+        timer.start();
+    }
+
+    QElapsedTimer timer;
+};
+}
+
+Q_GLOBAL_STATIC(MonotonicClock, s_clock)
+
+static QString formatUSecs(qint64 nsecs)
+{
+    return QString::number(nsecs / 1000.0, 'f', 1);
+}
 
 TimerInfo::TimerInfo(QObject *timer)
     : m_type(QQmlTimerType)
     , m_totalWakeups(0)
     , m_timer(timer)
     , m_timerId(-1)
+    , m_firstWakeup(-1)
+    , m_lastWakeup(-1)
+    , m_windowSecond(0)
     , m_lastReceiver(0)
+    , m_interval(-1)
 {
     if (QTimer *t = qobject_cast<QTimer *>(timer)) {
         m_type = QTimerType;
         m_timerId = t->timerId();
     }
+    memset(m_windowWakeups, 0, sizeof(m_windowWakeups));
+    memset(m_windowExecutionTime, 0, sizeof(m_windowExecutionTime));
 }
 
 TimerInfo::TimerInfo(int timerId)
     : m_type(QObjectType)
     , m_totalWakeups(0)
     , m_timerId(timerId)
+    , m_firstWakeup(-1)
+    , m_lastWakeup(-1)
+    , m_windowSecond(0)
+    , m_interval(-1)
 {
+    memset(m_windowWakeups, 0, sizeof(m_windowWakeups));
+    memset(m_windowExecutionTime, 0, sizeof(m_windowExecutionTime));
+}
+
+qint64 TimerInfo::currentTime()
+{
+    return s_clock()->timer.nsecsElapsed();
 }
 
 TimerInfo::Type TimerInfo::type() const
@@ -65,14 +105,43 @@ TimerInfo::Type TimerInfo::type() const
 
 void TimerInfo::addEvent(const TimeoutEvent &timeoutEvent)
 {
-    m_timeoutEvents.append(timeoutEvent);
-    removeOldEvents();
+    const qint64 wakeup = timeoutEvent.executionTime >= 0
+                          ? timeoutEvent.timeStamp - timeoutEvent.executionTime
+                          : timeoutEvent.timeStamp;
+
+    if (timeoutEvent.executionTime >= 0)
+        m_executionTimes.record(timeoutEvent.executionTime);
+
+    const int interval = repeatInterval();
+    if (m_lastWakeup >= 0 && interval >= 0)
+        m_wakeupLateness.record(wakeup - m_lastWakeup - interval * Q_INT64_C(1000000));
+    if (m_firstWakeup < 0)
+        m_firstWakeup = wakeup;
+    m_lastWakeup = wakeup;
+
+    const qint64 second = wakeup / nsecsPerSec;
+    advanceWindow(second);
+    ++m_windowWakeups[second % WakeupWindow];
+    if (timeoutEvent.executionTime >= 0)
+        m_windowExecutionTime[second % WakeupWindow] += timeoutEvent.executionTime;
+
     m_totalWakeups++;
 }
 
+void TimerInfo::advanceWindow(qint64 second)
+{
+    if (second <= m_windowSecond)
+        return;
+    for (qint64 s = qMax(m_windowSecond + 1, second - WakeupWindow + 1); s <= second; ++s) {
+        m_windowWakeups[s % WakeupWindow] = 0;
+        m_windowExecutionTime[s % WakeupWindow] = 0;
+    }
+    m_windowSecond = second;
+}
+
 int TimerInfo::numEvents() const
 {
-    return m_timeoutEvents.size();
+    return m_totalWakeups;
 }
 
 QObject *TimerInfo::timerObject() const
@@ -99,23 +168,21 @@ FunctionCallTimer *TimerInfo::functionCallTimer()
 
 QString TimerInfo::wakeupsPerSec() const
 {
-    int totalWakeups = 0;
-    int start = 0;
-    int end = m_timeoutEvents.size() - 1;
-    for (int i = end; i >= 0; i--) {
-        const TimeoutEvent &event = m_timeoutEvents.at(i);
-        if (event.timeStamp.msecsTo(QTime::currentTime()) > maxTimeSpan) {
-            start = i;
-            break;
-        }
-        totalWakeups++;
+    if (m_firstWakeup < 0)
+        return QStringLiteral("0");
+
+    // only look at the part of the window that has not expired yet
+    const qint64 now = currentTime();
+    const qint64 currentSecond = now / nsecsPerSec;
+    quint32 totalWakeups = 0;
+    for (qint64 s = qMax(m_windowSecond, currentSecond) - WakeupWindow + 1; s <= m_windowSecond; ++s) {
+        if (s >= 0)
+            totalWakeups += m_windowWakeups[s % WakeupWindow];
     }
 
-    if (totalWakeups > 0 && end > start) {
-        const QTime startTime = m_timeoutEvents[start].timeStamp;
-        const QTime endTime = m_timeoutEvents[end].timeStamp;
-        const int timeSpan = startTime.msecsTo(endTime);
-        const float wakeupsPerSec = totalWakeups / (float)timeSpan * 1000.0f;
+    if (totalWakeups > 0) {
+        const qint64 timeSpan = qBound<qint64>(1, now - m_firstWakeup, WakeupWindow * nsecsPerSec);
+        const float wakeupsPerSec = totalWakeups / (float)timeSpan * nsecsPerSec;
         return QString::number(wakeupsPerSec, 'f', 1);
     }
     return QStringLiteral("0");
@@ -126,18 +193,18 @@ QString TimerInfo::timePerWakeup() const
     if (m_type == QObjectType)
         return QStringLiteral("N/A");
 
-    int totalWakeups = 0;
-    int totalTime = 0;
-    for (int i = m_timeoutEvents.size() - 1; i >= 0; i--) {
-        const TimeoutEvent &event = m_timeoutEvents.at(i);
-        if (event.timeStamp.msecsTo(QTime::currentTime()) > maxTimeSpan)
-            break;
-        totalWakeups++;
-        totalTime += event.executionTime;
+    const qint64 currentSecond = currentTime() / nsecsPerSec;
+    quint32 totalWakeups = 0;
+    qint64 totalTime = 0;
+    for (qint64 s = qMax(m_windowSecond, currentSecond) - WakeupWindow + 1; s <= m_windowSecond; ++s) {
+        if (s < 0)
+            continue;
+        totalWakeups += m_windowWakeups[s % WakeupWindow];
+        totalTime += m_windowExecutionTime[s % WakeupWindow];
     }
 
     if (totalWakeups > 0)
-        return QString::number(totalTime / (float)totalWakeups, 'f', 1);
+        return formatUSecs(totalTime / totalWakeups);
     return QStringLiteral("N/A");
 }
 
@@ -145,14 +212,31 @@ QString TimerInfo::maxWakeupTime() const
 {
     if (m_type == QObjectType)
         return QStringLiteral("N/A");
+    return QString::number(m_executionTimes.maximum() / 1000);
+}
 
-    int max = 0;
-    for (int i = 0; i < m_timeoutEvents.size(); i++) {
-        const TimeoutEvent &event = m_timeoutEvents.at(i);
-        if (event.executionTime > max)
-            max = event.executionTime;
-    }
-    return QString::number(max);
+QString TimerInfo::executionTimePercentile(double percentile) const
+{
+    if (m_type == QObjectType || m_executionTimes.count() == 0)
+        return QStringLiteral("N/A");
+    return formatUSecs(m_executionTimes.percentile(percentile));
+}
+
+QString TimerInfo::latenessPercentile(double percentile) const
+{
+    if (m_wakeupLateness.count() == 0)
+        return QStringLiteral("N/A");
+    return formatUSecs(m_wakeupLateness.percentile(percentile));
+}
+
+const LatencyHistogram &TimerInfo::executionTimes() const
+{
+    return m_executionTimes;
+}
+
+const LatencyHistogram &TimerInfo::wakeupLateness() const
+{
+    return m_wakeupLateness;
 }
 
 int TimerInfo::totalWakeups() const
@@ -194,15 +278,50 @@ QString TimerInfo::state() const
     return QString();
 }
 
-void TimerInfo::removeOldEvents()
+int TimerInfo::repeatInterval() const
 {
-    if (m_timeoutEvents.size() > maxTimeoutEvents)
-        m_timeoutEvents.removeFirst();
+    switch (m_type) {
+    case QTimerType:
+    {
+        const QTimer *t = timer();
+        if (!t || t->isSingleShot())
+            return -1;
+        return t->interval();
+    }
+    case QQmlTimerType:
+    {
+        const QObject *obj = timerObject();
+        if (!obj || !obj->property("repeat").toBool())
+            return -1;
+        return obj->property("interval").toInt();
+    }
+    case QObjectType:
+        return m_interval;
+    }
+
+    Q_ASSERT(false);
+    return -1;
 }
 
 void TimerInfo::setLastReceiver(QObject *receiver)
 {
     m_lastReceiver = receiver;
+
+    // free timers always repeat, the interval is only known to the event dispatcher though
+    if (m_type != QObjectType || m_interval >= 0 || !receiver)
+        return;
+    QAbstractEventDispatcher *dispatcher = QAbstractEventDispatcher::instance(receiver->thread());
+    if (!dispatcher)
+        return;
+    foreach (const QAbstractEventDispatcher::TimerInfo &info, dispatcher->registeredTimers(receiver)) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        if (info.timerId == m_timerId)
+            m_interval = info.interval;
+#else
+        if (info.first == m_timerId)
+            m_interval = info.second;
+#endif
+    }
 }
 
 QString TimerInfo::displayName() const
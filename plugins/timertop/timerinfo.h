@@ -29,11 +29,11 @@
 #define GAMMARAY_TIMERTOP_TIMERINFO_H
 
 #include "functioncalltimer.h"
+#include "latencyhistogram.h"
 
 #include <QSharedPointer>
 #include <QPointer>
 #include <QTimer>
-#include <QTime>
 #include <QMetaType>
 
 namespace GammaRay {
@@ -48,10 +48,20 @@ public:
 
     struct TimeoutEvent
     {
-        QTime timeStamp;
-        int executionTime;
+        TimeoutEvent()
+            : timeStamp(0)
+            , executionTime(-1)
+        {}
+
+        /// nsecs on the clock of currentTime(), taken after the timeout has been handled
+        qint64 timeStamp;
+        /// nsecs, -1 if unknown
+        qint64 executionTime;
     };
 
+    /// Current time in nsecs on a monotonic clock
+    static qint64 currentTime();
+
     explicit TimerInfo(QObject *timer);
     explicit TimerInfo(int timerId);
     Type type() const;
@@ -65,6 +75,13 @@ public:
     QString wakeupsPerSec() const;
     QString timePerWakeup() const;
     QString maxWakeupTime() const;
+    QString executionTimePercentile(double percentile) const;
+    QString latenessPercentile(double percentile) const;
+    /// Distribution of the time spent handling a timeout
+    const LatencyHistogram &executionTimes() const;
+    /// Distribution of the delay between the expected and the actual wakeup time,
+    /// only recorded for repeating timers
+    const LatencyHistogram &wakeupLateness() const;
     int totalWakeups() const;
     QString state() const;
     QString displayName() const;
@@ -78,12 +95,25 @@ private:
 
     int m_timerId;
     FunctionCallTimer m_functionCallTimer;
-    QList<TimeoutEvent> m_timeoutEvents;
+    LatencyHistogram m_executionTimes;
+    LatencyHistogram m_wakeupLateness;
+    qint64 m_firstWakeup;
+    qint64 m_lastWakeup;
+
+    // wakeups and execution time per second, for the last WakeupWindow seconds
+    enum { WakeupWindow = 10 };
+    quint32 m_windowWakeups[WakeupWindow];
+    qint64 m_windowExecutionTime[WakeupWindow];
+    qint64 m_windowSecond;
 
     // Only for free timers, QObject that received the timeout event
     QPointer<QObject> m_lastReceiver;
+    // Only for free timers, as reported by the event dispatcher
+    int m_interval;
 
-    void removeOldEvents();
+    /// interval in msecs if this is a repeating timer, -1 otherwise
+    int repeatInterval() const;
+    void advanceWindow(qint64 second);
 };
 
 typedef QSharedPointer<TimerInfo> TimerInfoPtr;
@@ -205,8 +205,8 @@ void TimerModel::postSignalActivate(QObject *caller, int methodIndex)
     }
 
     TimerInfo::TimeoutEvent event;
-    event.timeStamp = QTime::currentTime();
     event.executionTime = timerInfo->functionCallTimer()->stop();
+    event.timeStamp = TimerInfo::currentTime();
     timerInfo->addEvent(event);
     const int row = rowFor(timerInfo->timerObject());
     emitTimerObjectChanged(row);
@@ -272,6 +272,18 @@ QVariant TimerModel::data(const QModelIndex &index, int role) const
             return timerInfo->timePerWakeup();
         case MaxTimePerWakeupColumn:
             return timerInfo->maxWakeupTime();
+        case TimePerWakeupP50Column:
+            return timerInfo->executionTimePercentile(50);
+        case TimePerWakeupP95Column:
+            return timerInfo->executionTimePercentile(95);
+        case TimePerWakeupP99Column:
+            return timerInfo->executionTimePercentile(99);
+        case LatenessP50Column:
+            return timerInfo->latenessPercentile(50);
+        case LatenessP95Column:
+            return timerInfo->latenessPercentile(95);
+        case LatenessP99Column:
+            return timerInfo->latenessPercentile(99);
         case TimerIdColumn:
             return timerInfo->timerId();
         case ColumnCount:
@@ -284,9 +296,28 @@ QVariant TimerModel::data(const QModelIndex &index, int role) const
         return QVariant::fromValue(ObjectId(timerInfo->timerObject()));
     }
 
+    if ((role == ExecutionTimeHistogramRole || role == LatenessHistogramRole) && index.column() == 0) {
+        const TimerInfoPtr timerInfo = const_cast<TimerModel*>(this)->findOrCreateTimerInfo(index);
+        if (role == ExecutionTimeHistogramRole)
+            return histogramData(timerInfo->executionTimes());
+        return histogramData(timerInfo->wakeupLateness());
+    }
+
     return QVariant();
 }
 
+QVariant TimerModel::histogramData(const LatencyHistogram &histogram)
+{
+    QVariantList buckets;
+    for (int i = 0; i < LatencyHistogram::bucketCount(); ++i) {
+        const quint32 count = histogram.bucketValueCount(i);
+        if (count == 0)
+            continue;
+        buckets.push_back(QVariantList() << LatencyHistogram::bucketLowerBound(i) << count);
+    }
+    return buckets;
+}
+
 QVariant TimerModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
     if (orientation == Qt::Horizontal && role == Qt::DisplayRole) {
@@ -303,6 +334,18 @@ QVariant TimerModel::headerData(int section, Qt::Orientation orientation, int ro
             return tr("Time/Wakeup [uSecs]");
         case MaxTimePerWakeupColumn:
             return tr("Max Wakeup Time [uSecs]");
+        case TimePerWakeupP50Column:
+            return tr("Time/Wakeup p50 [uSecs]");
+        case TimePerWakeupP95Column:
+            return tr("Time/Wakeup p95 [uSecs]");
+        case TimePerWakeupP99Column:
+            return tr("Time/Wakeup p99 [uSecs]");
+        case LatenessP50Column:
+            return tr("Lateness p50 [uSecs]");
+        case LatenessP95Column:
+            return tr("Lateness p95 [uSecs]");
+        case LatenessP99Column:
+            return tr("Lateness p99 [uSecs]");
         case TimerIdColumn:
             return tr("Timer ID");
         case ColumnCount:
@@ -331,12 +374,11 @@ bool TimerModel::eventFilter(QObject *watched, QEvent *event)
             return false;
 
         const TimerInfoPtr timerInfo = findOrCreateFreeTimerInfo(timerEvent->timerId());
+        timerInfo->setLastReceiver(watched);
         TimerInfo::TimeoutEvent timeoutEvent;
-        timeoutEvent.timeStamp = QTime::currentTime();
-        timeoutEvent.executionTime = -1;
+        timeoutEvent.timeStamp = TimerInfo::currentTime();
         timerInfo->addEvent(timeoutEvent);
 
-        timerInfo->setLastReceiver(watched);
         emitFreeTimerChanged(m_freeTimers.indexOf(timerInfo));
     }
     return false;
@@ -63,12 +63,23 @@ public:
         WakeupsPerSecColumn,
         TimePerWakeupColumn,
         MaxTimePerWakeupColumn,
+        TimePerWakeupP50Column,
+        TimePerWakeupP95Column,
+        TimePerWakeupP99Column,
+        LatenessP50Column,
+        LatenessP95Column,
+        LatenessP99Column,
         TimerIdColumn,
         ColumnCount
     };
 
     enum Roles {
-        ObjectIdRole = UserRole + 1
+        ObjectIdRole = UserRole + 1,
+        /// Histogram of the time per wakeup, as list of (lower bucket bound in nsecs, count) pairs.
+        /// Only available on the first column.
+        ExecutionTimeHistogramRole = OnDemandUserRole,
+        /// Histogram of the wakeup lateness, same format as ExecutionTimeHistogramRole.
+        LatenessHistogramRole
     };
 
     void setSourceModel(QAbstractItemModel *sourceModel);
@@ -110,6 +121,7 @@ private:
     // Finds QObject timers
     TimerInfoPtr findOrCreateFreeTimerInfo(int timerId);
 
+    static QVariant histogramData(const LatencyHistogram &histogram);
     int rowFor(QObject *timer);
     void emitTimerObjectChanged(int row);
     void emitFreeTimerChanged(int row);
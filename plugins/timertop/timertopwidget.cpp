@@ -50,11 +50,8 @@ TimerTopWidget::TimerTopWidget(QWidget *parent)
 
     ui->timerView->header()->setObjectName("timerViewHeader");
     ui->timerView->setDeferredResizeMode(0, QHeaderView::Stretch);
-    ui->timerView->setDeferredResizeMode(1, QHeaderView::ResizeToContents);
-    ui->timerView->setDeferredResizeMode(2, QHeaderView::ResizeToContents);
-    ui->timerView->setDeferredResizeMode(3, QHeaderView::ResizeToContents);
-    ui->timerView->setDeferredResizeMode(4, QHeaderView::ResizeToContents);
-    ui->timerView->setDeferredResizeMode(5, QHeaderView::ResizeToContents);
+    for (int i = 1; i < TimerModel::ColumnCount; ++i)
+        ui->timerView->setDeferredResizeMode(i, QHeaderView::ResizeToContents);
     connect(ui->timerView, SIGNAL(customContextMenuRequested(QPoint)), this, SLOT(contextMenu(QPoint)));
 
     QSortFilterProxyModel * const sortModel = new QSortFilterProxyModel(this);
@@ -27,18 +27,47 @@
 */
 
 #include "benchsuite.h"
+#include "objectvectormodel.h"
 #include "core/probe.h"
 #include "core/util.h"
 
 #include <QtTestGui>
 
 #include <QLabel>
+#include <QThread>
+#include <QTimer>
 #include <QTreeView>
 
 QTEST_MAIN(GammaRay::BenchSuite)
 
 using namespace GammaRay;
 
+namespace {
+/** Creates and destroys short-lived objects, the way a worker thread would. */
+class ChurnThread : public QThread
+{
+public:
+    explicit ChurnThread(int count)
+        : m_count(count)
+    {
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_count; ++i) {
+            QObject *obj = new QObject;
+            Probe::objectAdded(obj, true);
+            Probe::objectRemoved(obj);
+            delete obj;
+        }
+    }
+
+private:
+    int m_count;
+};
+}
+
 void BenchSuite::iconForObject()
 {
     QWidget widget;
@@ -52,6 +81,39 @@ void BenchSuite::iconForObject()
     }
 }
 
+void BenchSuite::objectModelData()
+{
+    static const int NUM_OBJECTS = 100000;
+    QVector<QObject *> objects;
+    objects.reserve(NUM_OBJECTS);
+    for (int i = 0; i < NUM_OBJECTS; ++i) {
+        switch (i % 3) {
+        case 0:
+            objects << new QObject;
+            break;
+        case 1:
+            objects << new QTimer;
+            break;
+        case 2:
+            objects << new QThread;
+            break;
+        }
+    }
+
+    ObjectVectorModel model(objects);
+    QBENCHMARK {
+        for (int row = 0; row < model.rowCount(); ++row) {
+            for (int column = 0; column < model.columnCount(); ++column) {
+                const QModelIndex index = model.index(row, column);
+                model.data(index, Qt::DisplayRole);
+                model.data(index, Qt::DecorationRole);
+            }
+        }
+    }
+
+    qDeleteAll(objects);
+}
+
 void BenchSuite::probe_objectAdded()
 {
     Probe::createProbe(false);
@@ -77,3 +139,54 @@ void BenchSuite::probe_objectAdded()
     qDeleteAll(objects);
     delete Probe::instance();
 }
+
+void BenchSuite::probe_objectAddedChurn()
+{
+    Probe::createProbe(false);
+
+    static const int NUM_OBJECTS = 10000;
+    QVector<QObject *> objects;
+    objects.reserve(NUM_OBJECTS);
+    for (int i = 0; i < NUM_OBJECTS; ++i)
+        objects << new QObject;
+
+    QBENCHMARK_ONCE {
+        // all creations remain queued, removing them in reverse order used to hit
+        // the worst case of the linear queue search
+        foreach (QObject *obj, objects)
+            Probe::objectAdded(obj, true);
+        for (int i = objects.size() - 1; i >= 0; --i)
+            Probe::objectRemoved(objects.at(i));
+    }
+
+    qDeleteAll(objects);
+    delete Probe::instance();
+}
+
+void BenchSuite::probe_objectAddedChurnThreaded_data()
+{
+    QTest::addColumn<int>("threadCount");
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("4 threads") << 4;
+}
+
+void BenchSuite::probe_objectAddedChurnThreaded()
+{
+    QFETCH(int, threadCount);
+    Probe::createProbe(false);
+
+    static const int NUM_OBJECTS = 40000;
+    QVector<ChurnThread *> threads;
+    for (int i = 0; i < threadCount; ++i)
+        threads.push_back(new ChurnThread(NUM_OBJECTS / threadCount));
+
+    QBENCHMARK_ONCE {
+        foreach (ChurnThread *thread, threads)
+            thread->start();
+        foreach (ChurnThread *thread, threads)
+            thread->wait();
+    }
+
+    qDeleteAll(threads);
+    delete Probe::instance();
+}
@@ -38,7 +38,11 @@ class BenchSuite : public QObject
 
 private slots:
     void iconForObject();
+    void objectModelData();
     void probe_objectAdded();
+    void probe_objectAddedChurn();
+    void probe_objectAddedChurnThreaded_data();
+    void probe_objectAddedChurnThreaded();
 };
 }
 
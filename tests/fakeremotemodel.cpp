@@ -0,0 +1,98 @@
+/*
+  fakeremotemodel.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "fakeremotemodel.h"
+
+#include <QBuffer>
+
+using namespace GammaRay;
+
+static void fakeRegisterServer() {}
+
+FakeRemoteModelServer::FakeRemoteModelServer(const QString &objectName, QObject *parent)
+    : RemoteModelServer(objectName, parent)
+    , messageCount(0)
+    , byteCount(0)
+{
+    m_myAddress = 42;
+    // the basic tests expect changes to arrive synchronously
+    setFlushInterval(0);
+}
+
+void FakeRemoteModelServer::setup()
+{
+    FakeRemoteModelServer::s_registerServerCallback = &fakeRegisterServer;
+}
+
+void FakeRemoteModelServer::resetStatistics()
+{
+    messageCount = 0;
+    byteCount = 0;
+    messageTypeCount.clear();
+}
+
+bool FakeRemoteModelServer::isConnected() const
+{
+    return true;
+}
+
+void FakeRemoteModelServer::sendMessage(const Message &msg) const
+{
+    QByteArray ba;
+    QBuffer buffer(&ba);
+    buffer.open(QIODevice::ReadWrite);
+    msg.write(&buffer);
+    ++messageCount;
+    byteCount += ba.size();
+    ++messageTypeCount[msg.type()];
+    buffer.seek(0);
+    emit const_cast<FakeRemoteModelServer *>(this)->message(Message::readMessage(&buffer));
+}
+
+FakeRemoteModel::FakeRemoteModel(const QString &serverObject, QObject *parent)
+    : RemoteModel(serverObject, parent)
+    , byteCount(0)
+{
+    m_myAddress = 42;
+}
+
+void FakeRemoteModel::setup()
+{
+    FakeRemoteModel::s_registerClientCallback = &fakeRegisterServer;
+}
+
+void FakeRemoteModel::sendMessage(const Message &msg) const
+{
+    QByteArray ba;
+    QBuffer buffer(&ba);
+    buffer.open(QIODevice::ReadWrite);
+    msg.write(&buffer);
+    byteCount += ba.size();
+    buffer.seek(0);
+    emit const_cast<FakeRemoteModel *>(this)->message(Message::readMessage(&buffer));
+}
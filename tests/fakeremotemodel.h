@@ -0,0 +1,91 @@
+/*
+  fakeremotemodel.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_FAKEREMOTEMODEL_H
+#define GAMMARAY_FAKEREMOTEMODEL_H
+
+#include <core/remote/remotemodelserver.h>
+#include <client/remotemodel.h>
+#include <common/message.h>
+
+#include <QHash>
+
+namespace GammaRay {
+/** Remote model server sending its messages via the message() signal rather than the endpoint.
+ *  Counts the sent messages and their size.
+ */
+class FakeRemoteModelServer : public RemoteModelServer
+{
+    Q_OBJECT
+public:
+    explicit FakeRemoteModelServer(const QString &objectName, QObject *parent = 0);
+
+    /// call once before creating any instance
+    static void setup();
+
+    void resetStatistics();
+    int handleCount() const { return m_handles.size(); }
+
+    mutable int messageCount;
+    mutable qint64 byteCount;
+    mutable QHash<int, int> messageTypeCount;
+
+signals:
+    void message(const GammaRay::Message &msg);
+
+private:
+    bool isConnected() const Q_DECL_OVERRIDE;
+    void sendMessage(const Message &msg) const Q_DECL_OVERRIDE;
+};
+
+/** Remote model sending its requests via the message() signal rather than the endpoint. */
+class FakeRemoteModel : public RemoteModel
+{
+    Q_OBJECT
+public:
+    explicit FakeRemoteModel(const QString &serverObject, QObject *parent = 0);
+
+    /// call once before creating any instance
+    static void setup();
+
+    qint64 cacheSize() const { return m_cacheSize; }
+    qint64 nodeMemoryUsage() const { return m_nodePool.memoryUsage(); }
+    int handleCount() const { return m_handles.size(); }
+    int iconCount() const { return m_icons.size(); }
+
+    mutable qint64 byteCount;
+
+signals:
+    void message(const GammaRay::Message &msg);
+
+private:
+    void sendMessage(const Message &msg) const Q_DECL_OVERRIDE;
+};
+}
+
+#endif // GAMMARAY_FAKEREMOTEMODEL_H
@@ -0,0 +1,251 @@
+/*
+  messagemodeltest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <core/tools/messagehandler/messagemodel.h>
+
+#include <3rdparty/qt/modeltest.h>
+
+#include <QtTest/qtest.h>
+#include <QtTest/qsignalspy.h>
+#include <QObject>
+#include <QThread>
+
+using namespace GammaRay;
+
+static DebugMessage createMessage(const QString &text)
+{
+    DebugMessage msg;
+    msg.type = QtDebugMsg;
+    msg.message = text;
+    msg.time = QTime::currentTime();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+    msg.line = 0;
+#endif
+    return msg;
+}
+
+class MessageProducer : public QThread
+{
+public:
+    MessageProducer(MessageModel *model, int id, int count)
+        : m_model(model)
+        , m_id(id)
+        , m_count(count)
+    {
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_count; ++i)
+            m_model->addMessage(createMessage(QString::number(m_id) + QLatin1Char(':') + QString::number(i)));
+    }
+
+private:
+    MessageModel *m_model;
+    int m_id;
+    int m_count;
+};
+
+class MessageModelTest : public QObject
+{
+    Q_OBJECT
+private:
+    static void addMessages(MessageModel *model, int from, int to)
+    {
+        for (int i = from; i <= to; ++i)
+            model->addMessage(createMessage(QString::number(i)));
+        QTest::qWait(1); // event loop re-entry, inserts the batch
+    }
+
+    static QStringList messages(MessageModel *model)
+    {
+        QStringList result;
+        for (int i = 0; i < model->rowCount(); ++i)
+            result.push_back(model->index(i, MessageModelColumn::Message).data().toString());
+        return result;
+    }
+
+    static QStringList range(int from, int to)
+    {
+        QStringList result;
+        for (int i = from; i <= to; ++i)
+            result.push_back(QString::number(i));
+        return result;
+    }
+
+    static void verifySignal(QSignalSpy &spy, int first, int last)
+    {
+        QCOMPARE(spy.size(), 1);
+        QCOMPARE(spy.at(0).at(1).toInt(), first);
+        QCOMPARE(spy.at(0).at(2).toInt(), last);
+        spy.clear();
+    }
+
+private slots:
+    void testBatchOrdering()
+    {
+        MessageModel model;
+        ModelTest modelTest(&model);
+        QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QVERIFY(insertSpy.isValid());
+
+        model.addMessage(createMessage(QStringLiteral("0")));
+        model.addMessage(createMessage(QStringLiteral("1")));
+        model.addMessage(createMessage(QStringLiteral("2")));
+        QCOMPARE(model.rowCount(), 0); // inserted asynchronously
+        QTest::qWait(1);
+        verifySignal(insertSpy, 0, 2);
+        QCOMPARE(messages(&model), range(0, 2));
+
+        addMessages(&model, 3, 4);
+        verifySignal(insertSpy, 3, 4);
+        QCOMPARE(messages(&model), range(0, 4));
+    }
+
+    void testEviction()
+    {
+        MessageModel model;
+        model.setCapacity(5);
+        ModelTest modelTest(&model);
+        QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QVERIFY(insertSpy.isValid());
+        QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QVERIFY(removeSpy.isValid());
+
+        addMessages(&model, 0, 4);
+        verifySignal(insertSpy, 0, 4);
+        QCOMPARE(removeSpy.size(), 0);
+
+        // wraps around in the ring buffer
+        addMessages(&model, 5, 6);
+        verifySignal(removeSpy, 0, 1);
+        verifySignal(insertSpy, 3, 4);
+        QCOMPARE(messages(&model), range(2, 6));
+
+        addMessages(&model, 7, 10);
+        verifySignal(removeSpy, 0, 3);
+        verifySignal(insertSpy, 1, 4);
+        QCOMPARE(messages(&model), range(6, 10));
+
+        // batches larger than the capacity only keep their newest messages
+        addMessages(&model, 11, 30);
+        verifySignal(removeSpy, 0, 4);
+        verifySignal(insertSpy, 0, 4);
+        QCOMPARE(messages(&model), range(26, 30));
+    }
+
+    void testCapacityChange()
+    {
+        MessageModel model;
+        model.setCapacity(5);
+        ModelTest modelTest(&model);
+        QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+        QVERIFY(insertSpy.isValid());
+        QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+        QVERIFY(removeSpy.isValid());
+
+        addMessages(&model, 0, 4);
+        addMessages(&model, 5, 6); // ring no longer starts at the beginning of the storage
+        insertSpy.clear();
+        removeSpy.clear();
+
+        model.setCapacity(3);
+        QCOMPARE(model.capacity(), 3);
+        verifySignal(removeSpy, 0, 1);
+        QCOMPARE(insertSpy.size(), 0);
+        QCOMPARE(messages(&model), range(4, 6));
+
+        model.setCapacity(6);
+        QCOMPARE(model.capacity(), 6);
+        QCOMPARE(removeSpy.size(), 0);
+        QCOMPARE(messages(&model), range(4, 6));
+
+        addMessages(&model, 7, 9);
+        QCOMPARE(removeSpy.size(), 0);
+        verifySignal(insertSpy, 3, 5);
+        QCOMPARE(messages(&model), range(4, 9));
+
+        addMessages(&model, 10, 10);
+        verifySignal(removeSpy, 0, 0);
+        verifySignal(insertSpy, 5, 5);
+        QCOMPARE(messages(&model), range(5, 10));
+
+        model.setCapacity(0);
+        QCOMPARE(model.capacity(), 1);
+        QCOMPARE(messages(&model), range(10, 10));
+    }
+
+    void testHistorySizeSetting()
+    {
+        qputenv("GAMMARAY_MessageHistorySize", "4");
+        MessageModel model;
+        qputenv("GAMMARAY_MessageHistorySize", "");
+        QCOMPARE(model.capacity(), 4);
+
+        addMessages(&model, 0, 9);
+        QCOMPARE(messages(&model), range(6, 9));
+    }
+
+    void testBackgroundThreads()
+    {
+        const int threadCount = 4;
+        const int messageCount = 1000;
+
+        MessageModel model;
+        model.setCapacity(threadCount * messageCount);
+        ModelTest modelTest(&model);
+
+        QVector<MessageProducer *> producers;
+        for (int i = 0; i < threadCount; ++i)
+            producers.push_back(new MessageProducer(&model, i, messageCount));
+        foreach (MessageProducer *producer, producers)
+            producer->start();
+        foreach (MessageProducer *producer, producers)
+            QVERIFY(producer->wait(30000));
+        qDeleteAll(producers);
+        QTest::qWait(1);
+
+        QCOMPARE(model.rowCount(), threadCount * messageCount);
+        // messages of each thread arrive in the order they were sent
+        QVector<int> next(threadCount, 0);
+        foreach (const QString &msg, messages(&model)) {
+            const QStringList parts = msg.split(QLatin1Char(':'));
+            QCOMPARE(parts.size(), 2);
+            const int thread = parts.at(0).toInt();
+            QCOMPARE(parts.at(1).toInt(), next[thread]);
+            ++next[thread];
+        }
+        for (int i = 0; i < threadCount; ++i)
+            QCOMPARE(next.at(i), messageCount);
+    }
+};
+
+QTEST_MAIN(MessageModelTest)
+
+#include "messagemodeltest.moc"
@@ -0,0 +1,190 @@
+/*
+  messagetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <common/message.h>
+#include <common/messagecompressor.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+
+using namespace GammaRay;
+
+class MessageTest : public QObject
+{
+    Q_OBJECT
+private:
+    static QByteArray payload(int i)
+    {
+        // similar to what a remote model content reply looks like
+        return QByteArray("com.kdab.GammaRay.ObjectInspector.PropertyModel row ")
+               + QByteArray::number(i) + " QString value " + QByteArray::number(i % 7);
+    }
+
+    /** Parses all messages framed in @p buffer, returns their payloads. */
+    static QList<QByteArray> readAll(const QByteArray &buffer, MessageDecompressor *decompressor)
+    {
+        QList<QByteArray> payloads;
+        int offset = 0;
+        while (const int size = Message::frameSize(buffer.constData() + offset, buffer.size() - offset)) {
+            const Message msg = Message::readMessage(buffer.constData() + offset, decompressor);
+            offset += size;
+            if (msg.address() != 42 || msg.type() != Protocol::ModelContentReply)
+                return QList<QByteArray>();
+            QByteArray data;
+            msg >> data;
+            payloads.push_back(data);
+        }
+        return payloads;
+    }
+
+private slots:
+    void testFraming()
+    {
+        QByteArray buffer;
+        for (int i = 0; i < 10; ++i) {
+            Message msg(42, Protocol::ModelContentReply);
+            msg << payload(i);
+            msg.write(buffer);
+            QCOMPARE(msg.transferSize(), msg.size());
+        }
+
+        // incomplete frames are not parsed
+        QCOMPARE(Message::frameSize(buffer.constData(), 3), 0);
+        const int firstSize = Message::frameSize(buffer.constData(), buffer.size());
+        QVERIFY(firstSize > 0);
+        QCOMPARE(Message::frameSize(buffer.constData(), firstSize - 1), 0);
+
+        const auto payloads = readAll(buffer, 0);
+        QCOMPARE(payloads.size(), 10);
+        for (int i = 0; i < 10; ++i)
+            QCOMPARE(payloads.at(i), payload(i));
+    }
+
+    void testDetached()
+    {
+        QByteArray buffer;
+        Message msg(42, Protocol::ModelContentReply);
+        msg << payload(1);
+        msg.write(buffer);
+
+        const Message inPlace = Message::readMessage(buffer.constData());
+        const Message detached = inPlace.detached();
+        QCOMPARE(detached.address(), Protocol::ObjectAddress(42));
+        QCOMPARE(detached.type(), Protocol::MessageType(Protocol::ModelContentReply));
+        QCOMPARE(detached.transferSize(), inPlace.transferSize());
+
+        // the receive buffer gets reused
+        buffer.fill('x');
+        QByteArray data;
+        detached >> data;
+        QCOMPARE(data, payload(1));
+    }
+
+    void testStreamCompression()
+    {
+        MessageCompressor compressor;
+        compressor.setAdaptive(false);
+        MessageDecompressor decompressor;
+
+        // enough small messages to wrap around the ring buffer several times,
+        // with a few large ones interleaved that are compressed independently
+        QByteArray buffer;
+        QList<QByteArray> expected;
+        qint64 size = 0;
+        qint64 transferSize = 0;
+        for (int i = 0; i < 20000; ++i) {
+            const QByteArray data = i % 5000 == 0 ? QByteArray(200000, char(i)) : payload(i);
+            Message msg(42, Protocol::ModelContentReply);
+            msg << data;
+            msg.write(buffer, &compressor);
+            size += msg.size();
+            transferSize += msg.transferSize();
+            expected.push_back(data);
+        }
+        QVERIFY(transferSize < size / 2);
+
+        QCOMPARE(readAll(buffer, &decompressor), expected);
+    }
+
+    void testIncompressibleData()
+    {
+        MessageCompressor compressor;
+        compressor.setAdaptive(false);
+        MessageDecompressor decompressor;
+
+        // random data doesn't get smaller, interleaved with data that does, so the
+        // uncompressed parts still have to end up in the stream dictionary
+        qsrand(42);
+        QByteArray buffer;
+        QList<QByteArray> expected;
+        for (int i = 0; i < 2000; ++i) {
+            QByteArray data;
+            if (i % 3 == 0) {
+                data.resize(i % 500 == 0 ? 100000 : 100 + i % 1000);
+                for (int j = 0; j < data.size(); ++j)
+                    data[j] = char(qrand());
+            } else {
+                data = payload(i);
+            }
+            Message msg(42, Protocol::ModelContentReply);
+            msg << data;
+            msg.write(buffer, &compressor);
+            if (i % 3 == 0)
+                QVERIFY(msg.transferSize() <= msg.size() + 5);
+            expected.push_back(data);
+        }
+
+        QCOMPARE(readAll(buffer, &decompressor), expected);
+    }
+
+    void testAdaptiveCompression()
+    {
+        const QByteArray data = payload(0).repeated(20);
+
+        // very fast link, compression only costs time
+        MessageCompressor fast;
+        fast.addLinkSample(1024 * 1024 * 1024, 1000);
+        QVERIFY(!fast.isEnabled());
+        QByteArray out;
+        QVERIFY(!fast.compress(data.constData(), data.size(), out));
+        QVERIFY(out.isEmpty());
+
+        // slow link, compress everything above the threshold
+        MessageCompressor slow;
+        slow.addLinkSample(1024, 1000000000);
+        QVERIFY(slow.isEnabled());
+        QVERIFY(slow.compress(data.constData(), data.size(), out));
+        QVERIFY(!out.isEmpty());
+        QVERIFY(!slow.compress("x", 1, out));
+        QVERIFY(slow.threshold() > 1);
+    }
+};
+
+QTEST_MAIN(MessageTest)
+
+#include "messagetest.moc"
@@ -109,6 +109,41 @@ private slots:
         t.start();
         QVERIFY(spy.wait(30000));
     }
+
+    void benchmarkChurn_data()
+    {
+        QTest::addColumn<int>("threadCount");
+
+        QTest::newRow("1 thread") << 1;
+        QTest::newRow("4 threads") << 4;
+        QTest::newRow("16 threads") << 16;
+    }
+
+    void benchmarkChurn()
+    {
+        QFETCH(int, threadCount);
+
+        createProbe();
+
+        // same total amount of objects for every row, so the times are comparable
+        static const int NUM_OBJECTS = 160000;
+        QVector<Thread *> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            Thread *t = new Thread;
+            t->batchSize = 100;
+            t->iterations = NUM_OBJECTS / (t->batchSize * threadCount);
+            threads.push_back(t);
+        }
+
+        QBENCHMARK_ONCE {
+            foreach (Thread *t, threads)
+                t->start();
+            foreach (Thread *t, threads)
+                QVERIFY(t->wait(60000));
+        }
+
+        qDeleteAll(threads);
+    }
 };
 
 QTEST_MAIN(MultiThreadingTest)
@@ -0,0 +1,77 @@
+/*
+  objectvectormodel.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_OBJECTVECTORMODEL_H
+#define GAMMARAY_OBJECTVECTORMODEL_H
+
+#include <common/objectmodel.h>
+#include <core/objectmodelbase.h>
+
+#include <QAbstractTableModel>
+#include <QVector>
+
+namespace GammaRay {
+/** Flat object model over a fixed set of objects. */
+class ObjectVectorModel : public ObjectModelBase<QAbstractTableModel>
+{
+public:
+    explicit ObjectVectorModel(const QVector<QObject *> &objects)
+        : ObjectModelBase<QAbstractTableModel>(0)
+        , fullItemData(false)
+        , m_objects(objects)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE
+    {
+        return parent.isValid() ? 0 : m_objects.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE
+    {
+        return dataForObject(m_objects.at(index.row()), index, role);
+    }
+
+    QMap<int, QVariant> itemData(const QModelIndex &index) const Q_DECL_OVERRIDE
+    {
+        if (!fullItemData)
+            return ObjectModelBase<QAbstractTableModel>::itemData(index);
+        // all roles, as before on demand roles were introduced
+        QMap<int, QVariant> map = QAbstractTableModel::itemData(index);
+        map.insert(ObjectModel::ObjectIdRole, data(index, ObjectModel::ObjectIdRole));
+        return map;
+    }
+
+    bool fullItemData;
+
+private:
+    QVector<QObject *> m_objects;
+};
+}
+
+#endif // GAMMARAY_OBJECTVECTORMODEL_H
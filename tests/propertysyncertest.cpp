@@ -131,22 +131,87 @@ private slots:
         QCOMPARE(m_server2ClientCount, 1);
         QCOMPARE(clientObj->intProp(), 14);
 
-        // regular sync on changes on one side
+        // regular sync on changes on one side, sent after the current event loop iteration
         serverObj.setIntProp(42);
+        QCOMPARE(m_server2ClientCount, 1);
+        QTest::qWait(1);
         QCOMPARE(m_server2ClientCount, 2);
         QCOMPARE(clientObj->intProp(), 42);
 
         QCOMPARE(m_client2ServerCount, 1);
         clientObj->setIntProp(23);
+        QTest::qWait(1);
         QCOMPARE(serverObj.intProp(), 23);
         QCOMPARE(m_client2ServerCount, 2);
         QCOMPARE(m_server2ClientCount, 2);
 
+        // changes within one event loop iteration are coalesced
+        serverObj.setIntProp(1);
+        serverObj.setIntProp(2);
+        serverObj.setIntProp(3);
+        QTest::qWait(1);
+        QCOMPARE(m_server2ClientCount, 3);
+        QCOMPARE(clientObj->intProp(), 3);
+        QCOMPARE(m_client2ServerCount, 2);
+
         // client destroyed
         m_server->setObjectEnabled(42, false);
         delete clientObj;
         serverObj.setIntProp(26);
-        QCOMPARE(m_server2ClientCount, 2);
+        QTest::qWait(1);
+        QCOMPARE(m_server2ClientCount, 3);
+    }
+
+    void testFlush()
+    {
+        MyObject serverObj;
+        m_client = 0;
+        m_server = new PropertySyncer(this);
+        connect(m_server, SIGNAL(message(GammaRay::Message)), this,
+                SLOT(server2client(GammaRay::Message)));
+        m_server->setAddress(1);
+        m_server->setBatchInterval(50);
+        m_server->addObject(42, &serverObj);
+        m_server->setObjectEnabled(42, true);
+
+        // flushing sends pending changes right away, and only once
+        m_server2ClientCount = 0;
+        m_server->flushPropertyChanges();
+        QCOMPARE(m_server2ClientCount, 0);
+        serverObj.setIntProp(1);
+        QCOMPARE(m_server2ClientCount, 0);
+        m_server->flushPropertyChanges();
+        QCOMPARE(m_server2ClientCount, 1);
+        QTest::qWait(100);
+        QCOMPARE(m_server2ClientCount, 1);
+
+        delete m_server;
+        m_server = 0;
+    }
+
+    void testBatchInterval()
+    {
+        MyObject serverObj;
+        m_client = 0;
+        m_server = new PropertySyncer(this);
+        connect(m_server, SIGNAL(message(GammaRay::Message)), this,
+                SLOT(server2client(GammaRay::Message)));
+        m_server->setAddress(1);
+        m_server->setBatchInterval(50);
+        QCOMPARE(m_server->batchInterval(), 50);
+        m_server->addObject(42, &serverObj);
+        m_server->setObjectEnabled(42, true);
+
+        m_server2ClientCount = 0;
+        serverObj.setIntProp(1);
+        QTest::qWait(1);
+        serverObj.setIntProp(2);
+        QCOMPARE(m_server2ClientCount, 0);
+        QTest::qWait(100);
+        QCOMPARE(m_server2ClientCount, 1);
+
+        delete m_server;
+        m_server = 0;
     }
 
 private:
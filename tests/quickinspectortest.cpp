@@ -35,19 +35,26 @@
 #include <common/objectbroker.h>
 #include <common/remoteviewinterface.h>
 #include <common/remoteviewframe.h>
+#include <common/objectmodel.h>
 
 #include <3rdparty/qt/modeltest.h>
 
 #include <QtTest/qtest.h>
 
+#include <QQmlComponent>
+#include <QQuickItem>
 #include <QQuickView>
 #include <QItemSelectionModel>
 #include <QRegExp>
+#include <QSGNode>
 #include <QSignalSpy>
 
+#include <algorithm>
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 5, 0)
 Q_DECLARE_METATYPE(QItemSelection)
 #endif
+Q_DECLARE_METATYPE(QSGNode *)
 
 using namespace GammaRay;
 
@@ -105,6 +112,42 @@ private:
         return !exposed || waitForSignal(&renderSpy);
     }
 
+    // waits for the next frame, and the scene graph model picking up the changes of that frame
+    bool waitForSceneGraphUpdate()
+    {
+        QSignalSpy renderSpy(view, SIGNAL(frameSwapped()));
+        Q_ASSERT(renderSpy.isValid());
+        view->update();
+        const bool rendered = waitForSignal(&renderSpy);
+        QTest::qWait(1); // the model updates via a queued invocation
+        return rendered;
+    }
+
+    // compare the scene graph model content to the actual scene graph
+    bool verifySceneGraph(const QModelIndex &parent)
+    {
+        QSGNode *node = parent.data(ObjectModel::ObjectRole).value<QSGNode *>();
+        if (!node)
+            return false;
+
+        QVector<QSGNode *> modelChildren;
+        for (int row = 0; row < sgModel->rowCount(parent); ++row)
+            modelChildren.push_back(sgModel->index(row, 0, parent).data(ObjectModel::ObjectRole).value<QSGNode *>());
+        QVector<QSGNode *> children;
+        for (QSGNode *child = node->firstChild(); child; child = child->nextSibling())
+            children.push_back(child);
+        std::sort(modelChildren.begin(), modelChildren.end());
+        std::sort(children.begin(), children.end());
+        if (children != modelChildren)
+            return false;
+
+        for (int row = 0; row < sgModel->rowCount(parent); ++row) {
+            if (!verifySceneGraph(sgModel->index(row, 0, parent)))
+                return false;
+        }
+        return true;
+    }
+
 private slots:
     void initTestCase()
     {
@@ -190,6 +233,52 @@ private slots:
         QTest::qWait(20);
     }
 
+    void testSceneGraphModelUpdates()
+    {
+        QVERIFY(showSource(QStringLiteral("qrc:/manual/reparenttest.qml")));
+        if (!exposed)
+            return;
+        QVERIFY(sgModel->rowCount() > 0);
+        const QModelIndex rootIndex = sgModel->index(0, 0);
+        QVERIFY(verifySceneGraph(rootIndex));
+
+        auto root = view->rootObject();
+        QVERIFY(root);
+        const auto containers = root->childItems();
+        QCOMPARE(containers.size(), 2);
+
+        // insert
+        QQmlComponent component(view->engine());
+        component.setData("import QtQuick 2.0\n"
+                          "Rectangle { width: 10; height: 10; color: \"black\"\n"
+                          "  Rectangle { width: 4; height: 4; color: \"white\" } }\n", QUrl());
+        auto item = qobject_cast<QQuickItem *>(component.create());
+        QVERIFY(item);
+        item->setParentItem(root);
+        QVERIFY(waitForSceneGraphUpdate());
+        QVERIFY(verifySceneGraph(rootIndex));
+
+        // move
+        item->setPosition(QPointF(50, 10));
+        QVERIFY(waitForSceneGraphUpdate());
+        QVERIFY(verifySceneGraph(rootIndex));
+
+        // reparent, from QML and from C++
+        QTest::keyClick(view, Qt::Key_Right);
+        item->setParentItem(containers.at(0));
+        QVERIFY(waitForSceneGraphUpdate());
+        QVERIFY(verifySceneGraph(rootIndex));
+        QTest::keyClick(view, Qt::Key_Left);
+        item->setParentItem(containers.at(1));
+        QVERIFY(waitForSceneGraphUpdate());
+        QVERIFY(verifySceneGraph(rootIndex));
+
+        // remove
+        delete item;
+        QVERIFY(waitForSceneGraphUpdate());
+        QVERIFY(verifySceneGraph(rootIndex));
+    }
+
     void testItemPicking()
     {
         QVERIFY(showSource(QStringLiteral("qrc:/manual/reparenttest.qml")));
@@ -248,6 +337,7 @@ private slots:
         QImage img = frame.image();
 
         QVERIFY(!img.isNull());
+        QVERIFY(frame.captureTime() >= 0);
         QCOMPARE(img.width(), static_cast<int>(view->width() *view->devicePixelRatio()));
         QCOMPARE(img.height(), static_cast<int>(view->height() *view->devicePixelRatio()));
 #ifndef Q_OS_WIN // this is too unstable on the CI, rendered results seem to differ in color!?
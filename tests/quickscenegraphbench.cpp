@@ -0,0 +1,211 @@
+/*
+  quickscenegraphbench.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <plugins/quickinspector/quickscenegraphmodel.h>
+
+#include <QtTest/qtest.h>
+
+#include <QElapsedTimer>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickView>
+#include <QSGNode>
+
+#include <algorithm>
+
+using namespace GammaRay;
+
+// two rectangles per delegate, with two nodes each
+static const int ItemCount = 15000;
+static const int MinNodeCount = 50000;
+static const int FrameCount = 50;
+// items changed per frame
+static const int ChangeCount = 10;
+
+// positions are stored in the model, so inserting or removing an element
+// doesn't move the delegates after it
+static const char SceneQml[] =
+    "import QtQuick 2.0\n"
+    "Item {\n"
+    "  width: 1000; height: 1000\n"
+    "  function insertItems(row, count) {\n"
+    "    for (var i = 0; i < count; ++i)\n"
+    "      elements.insert(row + i, { \"pos\": row + i })\n"
+    "  }\n"
+    "  function removeItems(row, count) { elements.remove(row, count) }\n"
+    "  ListModel { id: elements }\n"
+    "  Repeater {\n"
+    "    model: elements\n"
+    "    Rectangle {\n"
+    "      x: (model.pos % 100) * 10; y: (Math.floor(model.pos / 100) * 10) % 1000\n"
+    "      width: 8; height: 8\n"
+    "      color: model.pos % 2 ? \"red\" : \"blue\"\n"
+    "      Rectangle { x: 2; y: 2; width: 4; height: 4; color: \"white\" }\n"
+    "    }\n"
+    "  }\n"
+    "}\n";
+
+/** Measures the per-frame update cost of the QtQuick scene graph model in a large scene. */
+class QuickSceneGraphBench : public QObject
+{
+    Q_OBJECT
+private:
+    int nodeCount(const QModelIndex &parent = QModelIndex()) const
+    {
+        int count = 0;
+        for (int row = 0; row < m_model->rowCount(parent); ++row)
+            count += 1 + nodeCount(m_model->index(row, 0, parent));
+        return count;
+    }
+
+    // compare the model content to the actual scene graph
+    bool verifyTree(const QModelIndex &parent) const
+    {
+        QVector<QSGNode *> modelChildren;
+        for (int row = 0; row < m_model->rowCount(parent); ++row)
+            modelChildren.push_back(static_cast<QSGNode *>(m_model->index(row, 0, parent).internalPointer()));
+
+        QSGNode *node = static_cast<QSGNode *>(parent.internalPointer());
+        QVector<QSGNode *> children;
+        for (QSGNode *child = node->firstChild(); child; child = child->nextSibling())
+            children.push_back(child);
+        std::sort(children.begin(), children.end());
+        if (children != modelChildren)
+            return false;
+
+        for (int row = 0; row < m_model->rowCount(parent); ++row) {
+            if (!verifyTree(m_model->index(row, 0, parent)))
+                return false;
+        }
+        return true;
+    }
+
+    void insertItems(int row, int count)
+    {
+        QMetaObject::invokeMethod(m_root, "insertItems", Q_ARG(QVariant, row), Q_ARG(QVariant, count));
+    }
+
+    void removeItems(int row, int count)
+    {
+        QMetaObject::invokeMethod(m_root, "removeItems", Q_ARG(QVariant, row), Q_ARG(QVariant, count));
+    }
+
+    // renders a frame, and returns the time the model spent processing it, in msecs
+    double renderFrame()
+    {
+        m_view->grabWindow();
+        QElapsedTimer timer;
+        timer.start();
+        // the model updates in response to the render thread, via a queued invocation
+        QCoreApplication::sendPostedEvents(m_model, QEvent::MetaCall);
+        return timer.nsecsElapsed() / 1000000.0;
+    }
+
+private slots:
+    void initTestCase()
+    {
+        m_view = new QQuickView;
+        m_view->resize(1000, 1000);
+        QQmlComponent component(m_view->engine());
+        component.setData(SceneQml, QUrl());
+        m_root = qobject_cast<QQuickItem *>(component.create());
+        QVERIFY(m_root);
+        m_root->setParentItem(m_view->contentItem());
+        insertItems(0, ItemCount);
+
+        m_view->show();
+        QVERIFY(QTest::qWaitForWindowExposed(m_view));
+        m_view->grabWindow();
+
+        m_model = new QuickSceneGraphModel(m_view);
+        m_model->setWindow(m_view);
+        QVERIFY(nodeCount() >= MinNodeCount);
+    }
+
+    void cleanupTestCase()
+    {
+        delete m_view;
+    }
+
+    void updatePerFrame_data()
+    {
+        QTest::addColumn<QString>("change");
+        QTest::newRow("unchanged") << QString();
+        QTest::newRow("move") << QStringLiteral("move");
+        QTest::newRow("insertRemove") << QStringLiteral("insertRemove");
+        QTest::newRow("fullRebuild") << QStringLiteral("fullRebuild");
+    }
+
+    void updatePerFrame()
+    {
+        QFETCH(QString, change);
+
+        const QList<QQuickItem *> items = m_root->childItems();
+        double total = 0.0;
+        for (int frame = 0; frame < FrameCount; ++frame) {
+            if (change == QLatin1String("move")) {
+                for (int i = 0; i < ChangeCount; ++i) {
+                    QQuickItem *item = items.at((frame * ChangeCount + i) * 97 % (items.size() - 1));
+                    item->setX(item->x() + (frame % 2 ? -1 : 1));
+                }
+            } else if (change == QLatin1String("insertRemove")) {
+                // only creates or destroys the affected delegates
+                if (frame % 2)
+                    removeItems(ItemCount / 2, ChangeCount);
+                else
+                    insertItems(ItemCount / 2, ChangeCount);
+            }
+
+            if (change == QLatin1String("fullRebuild")) {
+                QElapsedTimer timer;
+                timer.start();
+                m_model->setWindow(m_view);
+                total += timer.nsecsElapsed() / 1000000.0;
+            } else {
+                total += renderFrame();
+            }
+        }
+        if (FrameCount % 2) {
+            removeItems(ItemCount / 2, ChangeCount);
+            renderFrame();
+        }
+
+        QTest::setBenchmarkResult(total / FrameCount, QTest::WalltimeMilliseconds);
+        QVERIFY(verifyTree(m_model->index(0, 0, QModelIndex())));
+    }
+
+private:
+    QQuickView *m_view;
+    QQuickItem *m_root;
+    QuickSceneGraphModel *m_model;
+};
+
+QTEST_MAIN(QuickSceneGraphBench)
+
+#include "quickscenegraphbench.moc"
@@ -0,0 +1,256 @@
+/*
+  remotebenchsuite.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "remotebenchsuite.h"
+#include "fakeremotemodel.h"
+#include "objectvectormodel.h"
+#include "transporthelper.h"
+
+#include <QtTest/qtest.h>
+
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+#include <QStandardItemModel>
+
+QTEST_MAIN(GammaRay::RemoteBenchSuite)
+
+using namespace GammaRay;
+
+namespace {
+/** Flat model with a large number of rows, without any storage of its own. */
+class LargeFlatModel : public QAbstractListModel
+{
+public:
+    explicit LargeFlatModel(int rows, QObject *parent = 0)
+        : QAbstractListModel(parent)
+        , m_rows(rows)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE
+    {
+        return parent.isValid() ? 0 : m_rows;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE
+    {
+        if (role == Qt::DisplayRole)
+            return QString::number(index.row());
+        return QVariant();
+    }
+
+private:
+    int m_rows;
+};
+}
+
+void RemoteBenchSuite::remoteModel_churn_data()
+{
+    QTest::addColumn<int>("flushInterval");
+    QTest::addColumn<bool>("countMessages");
+    QTest::newRow("immediate bytes/s") << 0 << false;
+    QTest::newRow("immediate messages/s") << 0 << true;
+    QTest::newRow("coalesced bytes/s") << 16 << false;
+    QTest::newRow("coalesced messages/s") << 16 << true;
+}
+
+void RemoteBenchSuite::remoteModel_churn()
+{
+    QFETCH(int, flushInterval);
+    QFETCH(bool, countMessages);
+    FakeRemoteModelServer::setup();
+    FakeRemoteModel::setup();
+
+    // a table updating all its cells and some rows at 60Hz
+    QStandardItemModel churnModel(100, 5);
+    FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.ChurnModel"));
+    server.setModel(&churnModel);
+    server.modelMonitored(true);
+
+    FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.ChurnModel"));
+    connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+            SLOT(newMessage(GammaRay::Message)));
+    connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+            SLOT(newRequest(GammaRay::Message)));
+    client.rowCount(); // triggers the initial row count request
+    QTest::qWait(10);
+    QCOMPARE(client.rowCount(), 100);
+
+    server.setFlushInterval(flushInterval);
+    server.resetStatistics();
+
+    // paced by the update rate, so what matters is the traffic rather than the time
+    QElapsedTimer timer;
+    timer.start();
+    for (int frame = 0; frame < 60; ++frame) {
+        for (int row = 0; row < churnModel.rowCount(); ++row) {
+            for (int col = 0; col < churnModel.columnCount(); ++col)
+                churnModel.setData(churnModel.index(row, col), frame);
+        }
+        churnModel.appendRow(new QStandardItem(QString::number(frame)));
+        churnModel.removeRow(0);
+        QTest::qWait(16);
+    }
+    server.setFlushInterval(0);
+    const qint64 elapsed = qMax<qint64>(timer.elapsed(), 1);
+    QCOMPARE(client.rowCount(), churnModel.rowCount());
+
+    // one result per test function run, hence the separate rows
+    if (countMessages)
+        QTest::setBenchmarkResult(server.messageCount * 1000.0 / elapsed, QTest::Events);
+    else
+        QTest::setBenchmarkResult(server.byteCount * 1000.0 / elapsed, QTest::BytesPerSecond);
+}
+
+void RemoteBenchSuite::remoteModel_largeFlatModel_data()
+{
+    QTest::addColumn<bool>("scroll");
+    QTest::newRow("build") << false;
+    QTest::newRow("scroll") << true;
+}
+
+void RemoteBenchSuite::remoteModel_largeFlatModel()
+{
+    QFETCH(bool, scroll);
+    FakeRemoteModelServer::setup();
+    FakeRemoteModel::setup();
+
+    static const int rows = 1000000;
+    LargeFlatModel flatModel(rows);
+    FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.LargeModel"));
+    server.setModel(&flatModel);
+    server.modelMonitored(true);
+
+    FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.LargeModel"));
+    connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+            SLOT(newMessage(GammaRay::Message)));
+    connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+            SLOT(newRequest(GammaRay::Message)));
+
+    if (!scroll) {
+        QBENCHMARK_ONCE {
+            client.rowCount(); // synchronous with the fake server, builds all row nodes
+        }
+        QCOMPARE(client.rowCount(), rows);
+        return;
+    }
+
+    client.rowCount();
+    QCOMPARE(client.rowCount(), rows);
+    QBENCHMARK_ONCE {
+        // scroll through the first 100k rows a page at a time, like a view would
+        for (int row = 0; row < rows / 10; row += 50) {
+            for (int i = row; i < row + 50; ++i)
+                client.index(i, 0).data();
+            QCoreApplication::processEvents();
+            for (int i = row; i < row + 50; ++i)
+                client.index(i, 0).data();
+        }
+    }
+    QCOMPARE(client.index(12345, 0).data().toString(), QStringLiteral("12345"));
+}
+
+void RemoteBenchSuite::remoteModel_objectModelScrolling_data()
+{
+    QTest::addColumn<bool>("fullItemData");
+    QTest::newRow("on demand roles") << false;
+    QTest::newRow("all roles") << true;
+}
+
+void RemoteBenchSuite::remoteModel_objectModelScrolling()
+{
+    QFETCH(bool, fullItemData);
+    FakeRemoteModelServer::setup();
+    FakeRemoteModel::setup();
+
+    static const int rows = 20000;
+    QObject root;
+    QVector<QObject *> objects;
+    objects.reserve(rows);
+    for (int i = 0; i < rows; ++i) {
+        auto obj = new QObject(&root);
+        obj->setObjectName(QStringLiteral("object%1").arg(i));
+        objects.push_back(obj);
+    }
+    ObjectVectorModel objectsModel(objects);
+    objectsModel.fullItemData = fullItemData;
+
+    FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.ObjectsModel"));
+    server.setModel(&objectsModel);
+    server.modelMonitored(true);
+
+    FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.ObjectsModel"));
+    connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+            SLOT(newMessage(GammaRay::Message)));
+    connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+            SLOT(newRequest(GammaRay::Message)));
+    client.rowCount();
+    QCOMPARE(client.rowCount(), rows);
+
+    QBENCHMARK_ONCE {
+        // scroll through all rows a page at a time, like a view would, hovering one cell per page
+        for (int row = 0; row < rows; row += 50) {
+            for (int i = row; i < row + 50; ++i) {
+                client.index(i, 0).data();
+                client.index(i, 1).data();
+            }
+            QCoreApplication::processEvents();
+            client.index(row, 0).data(Qt::ToolTipRole);
+            QCoreApplication::processEvents();
+        }
+    }
+    QCOMPARE(client.index(rows - 1, 1).data().toString(), QStringLiteral("QObject"));
+}
+
+void RemoteBenchSuite::transport_throughput_data()
+{
+    QTest::addColumn<QString>("transport");
+    QTest::newRow("tcp") << QStringLiteral("tcp");
+    QTest::newRow("local") << QStringLiteral("local");
+    QTest::newRow("shm") << QStringLiteral("shm");
+}
+
+void RemoteBenchSuite::transport_throughput()
+{
+    QFETCH(QString, transport);
+
+    QObject parent;
+    QIODevice *server, *client;
+    TransportHelper::connectDevices(transport, SharedMemoryDevice::defaultRingSize(), &parent,
+                                    &server, &client);
+    QVERIFY(server && client);
+
+    static const qint64 totalSize = 256 * 1024 * 1024;
+    const QByteArray chunk(8 * 1024 * 1024, 'x'); // roughly a full HD remote view frame
+
+    QByteArray received;
+    QBENCHMARK_ONCE {
+        received = TransportHelper::transfer(server, client, chunk, totalSize);
+    }
+    QCOMPARE(qint64(received.size()), totalSize);
+}
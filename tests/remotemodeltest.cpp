@@ -26,12 +26,19 @@
 
 #include <3rdparty/qt/modeltest.h>
 
-#include <core/remote/remotemodelserver.h>
-#include <client/remotemodel.h>
-#include <common/message.h>
+#include "fakeremotemodel.h"
 
-#include <QBuffer>
+#include <common/objectmodel.h>
+#include <core/objectmodelbase.h>
+#include <core/util.h>
+
+#include <QAbstractListModel>
+#include <QColor>
 #include <QDebug>
+#include <QHash>
+#include <QIcon>
+#include <QImage>
+#include <QPixmap>
 #include <QtTest/qtest.h>
 #include <QObject>
 #include <QSortFilterProxyModel>
@@ -39,74 +46,122 @@
 
 using namespace GammaRay;
 
-static void fakeRegisterServer() {}
-
-namespace GammaRay {
-class FakeRemoteModelServer : public RemoteModelServer
+// flat model with a large number of rows, without any storage of its own
+class LargeFlatModel : public QAbstractListModel
 {
-    Q_OBJECT
 public:
-    explicit FakeRemoteModelServer(const QString &objectName, QObject *parent = 0)
-        : RemoteModelServer(objectName, parent)
+    explicit LargeFlatModel(int rows, QObject *parent = 0)
+        : QAbstractListModel(parent)
+        , m_rows(rows)
     {
-        m_myAddress = 42;
     }
 
-    static void setup()
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE
     {
-        FakeRemoteModelServer::s_registerServerCallback = &fakeRegisterServer;
+        return parent.isValid() ? 0 : m_rows;
     }
 
-signals:
-    void message(const GammaRay::Message &msg);
-
-private:
-    bool isConnected() const Q_DECL_OVERRIDE { return true; }
-    void sendMessage(const Message &msg) const Q_DECL_OVERRIDE
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE
     {
-        QByteArray ba;
-        QBuffer buffer(&ba);
-        buffer.open(QIODevice::ReadWrite);
-        msg.write(&buffer);
-        buffer.seek(0);
-        emit const_cast<FakeRemoteModelServer *>(this)->message(Message::readMessage(&buffer));
+        if (role == Qt::DisplayRole)
+            return QString::number(index.row());
+        return QVariant();
     }
+
+private:
+    int m_rows;
 };
 
-class FakeRemoteModel : public RemoteModel
+// list of objects, similar to the object list/tree models of the probe
+class ObjectsModel : public ObjectModelBase<QAbstractTableModel>
 {
-    Q_OBJECT
 public:
-    explicit FakeRemoteModel(const QString &serverObject, QObject *parent = 0)
-        : RemoteModel(serverObject, parent)
+    explicit ObjectsModel(const QVector<QObject *> &objects, QObject *parent = 0)
+        : ObjectModelBase<QAbstractTableModel>(parent)
+        , tooltipCount(0)
+        , m_objects(objects)
     {
-        m_myAddress = 42;
     }
 
-    static void setup()
+    int rowCount(const QModelIndex &parent = QModelIndex()) const Q_DECL_OVERRIDE
     {
-        FakeRemoteModel::s_registerClientCallback = &fakeRegisterServer;
+        return parent.isValid() ? 0 : m_objects.size();
     }
 
-signals:
-    void message(const GammaRay::Message &msg);
-
-private:
-    void sendMessage(const Message &msg) const Q_DECL_OVERRIDE
+    QVariant data(const QModelIndex &index, int role) const Q_DECL_OVERRIDE
     {
-        QByteArray ba;
-        QBuffer buffer(&ba);
-        buffer.open(QIODevice::ReadWrite);
-        msg.write(&buffer);
-        buffer.seek(0);
-        emit const_cast<FakeRemoteModel *>(this)->message(Message::readMessage(&buffer));
+        if (role == Qt::ToolTipRole)
+            ++tooltipCount;
+        return dataForObject(m_objects.at(index.row()), index, role);
     }
+
+    mutable int tooltipCount;
+
+private:
+    QVector<QObject *> m_objects;
 };
-}
 
 class RemoteModelTest : public QObject
 {
     Q_OBJECT
+private:
+    // bytes sent by the client to re-fetch the content of leaves in a deep tree
+    qint64 deepTreeRequestBytes(bool useHandles)
+    {
+        QStandardItemModel treeModel;
+        auto parentItem = treeModel.invisibleRootItem();
+        for (int depth = 0; depth < 10; ++depth) {
+            auto item = new QStandardItem(QStringLiteral("level%1").arg(depth));
+            parentItem->appendRow(item);
+            parentItem = item;
+        }
+        for (int i = 0; i < 20; ++i)
+            parentItem->appendRow(new QStandardItem(QStringLiteral("leaf%1").arg(i)));
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.DeepTreeModel"),
+                                     this);
+        server.setModel(&treeModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.DeepTreeModel"), this);
+        client.setUseIndexHandles(useHandles);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        QModelIndex parent;
+        for (int depth = 0; depth < 10; ++depth) {
+            client.rowCount(parent);
+            QTest::qWait(1);
+            parent = client.index(0, 0, parent);
+            parent.data();
+            QTest::qWait(1);
+            if (parent.data().toString() != QStringLiteral("level%1").arg(depth))
+                return -1;
+        }
+        client.rowCount(parent);
+        QTest::qWait(1);
+        if (client.rowCount(parent) != 20)
+            return -1;
+
+        for (int round = 0; round < 2; ++round) {
+            client.byteCount = 0;
+            for (int i = 0; i < 20; ++i) {
+                parentItem->child(i)->setText(QStringLiteral("leaf%1-%2").arg(i).arg(round));
+                client.index(i, 0, parent).data();
+            }
+            QTest::qWait(1);
+            for (int i = 0; i < 20; ++i) {
+                if (client.index(i, 0, parent).data().toString()
+                    != QStringLiteral("leaf%1-%2").arg(i).arg(round))
+                    return -1;
+            }
+        }
+        // the last round only has handle-based requests, if enabled
+        return client.byteCount;
+    }
+
 private slots:
     void initTestCases()
     {
@@ -292,6 +347,405 @@ private slots:
 
         delete treeModel;
     }
+
+    void testCoalescedChanges()
+    {
+        auto listModel = new QStandardItemModel(this);
+        for (int i = 0; i < 4; ++i)
+            listModel->appendRow(new QStandardItem(QStringLiteral("entry%1").arg(i)));
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.CoalescedModel"), this);
+        server.setModel(listModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.CoalescedModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        ModelTest modelTest(&client);
+        QTest::qWait(10); // ModelTest is going to fetch stuff for us already
+        QCOMPARE(client.rowCount(), 4);
+
+        server.setFlushInterval(5);
+        server.resetStatistics();
+
+        // structural changes are not delayed, other objects can refer to the new rows right away
+        listModel->insertRow(2, new QStandardItem(QStringLiteral("new0")));
+        listModel->insertRow(3, new QStandardItem(QStringLiteral("new1")));
+        listModel->insertRow(2, new QStandardItem(QStringLiteral("new2")));
+        QCOMPARE(server.messageTypeCount.value(Protocol::ModelRowsAdded), 3);
+        QCOMPARE(client.rowCount(), 7);
+
+        server.resetStatistics();
+        listModel->removeRow(3);
+        listModel->removeRow(2);
+        listModel->removeRow(2);
+        QCOMPARE(server.messageTypeCount.value(Protocol::ModelRowsRemoved), 3);
+        QCOMPARE(client.rowCount(), 4);
+
+        // overlapping content changes are merged
+        auto index = client.index(1, 0);
+        index.data(); // need an event loop entry for the data retrieval
+        QTest::qWait(10);
+        QCOMPARE(index.data().toString(), QStringLiteral("entry1"));
+        server.resetStatistics();
+        for (int i = 0; i < 10; ++i) {
+            listModel->item(0)->setText(QStringLiteral("changed%1").arg(i));
+            listModel->item(1)->setText(QStringLiteral("changed%1").arg(i));
+        }
+        QTest::qWait(50);
+        QCOMPARE(server.messageTypeCount.value(Protocol::ModelContentChanged), 1);
+        index.data();
+        QTest::qWait(10);
+        QCOMPARE(index.data().toString(), QStringLiteral("changed9"));
+
+        // unrelated structural changes flush pending ones in order
+        server.resetStatistics();
+        listModel->appendRow(new QStandardItem(QStringLiteral("entry4")));
+        listModel->item(0)->setText(QStringLiteral("entry0"));
+        listModel->removeRow(4);
+        QTest::qWait(50);
+        QCOMPARE(server.messageTypeCount.value(Protocol::ModelRowsAdded), 1);
+        QCOMPARE(server.messageTypeCount.value(Protocol::ModelContentChanged), 1);
+        QCOMPARE(server.messageTypeCount.value(Protocol::ModelRowsRemoved), 1);
+        QCOMPARE(client.rowCount(), 4);
+
+        delete listModel;
+    }
+
+    void testIndexHandles()
+    {
+        const qint64 pathBytes = deepTreeRequestBytes(false);
+        const qint64 handleBytes = deepTreeRequestBytes(true);
+        QVERIFY(handleBytes > 0);
+        QVERIFY(handleBytes < pathBytes);
+    }
+
+    void testHandleRelease()
+    {
+        QStandardItemModel treeModel;
+        for (int i = 0; i < 1500; ++i) {
+            auto item = new QStandardItem(QStringLiteral("parent%1").arg(i));
+            item->appendRow(new QStandardItem(QStringLiteral("child%1").arg(i)));
+            treeModel.appendRow(item);
+        }
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.HandleModel"),
+                                     this);
+        server.setModel(&treeModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.HandleModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        client.rowCount();
+        QTest::qWait(1);
+        QCOMPARE(client.rowCount(), 1500);
+        for (int i = 0; i < 1500; ++i)
+            client.rowCount(client.index(i, 0));
+        QTest::qWait(1);
+
+        // every parent gets a handle assigned, the least recently used ones get released again
+        for (int i = 0; i < 1500; ++i)
+            client.index(0, 0, client.index(i, 0)).data();
+        QTest::qWait(1);
+        for (int i = 0; i < 1500; ++i) {
+            QCOMPARE(client.index(0, 0, client.index(i, 0)).data().toString(),
+                     QStringLiteral("child%1").arg(i));
+        }
+        QVERIFY(client.handleCount() <= 1025);
+        QCOMPARE(server.handleCount(), client.handleCount() - 1); // the root has no entry
+
+        // released parents are addressed by path again
+        treeModel.item(0)->child(0)->setText(QStringLiteral("changed"));
+        const auto index = client.index(0, 0, client.index(0, 0));
+        index.data();
+        QTest::qWait(1);
+        QCOMPARE(index.data().toString(), QStringLiteral("changed"));
+        QCOMPARE(server.handleCount(), client.handleCount() - 1);
+
+        // handles are dropped together with the client
+        server.modelMonitored(false);
+        QCOMPARE(server.handleCount(), 0);
+    }
+
+    void testCacheEviction()
+    {
+        auto listModel = new QStandardItemModel(this);
+        for (int i = 0; i < 100; ++i) {
+            const QLatin1Char c(char('a' + i % 26));
+            listModel->appendRow(new QStandardItem(QString(1000, c)));
+        }
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.CacheModel"), this);
+        server.setModel(listModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.CacheModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        // room for about 20 rows
+        const qint64 budget = 20 * 1000 * sizeof(QChar);
+        client.setCacheBudget(budget);
+        client.rowCount();
+        QTest::qWait(10);
+        QCOMPARE(client.rowCount(), 100);
+
+        // scroll through the model in chunks
+        for (int row = 0; row < 100; row += 10) {
+            for (int i = row; i < row + 10; ++i)
+                client.index(i, 0).data();
+            QTest::qWait(5);
+            QVERIFY(client.cacheSize() > 0);
+            QVERIFY(client.cacheSize() <= budget);
+        }
+
+        // the beginning got evicted, the end is still there
+        auto index = client.index(0, 0);
+        QVERIFY(index.data(RemoteModel::LoadingState).value<RemoteModel::NodeStates>()
+                & RemoteModel::Empty);
+        QCOMPARE(index.data().toString(), QStringLiteral("Loading..."));
+        QTest::qWait(5);
+        QCOMPARE(index.data().toString(), QString(1000, QLatin1Char('a')));
+
+        index = client.index(99, 0);
+        QVERIFY((index.data(RemoteModel::LoadingState).value<RemoteModel::NodeStates>()
+                 & RemoteModel::Empty) == 0);
+        QCOMPARE(index.data().toString(), QString(1000, QLatin1Char(char('a' + 99 % 26))));
+
+        // nodes waiting for content are not evicted, their reply would be dropped otherwise
+        disconnect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                   SLOT(newRequest(GammaRay::Message)));
+        listModel->item(95)->setText(QStringLiteral("changed"));
+        index = client.index(95, 0);
+        index.data(); // re-requests the outdated content, the request doesn't reach the server
+        QTest::qWait(5);
+        QVERIFY(index.data(RemoteModel::LoadingState).value<RemoteModel::NodeStates>()
+                & RemoteModel::Loading);
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+        for (int i = 10; i < 40; ++i)
+            client.index(i, 0).data();
+        QTest::qWait(5);
+        const auto state = index.data(RemoteModel::LoadingState).value<RemoteModel::NodeStates>();
+        QVERIFY(state & RemoteModel::Loading);
+        QVERIFY((state & RemoteModel::Empty) == 0);
+
+        // structure is retained
+        QCOMPARE(client.rowCount(), 100);
+
+        delete listModel;
+    }
+
+    void testUnserializableData()
+    {
+        QStandardItemModel listModel;
+        for (int i = 0; i < 2; ++i) {
+            auto item = new QStandardItem(QStringLiteral("entry%1").arg(i));
+            item->setData(QVariant::fromValue<QObject*>(this), Qt::UserRole);
+            item->setData(QVariantList() << i << QVariant::fromValue<QObject*>(this), Qt::UserRole + 1);
+            item->setData(QVariantList() << i << QStringLiteral("entry%1").arg(i), Qt::UserRole + 2);
+            listModel.appendRow(item);
+        }
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.UnserializableModel"),
+                                     this);
+        server.setModel(&listModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.UnserializableModel"),
+                               this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        client.rowCount();
+        QTest::qWait(1);
+        QCOMPARE(client.rowCount(), 2);
+        // the second row is decided from the per-type cache
+        for (int i = 0; i < 2; ++i) {
+            const auto index = client.index(i, 0);
+            index.data();
+            QTest::qWait(1);
+            QCOMPARE(index.data().toString(), QStringLiteral("entry%1").arg(i));
+            QVERIFY(!index.data(Qt::UserRole).isValid());
+            QVERIFY(!index.data(Qt::UserRole + 1).isValid());
+            const auto list = index.data(Qt::UserRole + 2).toList();
+            QCOMPARE(list.size(), 2);
+            QCOMPARE(list.at(1).toString(), QStringLiteral("entry%1").arg(i));
+        }
+    }
+
+    void testIconInterning()
+    {
+        QPixmap red(16, 16);
+        red.fill(Qt::red);
+        QPixmap blue(16, 16);
+        blue.fill(Qt::blue);
+        const QIcon sharedIcon(red);
+
+        QStandardItemModel listModel;
+        for (int i = 0; i < 50; ++i) {
+            auto item = new QStandardItem(QStringLiteral("entry%1").arg(i));
+            // a shared icon instance, and icons with identical content created on the fly
+            item->setIcon(i % 2 ? sharedIcon : QIcon(blue));
+            listModel.appendRow(item);
+        }
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.IconModel"), this);
+        server.setModel(&listModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.IconModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        client.rowCount();
+        QTest::qWait(1);
+        QCOMPARE(client.rowCount(), 50);
+
+        for (int i = 0; i < 50; ++i) {
+            client.index(i, 0).data();
+            QTest::qWait(1);
+        }
+
+        // each distinct icon is transferred once
+        QVERIFY(server.messageTypeCount.value(Protocol::ModelIconData) > 0);
+        QVERIFY(server.messageTypeCount.value(Protocol::ModelIconData) <= 2);
+        for (int i = 0; i < 50; ++i) {
+            const auto index = client.index(i, 0);
+            QCOMPARE(index.data().toString(), QStringLiteral("entry%1").arg(i));
+            const QPixmap pixmap = index.data(Qt::DecorationRole).value<QPixmap>();
+            QVERIFY(!pixmap.isNull());
+            QCOMPARE(pixmap.toImage().pixel(8, 8), (i % 2 ? red : blue).toImage().pixel(8, 8));
+        }
+    }
+
+    void testIconRegistryLimit()
+    {
+        QStandardItemModel listModel;
+        for (int i = 0; i < 1500; ++i) {
+            auto item = new QStandardItem(QStringLiteral("entry%1").arg(i));
+            QPixmap pixmap(16, 16);
+            pixmap.fill(QColor(i % 256, i / 256, 0));
+            item->setIcon(QIcon(pixmap));
+            listModel.appendRow(item);
+        }
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.IconLimitModel"),
+                                     this);
+        server.setModel(&listModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.IconLimitModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        client.rowCount();
+        QTest::qWait(1);
+        QCOMPARE(client.rowCount(), 1500);
+        for (int i = 0; i < 1500; i += 100) {
+            for (int j = i; j < i + 100; ++j)
+                client.index(j, 0).data();
+            QTest::qWait(1);
+        }
+
+        // the registry started over once it was full, and so did the client
+        QVERIFY(client.iconCount() < 1500);
+        for (int i = 0; i < 1500; ++i) {
+            const QPixmap pixmap = client.index(i, 0).data(Qt::DecorationRole).value<QPixmap>();
+            QVERIFY(!pixmap.isNull());
+            QCOMPARE(QColor(pixmap.toImage().pixel(8, 8)), QColor(i % 256, i / 256, 0));
+        }
+    }
+
+    void testOnDemandRoles()
+    {
+        QObject root;
+        QVector<QObject *> objects;
+        for (int i = 0; i < 20; ++i) {
+            auto obj = new QObject(&root);
+            obj->setObjectName(QStringLiteral("object%1").arg(i));
+            objects.push_back(obj);
+        }
+        ObjectsModel objectsModel(objects);
+
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.ObjectsModel"),
+                                     this);
+        server.setModel(&objectsModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.ObjectsModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        client.rowCount();
+        QTest::qWait(1);
+        QCOMPARE(client.rowCount(), 20);
+        for (int i = 0; i < 20; ++i)
+            client.index(i, 0).data();
+        QTest::qWait(1);
+        QCOMPARE(client.index(5, 0).data().toString(), Util::shortDisplayString(objects.at(5)));
+        QVERIFY(client.index(5, 0).data(ObjectModel::ObjectIdRole).isValid());
+        QCOMPARE(objectsModel.tooltipCount, 0);
+
+        // fetched for the requested cell only
+        const auto index = client.index(5, 0);
+        QVERIFY(!index.data(Qt::ToolTipRole).isValid());
+        QTest::qWait(1);
+        QCOMPARE(index.data(Qt::ToolTipRole).toString(), Util::tooltipForObject(objects.at(5)));
+        QCOMPARE(objectsModel.tooltipCount, 1);
+        QCOMPARE(index.data().toString(), Util::shortDisplayString(objects.at(5)));
+
+        // roles without a value are requested only once
+        QVERIFY(!index.data(Qt::WhatsThisRole).isValid());
+        QTest::qWait(1);
+        server.resetStatistics();
+        QVERIFY(!index.data(Qt::WhatsThisRole).isValid());
+        QTest::qWait(1);
+        QCOMPARE(server.messageCount, 0);
+    }
+
+    void testLargeFlatModel()
+    {
+        static const int rows = 10000;
+        LargeFlatModel flatModel(rows);
+        FakeRemoteModelServer server(QStringLiteral("com.kdab.GammaRay.UnitTest.LargeModel"), this);
+        server.setModel(&flatModel);
+        server.modelMonitored(true);
+
+        FakeRemoteModel client(QStringLiteral("com.kdab.GammaRay.UnitTest.LargeModel"), this);
+        connect(&server, SIGNAL(message(GammaRay::Message)), &client,
+                SLOT(newMessage(GammaRay::Message)));
+        connect(&client, SIGNAL(message(GammaRay::Message)), &server,
+                SLOT(newRequest(GammaRay::Message)));
+
+        client.rowCount(); // synchronous with the fake server, builds all row nodes
+        QCOMPARE(client.rowCount(), rows);
+        QVERIFY(client.nodeMemoryUsage() > 0);
+
+        for (int i = 1230; i < 1240; ++i)
+            client.index(i, 0).data();
+        QTest::qWait(1);
+        QCOMPARE(client.index(1234, 0).data().toString(), QStringLiteral("1234"));
+        QCOMPARE(client.index(rows - 1, 0).parent(), QModelIndex());
+        QVERIFY(client.cacheSize() > 0);
+    }
 };
 
 QTEST_MAIN(RemoteModelTest)
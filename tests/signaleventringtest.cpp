@@ -0,0 +1,161 @@
+/*
+  signaleventringtest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <plugins/signalmonitor/signaleventring.h>
+
+#include <QtTest/qtest.h>
+#include <QObject>
+#include <QThread>
+
+using namespace GammaRay;
+
+namespace {
+/// Pushes a sequence of events with increasing signal indexes into a ring.
+class Producer : public QThread
+{
+public:
+    Producer(SignalEventRing *ring, int count)
+        : m_ring(ring)
+        , m_count(count)
+    {
+    }
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 1; i <= m_count; ++i)
+            m_ring->push(0, i, i);
+    }
+
+private:
+    SignalEventRing *m_ring;
+    int m_count;
+};
+}
+
+class SignalEventRingTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testDrain()
+    {
+        SignalEventRing ring;
+        QVector<SignalEvent> events;
+        QCOMPARE(ring.drain(events), 0);
+
+        // several rounds, so the ring wraps around a few times
+        int next = 0;
+        for (int round = 0; round < 5; ++round) {
+            const int count = SignalEventRing::Capacity / 2 + round;
+            for (int i = 0; i < count; ++i)
+                ring.push(reinterpret_cast<QObject *>(quintptr(next + i + 1)), next + i, next + i);
+
+            events.clear();
+            QCOMPARE(ring.drain(events), count);
+            QCOMPARE(events.size(), count);
+            for (int i = 0; i < count; ++i) {
+                QCOMPARE(events.at(i).sender, reinterpret_cast<QObject *>(quintptr(next + i + 1)));
+                QCOMPARE(events.at(i).signalIndex, next + i);
+                QCOMPARE(events.at(i).timestamp, qint64(next + i));
+            }
+            next += count;
+        }
+        QCOMPARE(ring.takeOverruns(), 0);
+    }
+
+    void testOverruns()
+    {
+        SignalEventRing ring;
+        // one slot stays empty to tell a full ring from an empty one
+        const int capacity = SignalEventRing::Capacity - 1;
+        for (int i = 0; i < capacity + 100; ++i)
+            ring.push(0, i, i);
+
+        // the oldest events are kept, the ones not fitting anymore are counted
+        QVector<SignalEvent> events;
+        QCOMPARE(ring.drain(events), capacity);
+        QCOMPARE(events.first().signalIndex, 0);
+        QCOMPARE(events.last().signalIndex, capacity - 1);
+        QCOMPARE(ring.takeOverruns(), 100);
+        QCOMPARE(ring.takeOverruns(), 0);
+
+        // there is room again after draining
+        ring.push(0, 42, 42);
+        events.clear();
+        QCOMPARE(ring.drain(events), 1);
+        QCOMPARE(events.first().signalIndex, 42);
+        QCOMPARE(ring.takeOverruns(), 0);
+    }
+
+    void testConcurrentProducer()
+    {
+        SignalEventRing ring;
+        const int count = 1000000;
+        Producer producer(&ring, count);
+        producer.start();
+
+        // every event is either drained in order or counted as overrun
+        QVector<SignalEvent> events;
+        int drained = 0;
+        int overruns = 0;
+        int last = 0;
+        bool finished = false;
+        do {
+            finished = producer.isFinished(); // drain once more after the producer is done
+            events.clear();
+            drained += ring.drain(events);
+            overruns += ring.takeOverruns();
+            foreach (const SignalEvent &ev, events) {
+                QVERIFY(ev.signalIndex > last);
+                QCOMPARE(ev.timestamp, qint64(ev.signalIndex));
+                last = ev.signalIndex;
+            }
+        } while (!finished);
+        QVERIFY(producer.wait());
+
+        QCOMPARE(drained + overruns, count);
+        QVERIFY(drained > 0);
+    }
+
+    void testOrphaned()
+    {
+        SignalEventRing ring;
+        ring.push(0, 1, 1);
+        QVERIFY(!ring.isOrphaned());
+        ring.setOrphaned();
+        QVERIFY(ring.isOrphaned());
+
+        // events pushed before the thread exited are still there
+        QVector<SignalEvent> events;
+        QCOMPARE(ring.drain(events), 1);
+    }
+};
+
+QTEST_MAIN(SignalEventRingTest)
+
+#include "signaleventringtest.moc"
@@ -27,6 +27,7 @@
 */
 
 #include <plugins/timertop/timermodel.h>
+#include <plugins/timertop/latencyhistogram.h>
 
 #include <probe/hooks.h>
 #include <probe/probecreator.h>
@@ -122,6 +123,10 @@ private slots:
         // TODO verify data
         QVERIFY(dataChangeSpy.size() > 0);
         QVERIFY(dataChangeSpy.size() < 5);
+        idx = indexForName(model, "timer1");
+        QVERIFY(idx.isValid());
+        QVERIFY(idx.sibling(idx.row(), TimerModel::TimePerWakeupP50Column).data().toString() != QLatin1String("N/A"));
+        QVERIFY(!idx.data(TimerModel::ExecutionTimeHistogramRole).toList().isEmpty());
 
         delete t1;
         QTest::qWait(1);
@@ -144,12 +149,45 @@ private slots:
         QVERIFY(idx.isValid());
         QEXPECT_FAIL("", "still needs to be investigated", Continue);
         QCOMPARE(idx.data(TimerModel::ObjectIdRole).value<ObjectId>(), ObjectId(this));
-        idx = idx.sibling(idx.row(), 6);
+        idx = idx.sibling(idx.row(), TimerModel::TimerIdColumn);
         QVERIFY(idx.isValid());
         QCOMPARE(idx.data().toInt(), timerId);
 
         killTimer(timerId);
     }
+
+    void testLatencyHistogram()
+    {
+        LatencyHistogram histogram;
+        QCOMPARE(histogram.count(), Q_UINT64_C(0));
+        QCOMPARE(histogram.percentile(50), Q_INT64_C(-1));
+
+        for (int i = 1; i <= 1000; ++i)
+            histogram.record(i * 1000);
+        QCOMPARE(histogram.count(), Q_UINT64_C(1000));
+        QCOMPARE(histogram.minimum(), Q_INT64_C(1000));
+        QCOMPARE(histogram.maximum(), Q_INT64_C(1000000));
+        QCOMPARE(histogram.mean(), Q_INT64_C(500500));
+
+        // bucket resolution is 1/16 of the value
+        QVERIFY(qAbs(histogram.percentile(50) - 500000) <= 500000 / 16);
+        QVERIFY(qAbs(histogram.percentile(95) - 950000) <= 950000 / 16);
+        QVERIFY(qAbs(histogram.percentile(99) - 990000) <= 990000 / 16);
+        QCOMPARE(histogram.percentile(100), histogram.maximum());
+
+        for (int i = 0; i < LatencyHistogram::bucketCount(); ++i) {
+            QCOMPARE(LatencyHistogram::bucketForValue(LatencyHistogram::bucketLowerBound(i)), i);
+            QCOMPARE(LatencyHistogram::bucketForValue(LatencyHistogram::bucketLowerBound(i + 1) - 1), i);
+        }
+
+        // out of range values are clamped
+        histogram.record(-1);
+        QCOMPARE(histogram.minimum(), Q_INT64_C(0));
+        QCOMPARE(LatencyHistogram::bucketForValue(Q_INT64_C(1) << 40), LatencyHistogram::bucketCount() - 1);
+
+        histogram.reset();
+        QCOMPARE(histogram.count(), Q_UINT64_C(0));
+    }
 };
 
 QTEST_MAIN(TimerTopTest)
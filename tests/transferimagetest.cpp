@@ -0,0 +1,214 @@
+/*
+  transferimagetest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <common/protocol.h>
+#include <common/transferimage.h>
+
+#include <QtTest/qtest.h>
+#include <QBuffer>
+#include <QObject>
+
+using namespace GammaRay;
+
+class TransferImageTest : public QObject
+{
+    Q_OBJECT
+private:
+    static TransferImage roundTrip(const TransferImage &in)
+    {
+        QByteArray data;
+        {
+            QBuffer buffer(&data);
+            buffer.open(QIODevice::WriteOnly);
+            QDataStream stream(&buffer);
+            stream << in;
+        }
+        QBuffer buffer(&data);
+        buffer.open(QIODevice::ReadOnly);
+        QDataStream stream(&buffer);
+        TransferImage out;
+        stream >> out;
+        return out;
+    }
+
+private slots:
+    void testFullTransfer()
+    {
+        QImage img(100, 80, QImage::Format_ARGB32);
+        img.fill(Qt::red);
+
+        const TransferImage out = roundTrip(TransferImage(img));
+        QVERIFY(!out.isPartial());
+        QCOMPARE(out.image(), img);
+    }
+
+    void testDeltaTransfer()
+    {
+        QImage base(300, 200, QImage::Format_ARGB32);
+        base.fill(Qt::white);
+        QImage img = base.copy();
+        img.setPixel(130, 70, qRgb(0, 0, 255));
+        img.setPixel(299, 199, qRgb(0, 255, 0));
+
+        TransferImage in(img);
+        in.setDeltaBase(base);
+        const TransferImage out = roundTrip(in);
+        QVERIFY(out.isPartial());
+        QVERIFY(out.image().isNull());
+
+        QImage patched = base.copy();
+        QVERIFY(out.applyTo(patched));
+        QCOMPARE(patched, img);
+    }
+
+    void testDeltaFallback()
+    {
+        QImage base(128, 128, QImage::Format_ARGB32);
+        base.fill(Qt::white);
+
+        // incompatible base
+        QImage img(64, 64, QImage::Format_ARGB32);
+        img.fill(Qt::black);
+        TransferImage in(img);
+        in.setDeltaBase(base);
+        QVERIFY(!roundTrip(in).isPartial());
+
+        // everything changed
+        img = QImage(128, 128, QImage::Format_ARGB32);
+        img.fill(Qt::black);
+        in.setImage(img);
+        in.setDeltaBase(base);
+        QVERIFY(!roundTrip(in).isPartial());
+    }
+
+    void testApplyMismatch()
+    {
+        QImage base(128, 128, QImage::Format_ARGB32);
+        base.fill(Qt::white);
+        QImage img = base.copy();
+        img.setPixel(1, 1, qRgb(0, 0, 0));
+
+        TransferImage in(img);
+        in.setDeltaBase(base);
+        const TransferImage out = roundTrip(in);
+        QVERIFY(out.isPartial());
+
+        QImage wrongBase(64, 64, QImage::Format_ARGB32);
+        QVERIFY(!out.applyTo(wrongBase));
+    }
+
+    void testLosslessTransfer()
+    {
+        QImage base(300, 200, QImage::Format_ARGB32);
+        for (int y = 0; y < base.height(); ++y) {
+            for (int x = 0; x < base.width(); ++x)
+                base.setPixel(x, y, qRgba(x, y, x ^ y, 255 - y));
+        }
+
+        TransferImage in(base);
+        QCOMPARE(in.encode(TransferImage::LosslessEncoding), TransferImage::LosslessEncoding);
+        QVERIFY(in.encodedSize() > 0);
+        QVERIFY(in.encodedSize() < base.byteCount());
+        TransferImage out = roundTrip(in);
+        QVERIFY(!out.isPartial());
+        QCOMPARE(out.image(), base);
+
+        QImage img = base.copy();
+        img.setPixel(130, 70, qRgb(0, 0, 255));
+        img.setPixel(299, 199, qRgb(0, 255, 0));
+        in.setImage(img);
+        in.setDeltaBase(base);
+        in.encode(TransferImage::LosslessEncoding);
+        out = roundTrip(in);
+        QVERIFY(out.isPartial());
+        QImage patched = base.copy();
+        QVERIFY(out.applyTo(patched));
+        QCOMPARE(patched, img);
+    }
+
+    void testLossyTransfer()
+    {
+        if (!(TransferImage::supportedEncoders() & TransferImage::supportedDecoders() & Protocol::LossyImageEncoding))
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+            QSKIP("JPEG image format plugin not available");
+#else
+            QSKIP("JPEG image format plugin not available", SkipSingle);
+#endif
+
+        QImage img(160, 120, QImage::Format_ARGB32_Premultiplied);
+        img.fill(qRgb(200, 100, 50));
+        TransferImage in(img);
+        QCOMPARE(in.encode(TransferImage::LossyEncoding, 90), TransferImage::LossyEncoding);
+        const TransferImage out = roundTrip(in);
+        QCOMPARE(out.image().size(), img.size());
+        QCOMPARE(out.image().format(), img.format());
+        const QRgb pixel = out.image().pixel(80, 60);
+        QVERIFY(qAbs(qRed(pixel) - 200) < 8);
+        QVERIFY(qAbs(qGreen(pixel) - 100) < 8);
+        QVERIFY(qAbs(qBlue(pixel) - 50) < 8);
+
+        // transparency and deltas are never encoded lossy
+        img.fill(Qt::transparent);
+        in.setImage(img);
+        QCOMPARE(in.encode(TransferImage::LossyEncoding, 90), TransferImage::LosslessEncoding);
+        QCOMPARE(roundTrip(in).image(), img);
+    }
+
+    void testLossyTransferRgba8888()
+    {
+#if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
+        QSKIP("RGBA8888 requires Qt 5.2", SkipSingle);
+#elif QT_VERSION < QT_VERSION_CHECK(5, 2, 0)
+        QSKIP("RGBA8888 requires Qt 5.2");
+#else
+        if (!(TransferImage::supportedEncoders() & TransferImage::supportedDecoders() & Protocol::LossyImageEncoding))
+            QSKIP("JPEG image format plugin not available");
+
+        // what the Quick inspector OpenGL capture produces
+        QImage img(160, 120, QImage::Format_RGBA8888);
+        img.fill(qRgb(200, 100, 50));
+        TransferImage in(img);
+        QCOMPARE(in.encode(TransferImage::LossyEncoding, 90), TransferImage::LossyEncoding);
+        const TransferImage out = roundTrip(in);
+        QCOMPARE(out.image().size(), img.size());
+        const QRgb pixel = out.image().pixel(80, 60);
+        QVERIFY(qAbs(qRed(pixel) - 200) < 8);
+        QVERIFY(qAbs(qGreen(pixel) - 100) < 8);
+        QVERIFY(qAbs(qBlue(pixel) - 50) < 8);
+
+        img.setPixel(10, 10, qRgba(0, 0, 0, 128));
+        in.setImage(img);
+        QCOMPARE(in.encode(TransferImage::LossyEncoding, 90), TransferImage::LosslessEncoding);
+        QCOMPARE(roundTrip(in).image(), img);
+#endif
+    }
+};
+
+QTEST_MAIN(TransferImageTest)
+
+#include "transferimagetest.moc"
@@ -0,0 +1,115 @@
+/*
+  transporthelper.h
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef GAMMARAY_TRANSPORTHELPER_H
+#define GAMMARAY_TRANSPORTHELPER_H
+
+#include <common/sharedmemorydevice.h>
+
+#include <QtTest/qtest.h>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+
+namespace GammaRay {
+/** Helpers for testing and benchmarking the "tcp", "local" and "shm" transports. */
+namespace TransportHelper {
+/** Sets up a connected pair of devices for @p transport, owned by @p parent. */
+inline void connectDevices(const QString &transport, int ringSize, QObject *parent,
+                           QIODevice **serverDevice, QIODevice **clientDevice)
+{
+    *serverDevice = 0;
+    *clientDevice = 0;
+    const QString name = QStringLiteral("gammaray-transporttest-%1").arg(QCoreApplication::applicationPid());
+
+    if (transport == QLatin1String("tcp")) {
+        auto server = new QTcpServer(parent);
+        QVERIFY(server->listen(QHostAddress::LocalHost));
+        auto client = new QTcpSocket(parent);
+        client->connectToHost(QHostAddress::LocalHost, server->serverPort());
+        QVERIFY(server->waitForNewConnection(5000));
+        QVERIFY(client->waitForConnected(5000));
+        *serverDevice = server->nextPendingConnection();
+        *clientDevice = client;
+        return;
+    }
+
+    QLocalServer::removeServer(name);
+    auto server = new QLocalServer(parent);
+    QVERIFY(server->listen(name));
+
+    if (transport == QLatin1String("local")) {
+        auto client = new QLocalSocket(parent);
+        client->connectToServer(name);
+        QVERIFY(server->waitForNewConnection(5000));
+        QVERIFY(client->waitForConnected(5000));
+        *serverDevice = server->nextPendingConnection();
+        *clientDevice = client;
+        return;
+    }
+
+    auto client = new SharedMemoryDevice(parent);
+    client->connectToServer(name);
+    QVERIFY(server->waitForNewConnection(5000));
+    auto serverDev = new SharedMemoryDevice(parent);
+    QVERIFY(serverDev->create(server->nextPendingConnection(), ringSize));
+    QVERIFY(client->localSocket()->waitForReadyRead(5000)); // handshake
+    QVERIFY(client->isOpen());
+    *serverDevice = serverDev;
+    *clientDevice = client;
+}
+
+/** Sends @p size bytes in chunks of @p chunk from @p sender to @p receiver, returns what was received. */
+inline QByteArray transfer(QIODevice *sender, QIODevice *receiver, const QByteArray &chunk, qint64 size)
+{
+    QByteArray received;
+    received.reserve(size);
+    QByteArray buffer(64 * 1024, Qt::Uninitialized);
+    qint64 written = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    while (received.size() < size && timer.elapsed() < 30000) {
+        while (written < size && sender->bytesToWrite() < 4 * chunk.size()) {
+            const qint64 n = qMin<qint64>(chunk.size(), size - written);
+            sender->write(chunk.constData(), n);
+            written += n;
+        }
+        QCoreApplication::processEvents();
+        qint64 n;
+        while ((n = receiver->read(buffer.data(), buffer.size())) > 0)
+            received.append(buffer.constData(), n);
+    }
+    return received;
+}
+}
+}
+
+#endif // GAMMARAY_TRANSPORTHELPER_H
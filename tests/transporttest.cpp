@@ -0,0 +1,100 @@
+/*
+  transporttest.cpp
+
+  This file is part of GammaRay, the Qt application inspection and
+  manipulation tool.
+
+  Copyright (C) 2016 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+  Author: Volker Krause <volker.krause@kdab.com>
+
+  Licensees holding valid commercial KDAB GammaRay licenses may use this file in
+  accordance with GammaRay Commercial License Agreement provided with the Software.
+
+  Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "transporthelper.h"
+
+#include <QtTest/qtest.h>
+#include <QObject>
+
+using namespace GammaRay;
+
+class TransportTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void testSharedMemoryDevice()
+    {
+        QObject parent;
+        QIODevice *server, *client;
+        TransportHelper::connectDevices(QStringLiteral("shm"), 4096, &parent, &server, &client);
+        QVERIFY(server && client);
+        QVERIFY(server->isSequential());
+
+        // odd sized chunks much larger than the ring, to cover wrap around and queueing
+        QByteArray chunk(3001, Qt::Uninitialized);
+        for (int i = 0; i < chunk.size(); ++i)
+            chunk[i] = char(i * 7);
+        const QByteArray received = TransportHelper::transfer(server, client, chunk, 10 * chunk.size());
+        QCOMPARE(received.size(), 10 * chunk.size());
+        for (int i = 0; i < 10; ++i)
+            QCOMPARE(received.mid(i * chunk.size(), chunk.size()), chunk);
+
+        // and the other direction
+        QCOMPARE(TransportHelper::transfer(client, server, chunk, chunk.size()), chunk);
+
+        QVERIFY(client->waitForBytesWritten(1000));
+        QCOMPARE(client->bytesToWrite(), qint64(0));
+
+        // closing one side is noticed by the other
+        server->close();
+        for (int i = 0; i < 100 && client->isOpen(); ++i)
+            QTest::qWait(10);
+        QVERIFY(!client->isOpen());
+    }
+
+    void testTransfer_data()
+    {
+        QTest::addColumn<QString>("transport");
+        QTest::newRow("tcp") << QStringLiteral("tcp");
+        QTest::newRow("local") << QStringLiteral("local");
+        QTest::newRow("shm") << QStringLiteral("shm");
+    }
+
+    void testTransfer()
+    {
+        QFETCH(QString, transport);
+
+        QObject parent;
+        QIODevice *server, *client;
+        TransportHelper::connectDevices(transport, SharedMemoryDevice::defaultRingSize(), &parent,
+                                        &server, &client);
+        QVERIFY(server && client);
+
+        QByteArray chunk(256 * 1024, Qt::Uninitialized);
+        for (int i = 0; i < chunk.size(); ++i)
+            chunk[i] = char(i * 13);
+        const QByteArray received = TransportHelper::transfer(server, client, chunk, 4 * chunk.size());
+        QCOMPARE(received.size(), 4 * chunk.size());
+        for (int i = 0; i < 4; ++i)
+            QCOMPARE(received.mid(i * chunk.size(), chunk.size()), chunk);
+    }
+};
+
+QTEST_MAIN(TransportTest)
+
+#include "transporttest.moc"
@@ -59,6 +59,7 @@ RemoteViewWidget::RemoteViewWidget(QWidget *parent)
     , m_interactionMode(NoInteraction)
     , m_supportedInteractionModes(ViewInteraction | Measuring | ElementPicking | InputRedirection)
     , m_hasMeasurement(false)
+    , m_userViewportZoom(0.0)
     , m_pickProxyModel(new ObjectIdsFilterProxyModel(this))
 {
     setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
@@ -209,11 +210,23 @@ void RemoteViewWidget::elementsAtReceived(const GammaRay::ObjectIds &ids, int be
 
 void RemoteViewWidget::frameUpdated(const RemoteViewFrame &frame)
 {
+    RemoteViewFrame newFrame(frame);
+    if (newFrame.isPartial()) {
+        QImage image = m_frame.image();
+        m_frame.setImage(QImage()); // drop our reference, so the changes can be applied in place
+        if (!newFrame.resolvePartial(image)) {
+            // we are out of sync with the server, request a full frame
+            m_frame.setImage(image);
+            m_interface->setViewActive(true);
+            return;
+        }
+    }
+
     if (!m_frame.isValid()) {
-        m_frame = frame;
+        m_frame = newFrame;
         fitToView();
     } else {
-        m_frame = frame;
+        m_frame = newFrame;
         update();
     }
 
@@ -414,7 +427,8 @@ void RemoteViewWidget::paintEvent(QPaintEvent *event)
                         // but need to be able to see single pixels when zoomed in.
         p.setRenderHint(QPainter::SmoothPixmapTransform);
     }
-    p.drawImage(QRect(QPoint(0, 0), m_frame.viewRect().size().toSize() * m_zoom), m_frame.image());
+    const QRectF imageRect = m_frame.imageRect().translated(-m_frame.viewRect().topLeft());
+    p.drawImage(QRectF(imageRect.topLeft() * m_zoom, imageRect.size() * m_zoom), m_frame.image());
     drawDecoration(&p);
     p.restore();
 
@@ -422,6 +436,32 @@ void RemoteViewWidget::paintEvent(QPaintEvent *event)
 
     if (m_interactionMode == Measuring && m_hasMeasurement)
         drawMeasureOverlay(&p);
+
+    updateUserViewport();
+}
+
+void RemoteViewWidget::updateUserViewport()
+{
+    if (!m_interface)
+        return;
+
+    QRectF viewport;
+    double zoom = m_zoom;
+    // measuring and picking operate on the full frame
+    if (m_interactionMode != Measuring && m_interactionMode != ElementPicking) {
+        viewport = QRectF(QPointF(-m_x / m_zoom, -m_y / m_zoom),
+                          QSizeF(contentWidth(), contentHeight()) / m_zoom);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
+        zoom *= devicePixelRatio();
+#endif
+    }
+
+    if (viewport == m_userViewport && zoom == m_userViewportZoom)
+        return;
+    m_userViewport = viewport;
+    m_userViewportZoom = zoom;
+    QMetaObject::invokeMethod(m_interface, "setClientViewport", Qt::QueuedConnection,
+                              Q_ARG(QRectF, viewport), Q_ARG(double, zoom));
 }
 
 void RemoteViewWidget::drawDecoration(QPainter *p)
@@ -150,6 +150,8 @@ private:
     void drawMeasurementLabel(QPainter *p, QPoint pos, QPoint dir, const QString &text);
 
     void clampPanPosition();
+    /// tells the server which part of the source we currently show, so it only sends that
+    void updateUserViewport();
 
     void sendMouseEvent(QMouseEvent *event);
     void sendKeyEvent(QKeyEvent *event);
@@ -190,6 +192,8 @@ private:
     QPoint m_measurementStartPosition; // in source coordinates
     QPoint m_measurementEndPosition; // in source coordinates
     bool m_hasMeasurement;
+    QRectF m_userViewport; // in source coordinates, last sent to the server
+    double m_userViewportZoom;
     ObjectIdsFilterProxyModel *m_pickProxyModel;
 };
 }
@@ -99,6 +99,9 @@ MessageHandlerWidget::MessageHandlerWidget(QWidget *parent)
     connect(ui->messageView->selectionModel(),
             SIGNAL(selectionChanged(QItemSelection,QItemSelection)),
             this, SLOT(messageSelected(QItemSelection)));
+    // the backtrace of remote messages arrives after selecting them
+    connect(displayModel, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+            this, SLOT(messageDataChanged(QModelIndex,QModelIndex)));
 
     ui->backtraceView->hide();
     ui->backtraceView->setModel(m_backtraceModel);
@@ -200,6 +203,17 @@ void MessageHandlerWidget::messageContextMenu(const QPoint &pos)
     contextMenu.exec(ui->messageView->viewport()->mapToGlobal(pos));
 }
 
+void MessageHandlerWidget::messageDataChanged(const QModelIndex &topLeft,
+                                              const QModelIndex &bottomRight)
+{
+    const auto selection = ui->messageView->selectionModel()->selection();
+    if (selection.isEmpty())
+        return;
+    const int row = selection.first().top();
+    if (row >= topLeft.row() && row <= bottomRight.row())
+        messageSelected(selection);
+}
+
 void MessageHandlerWidget::messageSelected(const QItemSelection &selection)
 {
     if (selection.isEmpty())
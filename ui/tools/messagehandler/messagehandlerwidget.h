@@ -56,6 +56,7 @@ private slots:
     void copyToClipboard(const QString &message);
     void messageContextMenu(const QPoint &pos);
     void messageSelected(const QItemSelection &selection);
+    void messageDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
 
 private:
     QScopedPointer<Ui::MessageHandlerWidget> ui;